@@ -1,5 +1,14 @@
 #include "AST.h"
+#include "DebugInfo.h"
 #include "IR.h"
+#include "Incremental.h"
+#include "LineProfile.h"
+#include "Options.h"
+#include "Profile.h"
+#include "Runtime.h"
+#include "Strings.h"
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/raw_ostream.h>
 #include <fstream>
 #include <unordered_map>
@@ -29,6 +38,44 @@
         }                                                                                    \
     } while (0)
 
+// Totals for --ast-stats; the sized delete gets the size of the dynamic type
+static size_t astNodesAllocated = 0;
+static size_t astBytesAllocated = 0;
+static size_t astBytesLive = 0;
+static size_t astBytesPeak = 0;
+
+void *ASTNode::operator new(size_t size)
+{
+    astNodesAllocated++;
+    astBytesAllocated += size;
+    astBytesLive += size;
+    if (astBytesLive > astBytesPeak)
+        astBytesPeak = astBytesLive;
+    return ::operator new(size);
+}
+
+void ASTNode::operator delete(void *node, size_t size)
+{
+    astBytesLive -= size;
+    ::operator delete(node);
+}
+
+size_t astLiveBytes()
+{
+    return astBytesLive;
+}
+
+void printASTStats()
+{
+    fprintf(stderr, "AST: %zu nodes, %zu bytes, %.1f bytes per node, peak %zu bytes live\n",
+            astNodesAllocated, astBytesAllocated,
+            astNodesAllocated ? double(astBytesAllocated) / astNodesAllocated : 0.0, astBytesPeak);
+    fprintf(stderr, "AST node sizes: Identifier %zu, IntegerLiteral %zu, BinaryOp %zu, UnaryOp %zu, "
+                    "Comparison %zu, LogicalOp %zu, Assignment %zu, FuncCall %zu\n",
+            sizeof(IdentifierAST), sizeof(IntegerLiteralAST), sizeof(BinaryOpAST), sizeof(UnaryOpAST),
+            sizeof(ComparisonAST), sizeof(LogicalOpAST), sizeof(AssignmentAST), sizeof(FuncCallAST));
+}
+
 const std::unordered_map<std::string, TypeAST::TypeGenerator> TypeAST::typeMap = {
     {"INTEGER", [](llvm::LLVMContext &ctx)
      {
@@ -88,11 +135,57 @@ Value *DeclarationAST::codegen()
     llvm::errs() << "Generating code for declaration: " << identifier->name << " of type " << type->type << "\n";
 
     AllocaInst *alloca = globalSymbolTable->allocateSymbol(identifier->name);
+    // A STRING always holds a string the runtime can read, starting with ""
+    if (alloca && isStringType(alloca->getAllocatedType()))
+        builder.CreateStore(emitStringLiteral(""), alloca);
 
     llvm::errs() << "Declaration codegen completed for: " << identifier->name << "\n";
     return alloca;
 }
 
+// Flattens a & b & c into its operands, left to right
+static void collectConcatOperands(ASTNode *node, std::vector<ASTNode *> &operands)
+{
+    auto *binary = dynamic_cast<BinaryOpAST *>(node);
+    if (binary && binary->op == BinaryOp::Concat)
+    {
+        collectConcatOperands(binary->expression1, operands);
+        collectConcatOperands(binary->expression2, operands);
+    }
+    else
+        operands.push_back(node);
+}
+
+static bool codegenConcatOperands(const std::vector<ASTNode *> &operands, std::vector<Value *> &parts)
+{
+    for (ASTNode *operand : operands)
+    {
+        Value *value = operand->codegen();
+        if (!value)
+            return false;
+        Value *part = emitStringOperand(value);
+        if (!part)
+        {
+            errs() << "Operator & needs STRING or CHAR operands, not " << *value->getType() << "\n";
+            return false;
+        }
+        parts.push_back(part);
+    }
+    return true;
+}
+
+// For s = s & a & ... the operands after s, which are appended to s in
+// place; empty for any other assignment
+static std::vector<ASTNode *> appendedOperands(const std::string &name, ASTNode *expression)
+{
+    std::vector<ASTNode *> operands;
+    collectConcatOperands(expression, operands);
+    auto *first = dynamic_cast<IdentifierAST *>(operands[0]);
+    if (operands.size() < 2 || !first || first->name != name)
+        return {};
+    return std::vector<ASTNode *>(operands.begin() + 1, operands.end());
+}
+
 Value *AssignmentAST::codegen()
 {
     DEBUG_PRINT_FUNCTION();
@@ -102,12 +195,59 @@ Value *AssignmentAST::codegen()
 
     // 2. Get the type of the variable from the symbol table
     llvm::Type *varType = globalSymbolTable->getSymbolType(identifier->name);
+
+    // A = B copies a whole array: one memcpy between fixed arrays of the same
+    // type, or the runtime copy between arrays sized at run time and lists
+    if (ArraySymbol *array = globalSymbolTable->lookupArray(identifier->name))
+    {
+        auto *source = dynamic_cast<IdentifierAST *>(expression);
+        ArraySymbol *sourceArray = source ? globalSymbolTable->lookupArray(source->name) : nullptr;
+        bool sameShape = sourceArray && sourceArray->getValue() && sourceArray->getRank() == array->getRank() &&
+                         (array->isFixed() ? sourceArray->getType() == varType
+                                           : !sourceArray->isFixed() &&
+                                                 sourceArray->getElementType() == array->getElementType());
+        if (!sameShape)
+        {
+            llvm::outs() << "Type mismatch: array " << identifier->name << " can only be assigned an array of the same type and size\n";
+            return nullptr;
+        }
+        if (array->isFixed())
+            builder.CreateMemCpy(varPtr, MaybeAlign(), sourceArray->getValue(), MaybeAlign(), ConstantExpr::getSizeOf(varType));
+        else
+        {
+            emitArrayAssign(varPtr, sourceArray->getValue(), array->getElementType());
+            // The inner dimensions go with the elements
+            if (array->getRank() > 1)
+            {
+                Type *dimsType = cast<StructType>(varType)->getElementType(4);
+                Value *dims = builder.CreateLoad(dimsType, builder.CreateStructGEP(varType, sourceArray->getValue(), 4));
+                builder.CreateStore(dims, builder.CreateStructGEP(varType, varPtr, 4));
+            }
+        }
+        if (isStringType(array->getElementType()))
+            emitStringShare(array->emitData(), array->emitLength());
+        return varPtr;
+    }
+    std::vector<ASTNode *> appended;
+    if (isStringType(varType))
+        appended = appendedOperands(identifier->name, expression);
+    if (!appended.empty())
+    {
+        std::vector<Value *> parts;
+        if (!codegenConcatOperands(appended, parts))
+            return nullptr;
+        emitAppend(varPtr, parts);
+        return varPtr;
+    }
     // 3. Generate code for the value being assigned
     Value *val = expression->codegen();
     if (!val)
     {
         return nullptr;
     }
+    // A CHAR can be assigned to a STRING
+    if (isStringType(varType) && val->getType()->isIntegerTy(8))
+        val = emitStringOperand(val);
 
     // 4. Type check
     llvm::Type *valType = val->getType();
@@ -118,36 +258,151 @@ Value *AssignmentAST::codegen()
     }
 
     // 5. Store the value in the variable pointer
-    builder.CreateStore(val, varPtr);
+    if (isStringType(varType))
+        emitStringStore(val, varPtr);
+    else
+        builder.CreateStore(val, varPtr);
 
     return val;
 }
 
+ArrayAST::ArrayAST(IdentifierAST *id, TypeAST *t, const std::vector<ASTNode *> &boundList)
+    : identifier(id), type(t)
+{
+    bool literal = true;
+    for (size_t i = 0; i + 1 < boundList.size(); i += 2)
+    {
+        auto *first = dynamic_cast<IntegerLiteralAST *>(boundList[i]);
+        auto *last = dynamic_cast<IntegerLiteralAST *>(boundList[i + 1]);
+        literal = literal && first && last;
+        bounds.push_back({first ? first->value : 0, last ? last->value : -1});
+    }
+    if (!literal)
+        boundExpressions = boundList;
+}
+
 Value *ArrayAST::codegen()
 {
     DEBUG_PRINT_FUNCTION();
     llvm::errs() << "Generating code for declaration: " << identifier->name << " of type " << type->type << "\n";
     // 3. Create an alloca of the array type
     AllocaInst *alloca = globalSymbolTable->allocateSymbol(identifier->name);
+    if (alloca && isDynamic())
+    {
+        std::vector<Value *> boundValues;
+        for (ASTNode *bound : boundExpressions)
+        {
+            Value *value = bound->codegen();
+            if (!value)
+                return nullptr;
+            if (!value->getType()->isIntegerTy(32))
+            {
+                llvm::errs() << "Array '" << identifier->name << "' bounds must be INTEGER\n";
+                return nullptr;
+            }
+            boundValues.push_back(value);
+        }
+        if (boundValues.size() == 2)
+            emitArrayInit(alloca, type->giveType(), boundValues[0], boundValues[1]);
+        else
+            emitArrayInitDims(alloca, type->giveType(), boundValues,
+                              globalSymbolTable->lookupArray(identifier->name)->emitInnerDimensions());
+        return alloca;
+    }
+    // NULL elements read as ""
+    Type *arrayType = alloca ? alloca->getAllocatedType() : nullptr;
+    if (arrayType && arrayType->isArrayTy() && isStringType(arrayType->getArrayElementType()))
+        builder.CreateMemSet(alloca, builder.getInt8(0), ConstantExpr::getSizeOf(arrayType), MaybeAlign());
 
     llvm::errs() << "Declaration codegen completed for: " << identifier->name << "\n";
     return alloca;
 }
 
-Value *ArrayAssignmentAST::codegen()
+Value *ListAST::codegen()
 {
     DEBUG_PRINT_FUNCTION();
+    AllocaInst *alloca = globalSymbolTable->allocateSymbol(identifier->name);
+    if (alloca)
+        emitArrayInit(alloca, type->giveType(), builder.getInt32(1), builder.getInt32(0));
+    return alloca;
+}
+
+// Element type of an array or list, or the variable's own type
+static Type *elementTypeOf(const std::string &name)
+{
+    if (ArraySymbol *array = globalSymbolTable->lookupArray(name))
+        return array->getElementType();
+    return globalSymbolTable->getSymbolType(name);
+}
+
+// Address of the element of array name at indices, or nullptr after reporting an error
+static Value *elementAddress(const std::string &name, const std::vector<ASTNode *> &indices)
+{
+    std::vector<Value *> indexValues;
+    for (ASTNode *index : indices)
+    {
+        Value *indexValue = index->codegen();
+        if (!indexValue)
+        {
+            llvm::errs() << "Failed to generate index for array: " << name << "\n";
+            return nullptr;
+        }
+        indexValues.push_back(indexValue);
+    }
+    Value *elementPtr = globalSymbolTable->lookupSymbol(name, indexValues);
+    if (!elementPtr && !globalSymbolTable->lookupArray(name))
+        llvm::errs() << "'" << name << "' is not an array\n";
+    return elementPtr;
+}
+
+// The array named by an OUTPUT expression or INPUT target, if it names a whole one
+static ArraySymbol *wholeArray(ASTNode *node)
+{
+    auto *id = dynamic_cast<IdentifierAST *>(node);
+    return id ? globalSymbolTable->lookupArray(id->name) : nullptr;
+}
+
+// Suffix of the whole-array I/O routines for an element type
+static const char *arrayIOSuffix(Type *element)
+{
+    if (element->isIntegerTy(32))
+        return "int";
+    if (element->isDoubleTy())
+        return "real";
+    if (element->isIntegerTy(8))
+        return "char";
+    if (element->isIntegerTy(1))
+        return "bool";
+    if (isStringType(element))
+        return "str";
+    return nullptr;
+}
 
-    // 1. Generate code for index
-    Value *indexValue = index->codegen();
-    if (!indexValue)
+// INPUT A or OUTPUT A: one runtime call over the elements in row-major order
+static Value *emitArrayIO(ArraySymbol *array, bool output, Value *separator)
+{
+    const char *suffix = arrayIOSuffix(array->getElementType());
+    if (!array->getValue() || !suffix || (!output && !strcmp(suffix, "bool")))
     {
-        llvm::errs() << "Failed to generate index for array: " << identifier->name << "\n";
+        errs() << "Unsupported array type in " << (output ? "output" : "input") << "\n";
         return nullptr;
     }
+    FunctionCallee callee = getRuntimeFunction(std::string(output ? "ssc_output_array_" : "ssc_input_array_") + suffix);
+    std::vector<Value *> args = {
+        builder.CreatePointerCast(array->emitData(), callee.getFunctionType()->getParamType(0)), array->emitLength()};
+    if (output)
+        args.push_back(builder.CreatePointerCast(separator, builder.getInt8PtrTy()));
+    return builder.CreateCall(callee, args);
+}
+
+Value *ArrayAssignmentAST::codegen()
+{
+    DEBUG_PRINT_FUNCTION();
 
-    // 2. Look up the pointer to the array element
-    Value *elementPtr = globalSymbolTable->lookupSymbol(identifier->name, indexValue);
+    // 1. Generate code for the indices and look up the pointer to the array element
+    Value *elementPtr = elementAddress(identifier->name, indices);
+    if (!elementPtr)
+        return nullptr;
     // 3. Generate code for the value being assigned
     Value *val = expression->codegen();
     if (!val)
@@ -156,17 +411,9 @@ Value *ArrayAssignmentAST::codegen()
     }
 
     // 4. Type check: match **element type**, not array type
-    llvm::Type *expectedArrayType = globalSymbolTable->getSymbolType(identifier->name);
-
-    llvm::Type *expectedElementType = nullptr;
-    if (expectedArrayType->isArrayTy())
-    {
-        expectedElementType = expectedArrayType->getArrayElementType();
-    }
-    else
-    {
-        expectedElementType = expectedArrayType; // fallback
-    }
+    llvm::Type *expectedElementType = elementTypeOf(identifier->name);
+    if (isStringType(expectedElementType) && val->getType()->isIntegerTy(8))
+        val = emitStringOperand(val);
 
     llvm::Type *valType = val->getType();
     if (expectedElementType->getTypeID() != valType->getTypeID())
@@ -176,7 +423,10 @@ Value *ArrayAssignmentAST::codegen()
     }
 
     // 5. Store the value into the array element
-    builder.CreateStore(val, elementPtr);
+    if (isStringType(expectedElementType))
+        emitStringStore(val, elementPtr);
+    else
+        builder.CreateStore(val, elementPtr);
 
     return val;
 }
@@ -185,20 +435,13 @@ Value *ArrayAccessAST::codegen()
 {
     DEBUG_PRINT_FUNCTION();
 
-    // 1. Get the index value (like 'i' in arr[i])
-    Value *indexValue = index->codegen();
-    if (!indexValue)
-    {
-        llvm::errs() << "Invalid index expression\n";
+    // 1. Get the index values (like 'i' and 'j' in grid[i, j]) and the pointer to the array element
+    Value *elementPtr = elementAddress(identifier->name, indices);
+    if (!elementPtr)
         return nullptr;
-    }
-
-    // 2. Look up the pointer to the array element
-    Value *elementPtr = globalSymbolTable->lookupSymbol(identifier->name, indexValue);
 
     // 3. Get the type of the element, not the array
-    llvm::Type *arrayType = globalSymbolTable->getSymbolType(identifier->name);
-    llvm::Type *elementType = arrayType->isArrayTy() ? arrayType->getArrayElementType() : arrayType;
+    llvm::Type *elementType = elementTypeOf(identifier->name);
 
     // 4. Load and return the value at that index
     Value *loadedValue = builder.CreateLoad(elementType, elementPtr);
@@ -213,50 +456,52 @@ Value *OutputAST::codegen()
         BasicBlock &entry = mainFunction->getEntryBlock();
         builder.SetInsertPoint(&entry, entry.end());
     }
-    Function *printfFunc = module->getFunction("printf");
-    if (!printfFunc)
-    {
-        auto *printfTy = FunctionType::get(
-            builder.getInt32Ty(),
-            PointerType::get(builder.getInt8Ty(), 0),
-            true);
-        printfFunc = Function::Create(
-            printfTy,
-            Function::ExternalLinkage,
-            "printf",
-            module);
-    }
-    std::string fmt;
-    std::vector<Value *> args;
-    for (auto &exp : expressions)
+    Value *call = nullptr;
+    for (size_t i = 0; i < expressions.size(); ++i)
     {
+        ASTNode *exp = expressions[i];
+        // A whole array is written with a space between elements unless given a separator
+        if (ArraySymbol *array = wholeArray(exp))
+        {
+            Value *separator = separators[i] ? separators[i]->codegen() : emitStringLiteral(" ");
+            if (separator && separator->getType()->isIntegerTy(8))
+                separator = emitStringOperand(separator);
+            if (!separator || !isStringType(separator->getType()))
+            {
+                errs() << "The separator in output must be a STRING or CHAR\n";
+                return nullptr;
+            }
+            call = emitArrayIO(array, true, separator);
+            if (!call)
+                return nullptr;
+            continue;
+        }
+        if (separators[i])
+        {
+            errs() << "Only a whole array can be output with a separator\n";
+            return nullptr;
+        }
         Value *v = exp->codegen();
         if (!v)
             return nullptr;
 
-        if (v->getType()->isIntegerTy(32))
-            fmt += "%d";
-        else if (v->getType()->isDoubleTy())
-            fmt += "%f";
-        else if (v->getType()->isIntegerTy(8))
-            fmt += "%c";
-        else if (v->getType()->isPointerTy())
-            fmt += "%s";
-
-        args.push_back(v);
-    }
-
-    Constant *fmtConst = ConstantDataArray::getString(
-        context, fmt + "\n", true);
-    auto *fmtGV = new GlobalVariable(
-        *module,
-        fmtConst->getType(), true,
-        GlobalValue::PrivateLinkage,
-        fmtConst);
-    Value *fmtPtr = builder.CreateGlobalStringPtr(fmt, ".fmt");
-
-    args.insert(args.begin(), fmtPtr);
-    CallInst *call = builder.CreateCall(printfFunc, args);
+        Type *type = v->getType();
+        if (type->isIntegerTy(32))
+            call = builder.CreateCall(getRuntimeFunction("ssc_output_int"), {v});
+        else if (type->isDoubleTy())
+            call = builder.CreateCall(getRuntimeFunction("ssc_output_real"), {v});
+        else if (type->isIntegerTy(8))
+            call = builder.CreateCall(getRuntimeFunction("ssc_output_char"), {builder.CreateSExt(v, builder.getInt32Ty())});
+        else if (type->isIntegerTy(1))
+            call = builder.CreateCall(getRuntimeFunction("ssc_output_bool"), {builder.CreateZExt(v, builder.getInt32Ty())});
+        else if (type->isPointerTy())
+            call = builder.CreateCall(getRuntimeFunction("ssc_output_str"), {builder.CreatePointerCast(v, builder.getInt8PtrTy())});
+        else
+        {
+            errs() << "Unsupported type in output: " << *type << "\n";
+            return nullptr;
+        }
+    }
     return call;
 }
 Value *InputAST::codegen()
@@ -268,6 +513,12 @@ Value *InputAST::codegen()
         builder.SetInsertPoint(&entry, entry.end());
     }
 
+    if (ArraySymbol *array = wholeArray(target))
+    {
+        emitArrayIO(array, false, nullptr);
+        return nullptr;
+    }
+
     // Step 1: Generate the pointer to the variable or array element
     Value *targetPtr = nullptr;
     llvm::Type *varType = nullptr;
@@ -280,17 +531,8 @@ Value *InputAST::codegen()
     }
     else if (auto *arrayAccess = dynamic_cast<ArrayAccessAST *>(target))
     {
-        // Use lookupSymbol with index to get the pointer
-        Value *indexValue = arrayAccess->index->codegen();
-        if (!indexValue)
-        {
-            errs() << "Error: invalid index expression\n";
-            return nullptr;
-        }
-
-        targetPtr = globalSymbolTable->lookupSymbol(arrayAccess->identifier->name, indexValue);
-        llvm::Type *arrayType = globalSymbolTable->getSymbolType(arrayAccess->identifier->name);
-        varType = arrayType->isArrayTy() ? arrayType->getArrayElementType() : arrayType;
+        targetPtr = elementAddress(arrayAccess->identifier->name, arrayAccess->indices);
+        varType = elementTypeOf(arrayAccess->identifier->name);
     }
 
     if (!targetPtr || !varType)
@@ -299,33 +541,97 @@ Value *InputAST::codegen()
         return nullptr;
     }
 
-    // Step 2: Prepare format string
-    std::string fmt;
+    // Step 2: Read through the runtime's buffered stdin
+    const char *reader = nullptr;
     if (varType->isIntegerTy(32))
-        fmt = "%d";
+        reader = "ssc_input_int";
     else if (varType->isDoubleTy())
-        fmt = "%lf";
+        reader = "ssc_input_real";
     else if (varType->isIntegerTy(8))
-        fmt = " %c";
+        reader = "ssc_input_char";
     else if (varType->isPointerTy())
-        fmt = "%s";
+        reader = "ssc_input_str";
     else
     {
         errs() << "Unsupported type in input\n";
         return nullptr;
     }
 
-    Value *fmtPtr = builder.CreateGlobalStringPtr(fmt, ".fmt");
+    builder.CreateCall(getRuntimeFunction(reader), {targetPtr});
+    return nullptr;
+}
 
-    // Step 3: Call scanf
-    FunctionCallee scanfFunc = module->getOrInsertFunction(
-        "scanf",
-        FunctionType::get(
-            builder.getInt32Ty(),
-            PointerType::getUnqual(builder.getInt8Ty()),
-            true));
+Value *FileAST::codegen()
+{
+    DEBUG_PRINT_FUNCTION();
+    if (!builder.GetInsertBlock())
+    {
+        BasicBlock &entry = mainFunction->getEntryBlock();
+        builder.SetInsertPoint(&entry, entry.end());
+    }
+    Value *name = file->codegen();
+    if (name && name->getType()->isIntegerTy(8))
+        name = emitStringOperand(name);
+    if (!name || !isStringType(name->getType()))
+    {
+        errs() << "A file name must be a STRING\n";
+        return nullptr;
+    }
+    name = builder.CreatePointerCast(name, builder.getInt8PtrTy());
 
-    builder.CreateCall(scanfFunc, {fmtPtr, targetPtr});
+    switch (op)
+    {
+    case FileOp::Open:
+        return builder.CreateCall(getRuntimeFunction("ssc_file_open"),
+                                  {name, builder.getInt32(static_cast<int>(mode))});
+    case FileOp::Close:
+        return builder.CreateCall(getRuntimeFunction("ssc_file_close"), {name});
+    case FileOp::Read:
+    {
+        // READFILE reads one line into a STRING variable or element
+        Value *slot = nullptr;
+        Type *type = nullptr;
+        if (auto *id = dynamic_cast<IdentifierAST *>(operand))
+        {
+            slot = globalSymbolTable->lookupSymbol(id->name);
+            type = globalSymbolTable->getSymbolType(id->name);
+        }
+        else if (auto *access = dynamic_cast<ArrayAccessAST *>(operand))
+        {
+            slot = elementAddress(access->identifier->name, access->indices);
+            type = elementTypeOf(access->identifier->name);
+        }
+        if (!slot || !type || !isStringType(type))
+        {
+            errs() << "READFILE reads a line into a STRING\n";
+            return nullptr;
+        }
+        return builder.CreateCall(getRuntimeFunction("ssc_file_read"), {name, slot});
+    }
+    case FileOp::Write:
+    {
+        Value *value = operand->codegen();
+        if (!value)
+            return nullptr;
+        Type *type = value->getType();
+        if (type->isIntegerTy(32))
+            return builder.CreateCall(getRuntimeFunction("ssc_file_write_int"), {name, value});
+        if (type->isDoubleTy())
+            return builder.CreateCall(getRuntimeFunction("ssc_file_write_real"), {name, value});
+        // Everything else is written as text, like OUTPUT writes it
+        if (type->isIntegerTy(1))
+            value = builder.CreateSelect(value, emitStringLiteral("TRUE"), emitStringLiteral("FALSE"));
+        else if (type->isIntegerTy(8))
+            value = emitStringOperand(value);
+        if (!isStringType(value->getType()))
+        {
+            errs() << "Unsupported type in WRITEFILE: " << *type << "\n";
+            return nullptr;
+        }
+        return builder.CreateCall(getRuntimeFunction("ssc_file_write_str"),
+                                  {name, builder.CreatePointerCast(value, builder.getInt8PtrTy())});
+    }
+    }
     return nullptr;
 }
 
@@ -333,6 +639,15 @@ Value *BinaryOpAST::codegen()
 {
     DEBUG_PRINT_FUNCTION();
     // Binary operation
+    if (op == BinaryOp::Concat)
+    {
+        std::vector<ASTNode *> operands;
+        collectConcatOperands(this, operands);
+        std::vector<Value *> parts;
+        if (!codegenConcatOperands(operands, parts))
+            return nullptr;
+        return emitConcat(parts);
+    }
     Value *lhs = expression1->codegen();
     Value *rhs = nullptr;
     if (expression2)
@@ -358,7 +673,7 @@ Value *IfAST::codegen()
     BasicBlock *elseBB = BasicBlock::Create(context, "if.else", function);
     BasicBlock *mergeBB = BasicBlock::Create(context, "if.end", function);
 
-    builder.CreateCondBr(condVal, thenBB, elseBB);
+    profileBranch(builder.CreateCondBr(condVal, thenBB, elseBB));
 
     builder.SetInsertPoint(thenBB);
 
@@ -398,8 +713,9 @@ Value *ForAST::codegen()
 
     // Condition block
     builder.SetInsertPoint(condBB);
+    countLoopTest(line);
     Value *condValue = condition->codegen(); // Should return i1 from ComparisonAST
-    builder.CreateCondBr(condValue, loopBB, afterBB);
+    profileBranch(builder.CreateCondBr(condValue, loopBB, afterBB));
 
     // Loop body
     builder.SetInsertPoint(loopBB);
@@ -429,8 +745,9 @@ Value *WhileAST::codegen()
 
     // Emit condition
     builder.SetInsertPoint(condBB);
+    countLoopTest(line);
     Value *condVal = condition->codegen();
-    builder.CreateCondBr(condVal, bodyBB, endBB);
+    profileBranch(builder.CreateCondBr(condVal, bodyBB, endBB));
 
     // Emit body
     builder.SetInsertPoint(bodyBB);
@@ -460,31 +777,58 @@ Value *RepeatAST::codegen()
 
     // Emit condition
     builder.SetInsertPoint(condBB);
+    countLoopTest(line);
     Value *condVal = condition->codegen();
     condVal = builder.CreateICmpEQ(condVal, ConstantInt::get(Type::getInt1Ty(context), 0), "repeat_cond");
-    builder.CreateCondBr(condVal, endBB, bodyBB);
+    profileBranch(builder.CreateCondBr(condVal, endBB, bodyBB));
 
     // Continue with end block
     builder.SetInsertPoint(endBB);
     globalSymbolTable->exitScope();
     return nullptr;
 }
-Value *ProcedureAST::codegen()
+FunctionType *ProcedureAST::functionType() const
 {
-    DEBUG_PRINT_FUNCTION();
-    globalSymbolTable->enterScope();
-    // Create the function type based on parameters
     std::vector<Type *> paramTypes;
     for (auto &param : parameters)
         paramTypes.push_back(TypeAST::typeMap.at(param->type->type)(context));
+    return FunctionType::get(Type::getVoidTy(context), paramTypes, false);
+}
+
+std::string ProcedureAST::signature() const
+{
+    std::string sig = "PROCEDURE " + Identifier->name + "(";
+    for (size_t i = 0; i < parameters.size(); ++i)
+        sig += (i ? "," : "") + parameters[i]->type->type;
+    return sig + ")";
+}
 
-    FunctionType *funcType = FunctionType::get(Type::getVoidTy(context), paramTypes, false);
-    Function *function = Function::Create(funcType, Function::ExternalLinkage, Identifier->name, *module);
+RoutineSignature ProcedureAST::exportSignature() const
+{
+    RoutineSignature sig;
+    sig.name = Identifier->name;
+    for (auto *param : parameters)
+        sig.paramTypes.push_back(param->type->type);
+    return sig;
+}
+
+Value *ProcedureAST::codegen()
+{
+    DEBUG_PRINT_FUNCTION();
+    Function *function = Function::Create(functionType(), Function::ExternalLinkage, Identifier->name, *module);
+    globalSymbolTable->declareFunction(Identifier->name, function, function->getReturnType(),
+                                       function->getFunctionType()->params().vec());
+    globalSymbolTable->enterScope();
 
     BasicBlock *prevInsertBlock = builder.GetInsertBlock();
     // Create the entry block for the function
     BasicBlock *entryBB = BasicBlock::Create(context, "entry", function);
     builder.SetInsertPoint(entryBB);
+    debugBeginFunction(function, line);
+
+    Fingerprint fp;
+    fp.addNode(this);
+    profileBeginFunction(function, fp);
 
     // Allocate space for each parameter and store it
     auto argIt = function->arg_begin();
@@ -494,8 +838,12 @@ Value *ProcedureAST::codegen()
         paramVal->setName(param->name);
 
         llvm::Type *varType = TypeAST::typeMap.at(param->type->type)(context);
-        AllocaInst *alloca = globalSymbolTable->allocateSymbol(param->name);
-        builder.CreateStore(paramVal, alloca);
+        globalSymbolTable->declareSymbol(param->name, varType);
+        AllocaInst *alloca = globalSymbolTable->allocateSymbol(param->name, argIt->getArgNo() + 1);
+        if (isStringType(varType))
+            emitStringStore(paramVal, alloca, true);
+        else
+            builder.CreateStore(paramVal, alloca);
 
         ++argIt;
     }
@@ -505,28 +853,57 @@ Value *ProcedureAST::codegen()
 
     // Return void
     builder.CreateRetVoid();
+    profileEndFunction(function);
+    debugEndFunction();
     globalSymbolTable->exitScope();
     builder.SetInsertPoint(prevInsertBlock);
     return function;
 }
 
-Value *FuncAST::codegen()
+FunctionType *FuncAST::functionType() const
 {
-    DEBUG_PRINT_FUNCTION();
-    globalSymbolTable->enterScope();
-    // Create the function type based on parameters
     std::vector<Type *> paramTypes;
     for (auto &param : parameters)
         paramTypes.push_back(TypeAST::typeMap.at(param->type->type)(context));
+    llvm::Type *retType = TypeAST::typeMap.at(returnType->type)(context);
+    return FunctionType::get(retType, paramTypes, false);
+}
+
+std::string FuncAST::signature() const
+{
+    std::string sig = "FUNCTION " + Identifier->name + "(";
+    for (size_t i = 0; i < parameters.size(); ++i)
+        sig += (i ? "," : "") + parameters[i]->type->type;
+    return sig + ") RETURNS " + returnType->type;
+}
+
+RoutineSignature FuncAST::exportSignature() const
+{
+    RoutineSignature sig;
+    sig.name = Identifier->name;
+    sig.returnType = returnType->type;
+    for (auto *param : parameters)
+        sig.paramTypes.push_back(param->type->type);
+    return sig;
+}
 
-    llvm::Type *FuncType = TypeAST::typeMap.at(returnType->type)(context);
-    FunctionType *funcType = FunctionType::get(FuncType, paramTypes, false);
-    Function *function = Function::Create(funcType, Function::ExternalLinkage, Identifier->name, *module);
+Value *FuncAST::codegen()
+{
+    DEBUG_PRINT_FUNCTION();
+    Function *function = Function::Create(functionType(), Function::ExternalLinkage, Identifier->name, *module);
+    globalSymbolTable->declareFunction(Identifier->name, function, function->getReturnType(),
+                                       function->getFunctionType()->params().vec());
+    globalSymbolTable->enterScope();
 
     BasicBlock *prevInsertBlock = builder.GetInsertBlock();
     // Create the entry block for the function
     BasicBlock *entryBB = BasicBlock::Create(context, "entry", function);
     builder.SetInsertPoint(entryBB);
+    debugBeginFunction(function, line);
+
+    Fingerprint fp;
+    fp.addNode(this);
+    profileBeginFunction(function, fp);
 
     // Allocate space for each parameter and store it
     auto argIt = function->arg_begin();
@@ -536,14 +913,20 @@ Value *FuncAST::codegen()
         paramVal->setName(param->name);
 
         llvm::Type *varType = TypeAST::typeMap.at(param->type->type)(context);
-        AllocaInst *alloca = globalSymbolTable->allocateSymbol(param->name);
-        builder.CreateStore(paramVal, alloca);
+        globalSymbolTable->declareSymbol(param->name, varType);
+        AllocaInst *alloca = globalSymbolTable->allocateSymbol(param->name, argIt->getArgNo() + 1);
+        if (isStringType(varType))
+            emitStringStore(paramVal, alloca, true);
+        else
+            builder.CreateStore(paramVal, alloca);
 
         ++argIt;
     }
 
     // Generate code for the statements in the block
     statementsBlock->codegen();
+    profileEndFunction(function);
+    debugEndFunction();
 
     // Return void
     globalSymbolTable->exitScope();
@@ -555,13 +938,96 @@ Value *ReturnAST::codegen()
 {
     DEBUG_PRINT_FUNCTION();
     Value *returnValue = expression->codegen();
+    if (!returnValue)
+        return nullptr;
+    Type *returnType = builder.GetInsertBlock()->getParent()->getReturnType();
+    if (isStringType(returnType) && returnValue->getType()->isIntegerTy(8))
+        returnValue = emitStringOperand(returnValue);
     builder.CreateRet(returnValue);
     return returnValue;
 }
 
+// LENGTH is also the STRING built-in; it is the array one when its argument names an array
+bool FuncCallAST::namesArray() const
+{
+    auto *arrayName = arguments.size() == 1 ? dynamic_cast<IdentifierAST *>(arguments[0]) : nullptr;
+    return arrayName && globalSymbolTable->lookupArray(arrayName->name);
+}
+
+// The first argument of SUM(A), FILL(A, v), ... names a whole array, which is passed by address
+Value *FuncCallAST::codegenArrayBuiltin()
+{
+    auto *arrayName = arguments.empty() ? nullptr : dynamic_cast<IdentifierAST *>(arguments[0]);
+    ArraySymbol *array = arrayName ? globalSymbolTable->lookupArray(arrayName->name) : nullptr;
+    if (!array || !array->getValue())
+    {
+        errs() << "Built-in " << name << " expects an array as its first argument\n";
+        return nullptr;
+    }
+    if (name == "LENGTH")
+        return array->emitLength();
+    if ((name == "LINEARSEARCH" || name == "BINARYSEARCH") && array->getRank() > 1)
+    {
+        errs() << "Built-in " << name << " expects a one-dimensional array\n";
+        return nullptr;
+    }
+
+    std::vector<Value *> args;
+    for (size_t i = 1; i < arguments.size(); ++i)
+    {
+        Value *argVal = arguments[i]->codegen();
+        if (!argVal)
+            return nullptr;
+        args.push_back(argVal);
+    }
+
+    // APPEND(L, x) stores x in a new element at the end of list L
+    if (name == "APPEND")
+    {
+        Type *element = array->getElementType();
+        if (array->getExtent() != ArraySymbol::Extent::Growable || args.size() != 1)
+        {
+            errs() << "Built-in APPEND expects a LIST and a value\n";
+            return nullptr;
+        }
+        Value *value = args[0];
+        if (value->getType()->isIntegerTy(32) && element->isDoubleTy())
+            value = builder.CreateSIToFP(value, element, "toreal");
+        if (isStringType(element) && value->getType()->isIntegerTy(8))
+            value = emitStringOperand(value);
+        if (value->getType()->getTypeID() != element->getTypeID())
+        {
+            errs() << "Type mismatch: APPEND value does not match the element type of " << arrayName->name << "\n";
+            return nullptr;
+        }
+        Value *slot = emitListPush(array->getValue(), element);
+        if (isStringType(element))
+            emitStringStore(value, slot, true);
+        else
+            builder.CreateStore(value, slot);
+        return value;
+    }
+    return emitArrayBuiltin(name, array->emitData(), array->getElementType(), array->emitLength(),
+                            array->emitFirstIndex(), args);
+}
+
 Value *FuncCallAST::codegen()
 {
     Function *callee = module->getFunction(name);
+    if (!callee && isArrayBuiltin(name) && (name != "LENGTH" || namesArray()))
+        return codegenArrayBuiltin();
+    if (!callee && isBuiltinRoutine(name))
+    {
+        std::vector<Value *> args;
+        for (ASTNode *arg : arguments)
+        {
+            Value *argVal = arg->codegen();
+            if (!argVal)
+                return nullptr;
+            args.push_back(argVal);
+        }
+        return emitBuiltinCall(name, args);
+    }
     if (!callee)
     {
         errs() << "Unknown function: " << name << "\n";
@@ -597,7 +1063,7 @@ Value *FuncCallAST::codegen()
 Value *LogicalOpAST::codegen()
 {
     DEBUG_PRINT_FUNCTION();
-    if (cmpOp == "NOT")
+    if (logicalOp == LogicalOp::Not)
     {
         if (!RHS)
         {
@@ -617,7 +1083,7 @@ Value *LogicalOpAST::codegen()
     }
     if (!LHS || !RHS)
     {
-        errs() << "Error: NULL operand for binary logical operator: " << cmpOp << "\n";
+        errs() << "Error: NULL operand for binary logical operator: " << opSpelling(logicalOp) << "\n";
         return nullptr;
     }
     Value *lhsVal = LHS->codegen();
@@ -640,31 +1106,72 @@ Value *LogicalOpAST::codegen()
             ConstantInt::get(rhsVal->getType(), 0),
             "tobool");
     }
-    if (cmpOp == "AND")
-    {
+    if (logicalOp == LogicalOp::And)
         return builder.CreateAnd(lhsVal, rhsVal, "andtmp");
-    }
-    else if (cmpOp == "OR")
-    {
-        return builder.CreateOr(lhsVal, rhsVal, "ortmp");
-    }
-    else
-    {
-        errs() << "Unknown logical operator: " << cmpOp << "\n";
-        return nullptr;
-    }
+    return builder.CreateOr(lhsVal, rhsVal, "ortmp");
+}
+
+Value *codegenStatement(ASTNode *statement)
+{
+    debugLocation(statement->line);
+    Value *start = beginLineProfile(statement);
+    Value *result = statement->codegen();
+    endLineProfile(statement, start);
+    return result;
 }
 
 Value *StatementBlockAST::codegen()
 {
     DEBUG_PRINT_FUNCTION();
     Value *lastValue = nullptr;
+    debugBeginBlock(statements.empty() || !statements[0] ? 0 : statements[0]->line);
     for (auto *stmt : statements)
     {
         if (stmt)
         {
-            lastValue = stmt->codegen();
+            lastValue = codegenStatement(stmt);
         }
     }
+    debugEndBlock();
     return lastValue;
 }
+
+
+// Looks for <module>.ssci in the -I directories, next to the source file, then in the working directory
+static std::string findInterface(const std::string &moduleName)
+{
+    std::vector<std::string> dirs = compilerOptions.importPaths;
+    if (compilerOptions.inputFile)
+        dirs.push_back(std::string(llvm::sys::path::parent_path(compilerOptions.inputFile)));
+    dirs.push_back(".");
+
+    for (const std::string &dir : dirs)
+    {
+        llvm::SmallString<128> path(dir.empty() ? "." : dir);
+        llvm::sys::path::append(path, moduleName + ".ssci");
+        if (llvm::sys::fs::exists(path))
+            return std::string(path.str());
+    }
+    return "";
+}
+
+bool ImportAST::semanticCheck()
+{
+    std::string path = findInterface(moduleName);
+    if (path.empty())
+    {
+        llvm::errs() << "Semantic error: cannot find interface " << moduleName << ".ssci for IMPORT\n";
+        return false;
+    }
+
+    std::unique_ptr<ModuleInterface> iface = ModuleInterface::load(path);
+    if (!iface)
+        return false;
+
+    routines.clear();
+    for (size_t i = 0; i < iface->size(); i++)
+        routines.push_back(iface->routine(i));
+    importedInterfaces().push_back(path);
+    llvm::errs() << "Imported " << routines.size() << " routines from " << path << "\n";
+    return globalSymbolTable->importInterface(*iface);
+}
\ No newline at end of file
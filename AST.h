@@ -7,17 +7,35 @@
 #include <unordered_map>
 #include <functional>
 #include "Symbol_Table.h"
+#include "ModuleInterface.h"
+#include "Strings.h"
 using namespace llvm;
 
+class Fingerprint;
+class ASTVisitor;
+
 class ASTNode
 {
 public:
+    int line = 0; // first source line of a statement, set by the parser
     virtual ~ASTNode() = default;
     virtual llvm::Value *codegen() = 0;
     virtual bool semanticCheck() { return true; };
-    ;
+    // Structural hash of the node, used for incremental compilation
+    virtual void fingerprint(Fingerprint &fp) const = 0;
+    // Calls the visitor's visit() for this node class (Passes.h)
+    virtual void accept(ASTVisitor &visitor) = 0;
+
+    // Every node is counted for --ast-stats
+    static void *operator new(size_t size);
+    static void operator delete(void *node, size_t size);
 };
 
+// Prints the number of nodes allocated and their bytes per node to stderr
+void printASTStats();
+// Bytes of the nodes allocated and not deleted yet, for --mem-report
+size_t astLiveBytes();
+
 // --- Type ---
 class TypeAST : public ASTNode
 {
@@ -44,6 +62,8 @@ public:
         }
         return true;
     }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 // --- Literals ---
@@ -56,6 +76,8 @@ public:
     {
         return ConstantInt::get(Type::getInt8Ty(context), value);
     }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class StringLiteralAST : public ASTNode
@@ -65,16 +87,10 @@ public:
     StringLiteralAST(const std::string &val) : value(val) {}
     Value *codegen()
     {
-        Constant *strConst = ConstantDataArray::getString(context, value);
-        GlobalVariable *gvar = new GlobalVariable(
-            *module,
-            strConst->getType(),
-            true,
-            GlobalValue::PrivateLinkage,
-            strConst,
-            ".str");
-        return gvar;
+        return emitStringLiteral(value);
     }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class IntegerLiteralAST : public ASTNode
@@ -86,6 +102,8 @@ public:
     {
         return ConstantInt::get(Type::getInt32Ty(context), value);
     }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class RealLiteralAST : public ASTNode
@@ -97,6 +115,8 @@ public:
     {
         return ConstantFP::get(context, APFloat(value));
     }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class DateLiteralAST : public ASTNode
@@ -106,16 +126,11 @@ public:
     DateLiteralAST(const std::string &val) : value(val) {}
     Value *codegen()
     {
-        Constant *strConst = ConstantDataArray::getString(context, value);
-        GlobalVariable *gvar = new GlobalVariable(
-            *module,
-            strConst->getType(),
-            true,
-            GlobalValue::PrivateLinkage,
-            strConst,
-            ".date");
-        return gvar;
+        // Same layout as a STRING, which OUTPUT and INPUT also use for dates
+        return emitStringLiteral(value);
     }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class BooleanLiteralAST : public ASTNode
@@ -127,6 +142,8 @@ public:
     {
         return ConstantInt::get(Type::getInt1Ty(context), value);
     }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 // --- Identifiers and Assignments ---
@@ -145,6 +162,8 @@ public:
         return true;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class DeclarationAST : public ASTNode
@@ -172,6 +191,8 @@ public:
         return true;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class ArrayAST : public ASTNode
@@ -179,11 +200,15 @@ class ArrayAST : public ASTNode
 public:
     IdentifierAST *identifier;
     TypeAST *type;
-    size_t firstIndex; // Size of the array
-    size_t lastIndex;
-
-    ArrayAST(IdentifierAST *id, TypeAST *t, size_t first, size_t last)
-        : identifier(id), type(t), firstIndex(first), lastIndex(last) {}
+    // First and last index of each dimension, outermost first
+    std::vector<std::pair<int, int>> bounds;
+    // The same as expressions (first, last, first, last, ...) when any bound
+    // is not a literal; they are evaluated when the declaration runs
+    std::vector<ASTNode *> boundExpressions;
+
+    // Literal bounds give a fixed array, anything else one sized at run time
+    ArrayAST(IdentifierAST *id, TypeAST *t, const std::vector<ASTNode *> &boundList);
+    bool isDynamic() const { return !boundExpressions.empty(); }
     bool semanticCheck() override
     {
         if (!type->semanticCheck())
@@ -193,15 +218,60 @@ public:
             llvm::errs() << "Semantic error: Array '" << identifier->name << "' already declared\n";
             return false;
         }
-        if (lastIndex < firstIndex)
+        // Bounds are checked when they are generated, like other expressions
+        if (isDynamic())
+        {
+            globalSymbolTable->declareSymbol(identifier->name, type->giveType(), true, bounds,
+                                             ArraySymbol::Extent::Runtime);
+            return true;
+        }
+        int64_t size = 1;
+        for (const auto &dim : bounds)
         {
-            llvm::errs() << "Semantic error: Array '" << identifier->name << "' last index less than first index\n";
+            if (dim.second < dim.first)
+            {
+                llvm::errs() << "Semantic error: Array '" << identifier->name << "' last index less than first index\n";
+                return false;
+            }
+            size *= dim.second - dim.first + 1;
+            if (size > INT32_MAX)
+            {
+                llvm::errs() << "Semantic error: Array '" << identifier->name << "' is too large\n";
+                return false;
+            }
+        }
+        globalSymbolTable->declareSymbol(identifier->name, type->giveType(), true, bounds);
+        return true;
+    }
+    Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
+};
+
+// DECLARE L : LIST OF T, an array indexed from 1 that starts empty and grows with APPEND
+class ListAST : public ASTNode
+{
+public:
+    IdentifierAST *identifier;
+    TypeAST *type;
+
+    ListAST(IdentifierAST *id, TypeAST *t) : identifier(id), type(t) {}
+    bool semanticCheck() override
+    {
+        if (!type->semanticCheck())
+            return false;
+        if (globalSymbolTable->checkDeclaration(identifier->name))
+        {
+            llvm::errs() << "Semantic error: List '" << identifier->name << "' already declared\n";
             return false;
         }
-        globalSymbolTable->declareSymbol(identifier->name, type->giveType(), true, firstIndex, lastIndex);
+        globalSymbolTable->declareSymbol(identifier->name, type->giveType(), true, {{1, 0}},
+                                         ArraySymbol::Extent::Growable);
         return true;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class AssignmentAST : public ASTNode
@@ -233,6 +303,8 @@ public:
         return true;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class ArrayAssignmentAST : public ASTNode
@@ -240,16 +312,19 @@ class ArrayAssignmentAST : public ASTNode
 public:
     IdentifierAST *identifier;
     ASTNode *expression;
-    ASTNode *index;
+    std::vector<ASTNode *> indices; // one per dimension
 
-    ArrayAssignmentAST(IdentifierAST *id, ASTNode *expr, ASTNode *index)
-        : identifier(id), expression(expr), index(index) {}
+    ArrayAssignmentAST(IdentifierAST *id, ASTNode *expr, const std::vector<ASTNode *> &indices)
+        : identifier(id), expression(expr), indices(indices) {}
     bool semanticCheck() override
     {
         if (!identifier->semanticCheck())
             return false;
-        if (!index->semanticCheck())
-            return false;
+        for (ASTNode *index : indices)
+        {
+            if (!index->semanticCheck())
+                return false;
+        }
         if (!expression->semanticCheck())
             return false;
         if (!globalSymbolTable->lookupSymbol(identifier->name))
@@ -260,22 +335,27 @@ public:
         return true;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class ArrayAccessAST : public ASTNode
 {
 public:
     IdentifierAST *identifier;
-    ASTNode *index;
-    ArrayAccessAST(IdentifierAST *id, ASTNode *index)
-        : identifier(id), index(index) {}
+    std::vector<ASTNode *> indices; // one per dimension
+    ArrayAccessAST(IdentifierAST *id, const std::vector<ASTNode *> &indices)
+        : identifier(id), indices(indices) {}
 
     bool semanticCheck() override
     {
         if (!identifier->semanticCheck())
             return false;
-        if (!index->semanticCheck())
-            return false;
+        for (ASTNode *index : indices)
+        {
+            if (!index->semanticCheck())
+                return false;
+        }
         if (!globalSymbolTable->lookupSymbol(identifier->name))
         {
             llvm::errs() << "Semantic error: Undeclared array '" << identifier->name << "'\n";
@@ -284,15 +364,25 @@ public:
         return true;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 class OutputAST : public ASTNode
 {
 public:
     std::vector<ASTNode *> expressions;
+    // One per expression: the text written between the elements of a whole
+    // array (OUTPUT A : ", "), or nullptr
+    std::vector<ASTNode *> separators;
 
     // Constructor takes a vector
     OutputAST(std::vector<ASTNode *> expressions)
-        : expressions(std::move(expressions)) {}
+        : expressions(std::move(expressions)), separators(this->expressions.size(), nullptr) {}
+    void add(ASTNode *expression, ASTNode *separator = nullptr)
+    {
+        expressions.push_back(expression);
+        separators.push_back(separator);
+    }
     bool semanticCheck() override
     {
         bool ok = true;
@@ -301,10 +391,17 @@ public:
             if (!expr->semanticCheck())
                 ok = false;
         }
+        for (ASTNode *separator : separators)
+        {
+            if (separator && !separator->semanticCheck())
+                ok = false;
+        }
         return ok;
     }
 
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class InputAST : public ASTNode
@@ -319,17 +416,60 @@ public:
         return target->semanticCheck();
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
+};
+
+// --- Files ---
+// OPENFILE f FOR READ/WRITE/APPEND, READFILE f, v, WRITEFILE f, x and
+// CLOSEFILE f, with the file named by a STRING; EOF(f) is a built-in
+enum class FileOp : uint8_t
+{
+    Open,
+    Read,
+    Write,
+    Close
+};
+
+// Same values as the runtime's SSC_FILE_READ, ...
+enum class FileMode : uint8_t
+{
+    Read,
+    Write,
+    Append
+};
+
+class FileAST : public ASTNode
+{
+public:
+    FileOp op; // op and mode pack into the base's tail padding
+    FileMode mode;
+    ASTNode *file;
+    ASTNode *operand; // the READFILE target or WRITEFILE value
+
+    FileAST(FileOp operation, ASTNode *fileName, ASTNode *value = nullptr, FileMode openMode = FileMode::Read)
+        : op(operation), mode(openMode), file(fileName), operand(value) {}
+    bool semanticCheck() override
+    {
+        bool ok = file->semanticCheck();
+        if (operand && !operand->semanticCheck())
+            ok = false;
+        return ok;
+    }
+    Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 // --- Expressions ---
 class BinaryOpAST : public ASTNode
 {
 public:
-    std::string op;
+    BinaryOp op; // packs into the base's tail padding
     ASTNode *expression1;
     ASTNode *expression2;
 
-    BinaryOpAST(ASTNode *lhs, ASTNode *rhs, std::string operation)
+    BinaryOpAST(ASTNode *lhs, ASTNode *rhs, BinaryOp operation)
         : op(operation), expression1(lhs), expression2(rhs) {}
 
     bool semanticCheck() override
@@ -345,16 +485,18 @@ public:
         return true;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class UnaryOpAST : public ASTNode
 {
 public:
+    UnaryOp op;
     ASTNode *expression;
-    std::string op;
 
-    UnaryOpAST(ASTNode *exp, std::string operation)
-        : expression(exp), op(operation) {}
+    UnaryOpAST(ASTNode *exp, UnaryOp operation)
+        : op(operation), expression(exp) {}
 
     bool semanticCheck() override
     {
@@ -365,27 +507,29 @@ public:
         Value *v = expression->codegen();
         if (!v)
             return nullptr;
-        if (op == "-")
+        if (op == UnaryOp::Negate)
         {
             if (v->getType()->isIntegerTy())
                 return builder.CreateNeg(v, "negtmp");
             else if (v->getType()->isDoubleTy())
                 return builder.CreateFNeg(v, "fnegtmp");
         }
-        errs() << "Unknown unary op: " << op << "\n";
+        errs() << "Unknown unary op: " << opSpelling(op) << "\n";
         return nullptr;
     }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class ComparisonAST : public ASTNode
 {
 public:
-    std::string cmpOp;
+    CompareOp cmpOp;
     ASTNode *LHS;
     ASTNode *RHS;
 
-    ComparisonAST(ASTNode *lhs, ASTNode *rhs, std::string op)
-        : LHS(lhs), RHS(rhs), cmpOp(op) {}
+    ComparisonAST(ASTNode *lhs, ASTNode *rhs, CompareOp op)
+        : cmpOp(op), LHS(lhs), RHS(rhs) {}
     bool semanticCheck() override
     {
         bool lhsOk = LHS->semanticCheck();
@@ -393,13 +537,20 @@ public:
         return lhsOk && rhsOk;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 class LogicalOpAST : public ComparisonAST
 {
 public:
-    LogicalOpAST(ASTNode *left, ASTNode *right, const std::string &operation)
-        : ComparisonAST(left, right, operation) {}
+    LogicalOp logicalOp;
+
+    // cmpOp is unused; conditions are typed as ComparisonAST
+    LogicalOpAST(ASTNode *left, ASTNode *right, LogicalOp operation)
+        : ComparisonAST(left, right, CompareOp::NotEqual), logicalOp(operation) {}
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 // --- Statements ---
 class StatementBlockAST : public ASTNode
@@ -418,6 +569,8 @@ public:
         return ok;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class IfAST : public ASTNode
@@ -437,6 +590,8 @@ public:
         return condOk && thenOk && elseOk;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class ForAST : public ASTNode
@@ -458,6 +613,8 @@ public:
     }
 
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class WhileAST : public ASTNode
@@ -473,6 +630,8 @@ public:
         return body->semanticCheck();
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class RepeatAST : public ASTNode
@@ -488,6 +647,8 @@ public:
         return body->semanticCheck();
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 // --- Functions and Procedures ---
@@ -508,6 +669,8 @@ public:
     {
         return nullptr;
     }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class ProcedureAST : public ASTNode
@@ -533,6 +696,11 @@ public:
     }
 
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
+    FunctionType *functionType() const;
+    std::string signature() const;
+    RoutineSignature exportSignature() const;
 };
 
 class FuncAST : public ASTNode
@@ -560,6 +728,11 @@ public:
         return ok;
     }
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
+    FunctionType *functionType() const;
+    std::string signature() const;
+    RoutineSignature exportSignature() const;
 };
 class ReturnAST : public ASTNode
 {
@@ -573,6 +746,8 @@ public:
     }
 
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 
 class FuncCallAST : public ASTNode
@@ -591,10 +766,47 @@ public:
             if (!arg->semanticCheck())
                 ok = false;
         }
-        // Add lookup for function if you maintain a procedure/function symbol table
+        // Imported routines are known before codegen, so their arity can be checked here
+        if (FunctionSymbol *func = globalSymbolTable->lookupFunction(name))
+        {
+            if (func->getParamTypes().size() != arguments.size())
+            {
+                llvm::errs() << "Semantic error: " << name << " expects " << func->getParamTypes().size()
+                             << " arguments but is called with " << arguments.size() << "\n";
+                ok = false;
+            }
+        }
         return ok;
     }
 
     Value *codegen() override;
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
+
+private:
+    bool namesArray() const;
+    Value *codegenArrayBuiltin();
+};
+
+// Generates a statement of a block or of the top level, with its source
+// location and line profile counters
+Value *codegenStatement(ASTNode *statement);
+
+// --- Modules ---
+class ImportAST : public ASTNode
+{
+public:
+    std::string moduleName;
+    std::vector<RoutineSignature> routines; // filled from the interface by semanticCheck
+
+    ImportAST(const std::string &name) : moduleName(name) {}
+    bool semanticCheck() override;
+    Value *codegen() override
+    {
+        // Declarations were created when the interface was loaded
+        return nullptr;
+    }
+    void fingerprint(Fingerprint &fp) const override;
+    void accept(ASTVisitor &visitor) override;
 };
 #endif // AST_H
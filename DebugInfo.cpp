@@ -0,0 +1,139 @@
+#include "DebugInfo.h"
+#include "Options.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/IR/DIBuilder.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+
+static std::unique_ptr<DIBuilder> dib;
+static DIFile *sourceFile = nullptr;
+// Innermost last: main, the routine being generated, then its lexical blocks
+static std::vector<DIScope *> scopes;
+// Where to go back to when a routine or block is finished
+static std::vector<DebugLoc> savedLocations;
+static std::map<Type *, DIType *> types;
+
+void initDebugInfo()
+{
+    if (!compilerOptions.debugInfo)
+        return;
+    dib.reset(new DIBuilder(*module));
+
+    SmallString<128> path(compilerOptions.inputFile ? compilerOptions.inputFile : "<stdin>");
+    if (compilerOptions.inputFile)
+        sys::fs::make_absolute(path);
+    sourceFile = dib->createFile(sys::path::filename(path), sys::path::parent_path(path));
+    // Debuggers have no notion of pseudocode; C gives the closest display of its types
+    dib->createCompileUnit(dwarf::DW_LANG_C, sourceFile, "ssc", compilerOptions.optLevel > 0, "", 0);
+    module->addModuleFlag(Module::Warning, "Debug Info Version", DEBUG_METADATA_VERSION);
+    module->addModuleFlag(Module::Warning, "Dwarf Version", 4);
+
+    DISubroutineType *mainType = dib->createSubroutineType(dib->getOrCreateTypeArray({}));
+    DISubprogram *mainScope = dib->createFunction(sourceFile, "main", StringRef(), sourceFile, 1, mainType, 1,
+                                                  DINode::FlagPrototyped, DISubprogram::SPFlagDefinition);
+    mainFunction->setSubprogram(mainScope);
+    scopes.push_back(mainScope);
+}
+
+// INTEGER, REAL, BOOLEAN, CHAR, STRING/DATE and arrays of them
+static DIType *debugType(Type *type, int firstIndex = 0)
+{
+    if (auto *array = dyn_cast<ArrayType>(type))
+    {
+        DIType *element = debugType(array->getElementType());
+        if (!element)
+            return nullptr;
+        uint64_t bits = module->getDataLayout().getTypeAllocSizeInBits(array);
+        Metadata *range = dib->getOrCreateSubrange(firstIndex, array->getNumElements());
+        return dib->createArrayType(bits, 0, element, dib->getOrCreateArray(range));
+    }
+
+    auto it = types.find(type);
+    if (it != types.end())
+        return it->second;
+    DIType *result = nullptr;
+    if (type->isIntegerTy(32))
+        result = dib->createBasicType("INTEGER", 32, dwarf::DW_ATE_signed);
+    else if (type->isDoubleTy())
+        result = dib->createBasicType("REAL", 64, dwarf::DW_ATE_float);
+    else if (type->isIntegerTy(1))
+        result = dib->createBasicType("BOOLEAN", 8, dwarf::DW_ATE_boolean);
+    else if (type->isIntegerTy(8))
+        result = dib->createBasicType("CHAR", 8, dwarf::DW_ATE_signed_char);
+    else if (type->isPointerTy())
+        result = dib->createPointerType(debugType(Type::getInt8Ty(context)),
+                                        module->getDataLayout().getPointerSizeInBits(), 0, None, "STRING");
+    types[type] = result;
+    return result;
+}
+
+void debugBeginFunction(Function *F, int line)
+{
+    if (!dib)
+        return;
+    SmallVector<Metadata *, 8> signature;
+    signature.push_back(F->getReturnType()->isVoidTy() ? nullptr : debugType(F->getReturnType()));
+    for (Argument &arg : F->args())
+        signature.push_back(debugType(arg.getType()));
+    DISubroutineType *type = dib->createSubroutineType(dib->getOrCreateTypeArray(signature));
+    DISubprogram *scope = dib->createFunction(sourceFile, F->getName(), StringRef(), sourceFile, line, type, line,
+                                              DINode::FlagPrototyped, DISubprogram::SPFlagDefinition);
+    F->setSubprogram(scope);
+
+    savedLocations.push_back(builder.getCurrentDebugLocation());
+    scopes.push_back(scope);
+    debugLocation(line);
+}
+
+static void popScope()
+{
+    scopes.pop_back();
+    builder.SetCurrentDebugLocation(savedLocations.back());
+    savedLocations.pop_back();
+}
+
+void debugEndFunction()
+{
+    if (dib)
+        popScope();
+}
+
+void debugBeginBlock(int line)
+{
+    if (!dib)
+        return;
+    savedLocations.push_back(builder.getCurrentDebugLocation());
+    scopes.push_back(dib->createLexicalBlock(scopes.back(), sourceFile, line, 0));
+}
+
+void debugEndBlock()
+{
+    if (dib)
+        popScope();
+}
+
+void debugLocation(int line)
+{
+    if (dib && line > 0)
+        builder.SetCurrentDebugLocation(DILocation::get(context, line, 0, scopes.back()));
+}
+
+void debugVariable(AllocaInst *alloca, const std::string &name, unsigned argNo, int firstIndex)
+{
+    if (!dib)
+        return;
+    DIType *type = debugType(alloca->getAllocatedType(), firstIndex);
+    DILocation *location = builder.getCurrentDebugLocation().get();
+    if (!type || !location)
+        return;
+    DILocalVariable *variable =
+        argNo ? dib->createParameterVariable(scopes.back(), name, argNo, sourceFile, location->getLine(), type)
+              : dib->createAutoVariable(scopes.back(), name, sourceFile, location->getLine(), type);
+    dib->insertDeclare(alloca, variable, dib->createExpression(), location, builder.GetInsertBlock());
+}
+
+void finishDebugInfo()
+{
+    if (dib)
+        dib->finalize();
+}
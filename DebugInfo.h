@@ -0,0 +1,27 @@
+#ifndef DEBUG_INFO_H
+#define DEBUG_INFO_H
+
+#include "common_includes.h"
+
+// DWARF debug info (-g).
+//
+// Routines (and main) get DISubprograms, statement blocks get lexical
+// blocks, every statement sets the builder's location to its .ssc line, and
+// variables allocated through the symbol table become DILocalVariables.
+// All of these do nothing without -g.
+
+// Creates the compile unit and main's subprogram; called after initLLVM
+void initDebugInfo();
+// Called with the builder at the start of F's entry block; routines nest
+void debugBeginFunction(Function *F, int line);
+void debugEndFunction();
+void debugBeginBlock(int line);
+void debugEndBlock();
+// Sets the location of the instructions generated from here on
+void debugLocation(int line);
+// Describes an alloca; argNo is the 1-based parameter number, 0 for a local
+void debugVariable(AllocaInst *alloca, const std::string &name, unsigned argNo = 0, int firstIndex = 0);
+// Resolves the debug metadata; must run before the module is cloned or verified
+void finishDebugInfo();
+
+#endif // DEBUG_INFO_H
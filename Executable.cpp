@@ -0,0 +1,156 @@
+#include "Executable.h"
+#include "ModuleInterface.h"
+#include "Options.h"
+#include "Target.h"
+#include <lld/Common/Driver.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Target/TargetOptions.h>
+
+// Where glibc systems keep crt1.o and libc for a target
+struct SystemLibraries
+{
+    std::vector<std::string> dirs;
+    std::string dynamicLinker;
+};
+
+static SystemLibraries systemLibraries(const Triple &triple)
+{
+    SystemLibraries libs;
+    std::string multiarch = triple.getArchName().str() + "-linux-gnu";
+    for (const char *dir : {"/usr/lib/", "/lib/"})
+        libs.dirs.push_back(dir + multiarch);
+    libs.dirs.push_back(triple.isArch64Bit() ? "/usr/lib64" : "/usr/lib32");
+    libs.dirs.push_back("/usr/lib");
+    libs.dirs.push_back("/lib");
+
+    switch (triple.getArch())
+    {
+    case Triple::x86_64:
+        libs.dynamicLinker = "/lib64/ld-linux-x86-64.so.2";
+        break;
+    case Triple::aarch64:
+        libs.dynamicLinker = "/lib/ld-linux-aarch64.so.1";
+        break;
+    case Triple::x86:
+        libs.dynamicLinker = "/lib/ld-linux.so.2";
+        break;
+    default:
+        break;
+    }
+    return libs;
+}
+
+static std::string findFile(const std::vector<std::string> &dirs, const std::string &name)
+{
+    for (const std::string &dir : dirs)
+    {
+        SmallString<128> path(dir);
+        sys::path::append(path, name);
+        if (sys::fs::exists(path))
+            return std::string(path.str());
+    }
+    return "";
+}
+
+// Compiles M to an object file at path
+static bool emitObject(Module &M, const std::string &path)
+{
+    TargetOptions options;
+    // The runtime's output flush runs from .fini_array, which glibc runs without crtbegin.o
+    options.UseInitArray = true;
+    options.FunctionSections = true;
+    options.DataSections = true;
+    CodeGenOpt::Level level = compilerOptions.optLevel == 0 ? CodeGenOpt::None : CodeGenOpt::Default;
+    std::unique_ptr<TargetMachine> machine = createTargetMachine(M.getTargetTriple(), level, options);
+    if (!machine)
+        return false;
+    M.setDataLayout(machine->createDataLayout());
+
+    std::error_code ec;
+    raw_fd_ostream file(path, ec, sys::fs::OF_None);
+    if (ec)
+    {
+        errs() << "Cannot write " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+    legacy::PassManager passes;
+    if (machine->addPassesToEmitFile(passes, file, nullptr, CGFT_ObjectFile))
+    {
+        errs() << "The target cannot emit object files\n";
+        return false;
+    }
+    passes.run(M);
+    file.close();
+    return !file.has_error();
+}
+
+bool linkExecutable(Module &M, const std::string &path)
+{
+    if (verifyModule(M, &errs()))
+    {
+        errs() << "Module verification failed, not linking\n";
+        return false;
+    }
+    // atexit in libc_nonshared.a refers to __dso_handle, which crtbegin.o
+    // would define; the program is a single object, so it defines it itself
+    if (!M.getNamedValue("__dso_handle"))
+    {
+        auto *handle = new GlobalVariable(M, Type::getInt8Ty(M.getContext()), true, GlobalValue::ExternalLinkage,
+                                          ConstantInt::get(Type::getInt8Ty(M.getContext()), 0), "__dso_handle");
+        handle->setVisibility(GlobalValue::HiddenVisibility);
+    }
+
+    SmallString<128> object;
+    if (std::error_code ec = sys::fs::createTemporaryFile("ssc", "o", object))
+    {
+        errs() << "Cannot create a temporary object file: " << ec.message() << "\n";
+        return false;
+    }
+    if (!emitObject(M, std::string(object.str())))
+    {
+        sys::fs::remove(object);
+        return false;
+    }
+
+    SystemLibraries libs = systemLibraries(Triple(M.getTargetTriple()));
+    std::string crt1 = findFile(libs.dirs, "Scrt1.o");
+    std::string crti = findFile(libs.dirs, "crti.o");
+    std::string crtn = findFile(libs.dirs, "crtn.o");
+    if (crt1.empty() || crti.empty() || crtn.empty() || libs.dynamicLinker.empty())
+    {
+        errs() << "Cannot find the C startup files (Scrt1.o, crti.o, crtn.o) for " << M.getTargetTriple() << "\n";
+        sys::fs::remove(object);
+        return false;
+    }
+
+    std::vector<std::string> args = {"ld.lld", "-o", path, "-pie", "--eh-frame-hdr", "--hash-style=gnu",
+                                     "--gc-sections", "--as-needed", "-O1", "-dynamic-linker", libs.dynamicLinker,
+                                     crt1, crti, std::string(object.str())};
+    if (!compilerOptions.debugInfo)
+        args.push_back("--strip-all");
+    // An IMPORTed module's object sits next to its interface
+    for (const std::string &iface : importedInterfaces())
+    {
+        SmallString<128> moduleObject(iface);
+        sys::path::replace_extension(moduleObject, "o");
+        args.push_back(std::string(moduleObject.str()));
+    }
+    for (const std::string &dir : libs.dirs)
+        args.push_back("-L" + dir);
+    args.insert(args.end(), {"-lm", "-lc", crtn});
+
+    std::vector<const char *> argv;
+    for (const std::string &arg : args)
+        argv.push_back(arg.c_str());
+    bool linked = lld::elf::link(argv, outs(), errs(), /*exitEarly=*/false, /*disableOutput=*/false);
+    sys::fs::remove(object);
+    if (!linked)
+    {
+        errs() << "Linking " << path << " failed\n";
+        return false;
+    }
+    fprintf(stderr, "Linked %s\n", path.c_str());
+    return true;
+}
@@ -0,0 +1,19 @@
+#ifndef EXECUTABLE_H
+#define EXECUTABLE_H
+
+#include "common_includes.h"
+
+// Executables built in-process (-o FILE).
+//
+// The module, with the embedded runtime already linked in and optimized,
+// is compiled to an object through a TargetMachine and linked with lld's
+// ELF driver inside the compiler, so no llc, clang++ or ld runs. The link
+// only adds the C startup files, libc and libm (plus the .o of every
+// IMPORTed module), found in the usual system directories, and drops
+// unused sections; unless -g is given the result is stripped. Programs no
+// longer carry the LLVM libraries the Makefile used to link into them.
+
+// Writes the executable for M to path; false after reporting an error
+bool linkExecutable(Module &M, const std::string &path);
+
+#endif // EXECUTABLE_H
@@ -1,4 +1,6 @@
 #include "IR.h"
+#include "Options.h"
+#include "Strings.h"
 
 extern char *yytext;
 extern int yylineno;
@@ -54,7 +56,10 @@ void printLLVMIR()
     // Check if the main function has any basic blocks
     if (mainFunction == nullptr)
     {
-        fprintf(stderr, "Error: Main function is null\n");
+        if (compilerOptions.moduleMode)
+            fprintf(stderr, "Compiled as a module, no main function\n");
+        else
+            fprintf(stderr, "Error: Main function is null\n");
     }
     else if (mainFunction->empty())
     {
@@ -81,104 +86,112 @@ void printLLVMIR()
     module->print(outs(), nullptr);
 }
 
-void printfLLVM(const char *format, Value *inputValue)
+const char *opSpelling(BinaryOp op)
 {
-    Function *printfFunc = module->getFunction("printf");
-    if (!printfFunc)
-    {
-        FunctionType *printfTy = FunctionType::get(builder.getInt32Ty(), PointerType::get(builder.getInt8Ty(), 0), true);
-        printfFunc = Function::Create(printfTy, Function::ExternalLinkage, "printf", module);
-    }
-    Value *formatVal = builder.CreateGlobalStringPtr(format);
-    builder.CreateCall(printfFunc, {formatVal, inputValue}, "printfCall");
+    static const char *const spellings[] = {"+", "-", "*", "/", "++", "--", "&"};
+    return spellings[static_cast<unsigned>(op)];
 }
 
-Value *performBinaryOperation(Value *lhs, Value *rhs, const std::string &op)
+const char *opSpelling(UnaryOp op)
+{
+    static const char *const spellings[] = {"-"};
+    return spellings[static_cast<unsigned>(op)];
+}
+
+const char *opSpelling(CompareOp op)
+{
+    static const char *const spellings[] = {"<", ">", "==", "<=", ">=", "!="};
+    return spellings[static_cast<unsigned>(op)];
+}
+
+const char *opSpelling(LogicalOp op)
+{
+    static const char *const spellings[] = {"AND", "OR", "NOT"};
+    return spellings[static_cast<unsigned>(op)];
+}
+
+// Lowering of each BinaryOp; ++ and -- add or subtract a constant 1
+struct ArithmeticLowering
+{
+    Instruction::BinaryOps intOp;
+    Instruction::BinaryOps floatOp;
+    const char *intName;
+    const char *floatName;
+};
+
+static const ArithmeticLowering arithmeticTable[] = {
+    {Instruction::Add, Instruction::FAdd, "addtmp", "faddtmp"},         // Add
+    {Instruction::Sub, Instruction::FSub, "subtmp", "fsubtmp"},         // Subtract
+    {Instruction::Mul, Instruction::FMul, "multmp", "fmultmp"},         // Multiply
+    {Instruction::SDiv, Instruction::FDiv, "divtmp", "fdivtmp"},        // Divide
+    {Instruction::Add, Instruction::FAdd, "increment", "fincrement"},   // Increment
+    {Instruction::Sub, Instruction::FSub, "decrement", "fdecrement"},   // Decrement
+};
+
+// Lowering of each CompareOp
+struct ComparisonLowering
+{
+    CmpInst::Predicate intPredicate;
+    CmpInst::Predicate floatPredicate;
+    const char *intName;
+    const char *floatName;
+};
+
+static const ComparisonLowering comparisonTable[] = {
+    {CmpInst::ICMP_SLT, CmpInst::FCMP_ULT, "iless", "fless"},                   // Less
+    {CmpInst::ICMP_SGT, CmpInst::FCMP_UGT, "igreater", "fgreater"},             // Greater
+    {CmpInst::ICMP_EQ, CmpInst::FCMP_UEQ, "iequal", "fequal"},                  // Equal
+    {CmpInst::ICMP_SLE, CmpInst::FCMP_ULE, "ilessequal", "flessequal"},         // LessEqual
+    {CmpInst::ICMP_SGE, CmpInst::FCMP_UGE, "igreaterequal", "fgreaterequal"},   // GreaterEqual
+    {CmpInst::ICMP_NE, CmpInst::FCMP_UNE, "inotequal", "fnotequal"},            // NotEqual
+};
+
+Value *performBinaryOperation(Value *lhs, Value *rhs, BinaryOp op)
 {
     Type *type = lhs->getType();
+    bool step = op == BinaryOp::Increment || op == BinaryOp::Decrement;
 
     // Binary operation: Check operand types
-    if (!rhs && op != "++" && op != "--")
+    if (!rhs && !step)
     {
-        yyerror(("Missing right-hand operand for binary operator: " + op).c_str());
+        yyerror((std::string("Missing right-hand operand for binary operator: ") + opSpelling(op)).c_str());
         exit(EXIT_FAILURE);
     }
 
-    if (type->isIntegerTy())
-    {
-        if (op == "++")
-            return builder.CreateAdd(lhs, ConstantInt::get(type, 1), "increment");
-        if (op == "--")
-            return builder.CreateSub(lhs, ConstantInt::get(type, 1), "decrement");
-        if (op == "+")
-            return builder.CreateAdd(lhs, rhs, "addtmp");
-        if (op == "-")
-            return builder.CreateSub(lhs, rhs, "subtmp");
-        if (op == "*")
-            return builder.CreateMul(lhs, rhs, "multmp");
-        if (op == "/")
-            return builder.CreateSDiv(lhs, rhs, "divtmp");
-    }
-    else if (type->isFloatingPointTy())
+    if (op != BinaryOp::Concat && (type->isIntegerTy() || type->isFloatingPointTy()))
     {
-        if (op == "++")
-            return builder.CreateFAdd(lhs, ConstantFP::get(type, 1.0), "fincrement");
-        if (op == "--")
-            return builder.CreateFSub(lhs, ConstantFP::get(type, 1.0), "fdecrement");
-        if (op == "+")
-            return builder.CreateFAdd(lhs, rhs, "faddtmp");
-        if (op == "-")
-            return builder.CreateFSub(lhs, rhs, "fsubtmp");
-        if (op == "*")
-            return builder.CreateFMul(lhs, rhs, "fmultmp");
-        if (op == "/")
-            return builder.CreateFDiv(lhs, rhs, "fdivtmp");
+        const ArithmeticLowering &lowering = arithmeticTable[static_cast<unsigned>(op)];
+        bool isFloat = type->isFloatingPointTy();
+        if (step)
+            rhs = isFloat ? ConstantFP::get(type, 1.0) : ConstantInt::get(type, 1);
+        return builder.CreateBinOp(isFloat ? lowering.floatOp : lowering.intOp, lhs, rhs,
+                                   isFloat ? lowering.floatName : lowering.intName);
     }
 
-    yyerror(("Unsupported or illegal operator: " + op).c_str());
+    yyerror((std::string("Unsupported or illegal operator: ") + opSpelling(op)).c_str());
     exit(EXIT_FAILURE);
 }
 
-Value *performComparison(Value *lhs, Value *rhs, const std::string &op)
+Value *performComparison(Value *lhs, Value *rhs, CompareOp op)
 {
-    // Floating-point comparison
-    if (lhs->getType()->isFloatingPointTy() && rhs->getType()->isFloatingPointTy())
+    // STRING comparison; a CHAR compared with a STRING counts as a one-character STRING
+    if (lhs->getType()->isPointerTy() || rhs->getType()->isPointerTy())
     {
-        if (op == "<")
-            return builder.CreateFCmpULT(lhs, rhs, "fless");
-        if (op == ">")
-            return builder.CreateFCmpUGT(lhs, rhs, "fgreater");
-        if (op == "==")
-            return builder.CreateFCmpUEQ(lhs, rhs, "fequal");
-        if (op == "<=")
-            return builder.CreateFCmpULE(lhs, rhs, "flessequal");
-        if (op == ">=")
-            return builder.CreateFCmpUGE(lhs, rhs, "fgreaterequal");
-        if (op == "!=")
-            return builder.CreateFCmpUNE(lhs, rhs, "fnotequal");
-
-        yyerror("illegal floating-point comparison operation");
-        exit(EXIT_FAILURE);
+        Value *result = emitStringComparison(lhs, rhs, op);
+        if (!result)
+        {
+            yyerror("illegal string comparison");
+            exit(EXIT_FAILURE);
+        }
+        return result;
     }
+    const ComparisonLowering &lowering = comparisonTable[static_cast<unsigned>(op)];
+    // Floating-point comparison
+    if (lhs->getType()->isFloatingPointTy() && rhs->getType()->isFloatingPointTy())
+        return builder.CreateFCmp(lowering.floatPredicate, lhs, rhs, lowering.floatName);
     // Integer comparison
     else if (lhs->getType()->isIntegerTy() && rhs->getType()->isIntegerTy())
-    {
-        if (op == "<")
-            return builder.CreateICmpSLT(lhs, rhs, "iless");
-        if (op == ">")
-            return builder.CreateICmpSGT(lhs, rhs, "igreater");
-        if (op == "==")
-            return builder.CreateICmpEQ(lhs, rhs, "iequal");
-        if (op == "<=")
-            return builder.CreateICmpSLE(lhs, rhs, "ilessequal");
-        if (op == ">=")
-            return builder.CreateICmpSGE(lhs, rhs, "igreaterequal");
-        if (op == "!=")
-            return builder.CreateICmpNE(lhs, rhs, "inotequal");
-
-        yyerror("illegal integer comparison operation");
-        exit(EXIT_FAILURE);
-    }
+        return builder.CreateICmp(lowering.intPredicate, lhs, rhs, lowering.intName);
     else
     {
         yyerror("comparison between incompatible types");
@@ -201,7 +214,6 @@ void yyerror(const char *s)
 
     // Print indentation state
     fprintf(stderr, "Current indentation level: %d\n", current_indent);
-    fprintf(stderr, "Indentation stack size: %zu\n", indent_stack.size());
-    fprintf(stderr, "Start of line: %s\n", start_of_line ? "true" : "false");
-    fprintf(stderr, "Dedent buffer size: %zu\n\n", dedent_buffer.size());
+    fprintf(stderr, "Open blocks: %d\n", indent_depth);
+    fprintf(stderr, "Pending dedents: %d\n\n", pending_dedents);
 }
\ No newline at end of file
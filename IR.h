@@ -3,18 +3,27 @@
 
 #include "common_includes.h" // Centralized includes
 #include "Symbol_Table.h"
-#include <stack>
-#include <queue>
 
-// External declarations for indentation tracking
-extern std::stack<int> indent_stack;
-extern std::queue<int> dedent_buffer;
+// External declarations for indentation tracking (ssc.l)
+extern int indent_depth;
 extern int current_indent;
-extern bool start_of_line;
+extern int pending_dedents;
 extern SymbolTable *globalSymbolTable;
 
-Value *performBinaryOperation(Value *lhs, Value *rhs, const std::string &op);
-Value *performComparison(Value *lhs, Value *rhs, const std::string &op); 
+// Operator opcodes stored in the AST; the lowering tables in IR.cpp are indexed by them
+enum class BinaryOp : uint8_t { Add, Subtract, Multiply, Divide, Increment, Decrement, Concat };
+enum class UnaryOp : uint8_t { Negate };
+enum class CompareOp : uint8_t { Less, Greater, Equal, LessEqual, GreaterEqual, NotEqual };
+enum class LogicalOp : uint8_t { And, Or, Not };
+
+// Source spelling of an operator, for messages and fingerprints
+const char *opSpelling(BinaryOp op);
+const char *opSpelling(UnaryOp op);
+const char *opSpelling(CompareOp op);
+const char *opSpelling(LogicalOp op);
+
+Value *performBinaryOperation(Value *lhs, Value *rhs, BinaryOp op);
+Value *performComparison(Value *lhs, Value *rhs, CompareOp op);
 void yyerror(const char *err);
 void initLLVM();
 void printLLVMIR();
@@ -0,0 +1,530 @@
+#include "Incremental.h"
+#include "Options.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+// ───────────────────────────────────────────
+// Fingerprint
+
+void Fingerprint::add(llvm::StringRef text)
+{
+    // Length prefix keeps "ab","c" distinct from "a","bc"
+    add(static_cast<int64_t>(text.size()));
+    hasher.update(text);
+}
+
+void Fingerprint::add(int64_t value)
+{
+    hasher.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&value), sizeof(value)));
+}
+
+void Fingerprint::add(double value)
+{
+    hasher.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&value), sizeof(value)));
+}
+
+void Fingerprint::addNode(const ASTNode *node)
+{
+    if (!node)
+    {
+        add("<null>");
+        return;
+    }
+    // Line counters and debug locations refer to source lines, so moving a statement changes its code
+    if (compilerOptions.profileLines || compilerOptions.debugInfo)
+        add(static_cast<int64_t>(node->line));
+    node->fingerprint(*this);
+}
+
+std::string Fingerprint::digest()
+{
+    llvm::MD5::MD5Result result;
+    hasher.final(result);
+    return std::string(result.digest().str());
+}
+
+// ───────────────────────────────────────────
+// AST node fingerprints
+
+void TypeAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Type");
+    fp.add(type);
+}
+
+void CharLiteralAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Char");
+    fp.add(static_cast<int64_t>(value));
+}
+
+void StringLiteralAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("String");
+    fp.add(value);
+}
+
+void IntegerLiteralAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Integer");
+    fp.add(static_cast<int64_t>(value));
+}
+
+void RealLiteralAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Real");
+    fp.add(value);
+}
+
+void DateLiteralAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Date");
+    fp.add(value);
+}
+
+void BooleanLiteralAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Boolean");
+    fp.add(static_cast<int64_t>(value));
+}
+
+void IdentifierAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Identifier");
+    fp.add(name);
+}
+
+void DeclarationAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Declaration");
+    fp.addNode(identifier);
+    fp.addNode(type);
+}
+
+void ArrayAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Array");
+    fp.addNode(identifier);
+    fp.addNode(type);
+    fp.add(static_cast<int64_t>(bounds.size()));
+    for (const auto &dim : bounds)
+    {
+        fp.add(static_cast<int64_t>(dim.first));
+        fp.add(static_cast<int64_t>(dim.second));
+    }
+    for (const ASTNode *bound : boundExpressions)
+        fp.addNode(bound);
+}
+
+void ListAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("List");
+    fp.addNode(identifier);
+    fp.addNode(type);
+}
+
+void AssignmentAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Assignment");
+    fp.addNode(identifier);
+    fp.addNode(expression);
+}
+
+void ArrayAssignmentAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("ArrayAssignment");
+    fp.addNode(identifier);
+    fp.add(static_cast<int64_t>(indices.size()));
+    for (const ASTNode *index : indices)
+        fp.addNode(index);
+    fp.addNode(expression);
+}
+
+void ArrayAccessAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("ArrayAccess");
+    fp.addNode(identifier);
+    fp.add(static_cast<int64_t>(indices.size()));
+    for (const ASTNode *index : indices)
+        fp.addNode(index);
+}
+
+void OutputAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Output");
+    fp.add(static_cast<int64_t>(expressions.size()));
+    for (size_t i = 0; i < expressions.size(); ++i)
+    {
+        fp.addNode(expressions[i]);
+        fp.addNode(separators[i]);
+    }
+}
+
+void InputAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Input");
+    fp.addNode(target);
+}
+
+void FileAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("File");
+    fp.add(static_cast<int64_t>(op));
+    fp.add(static_cast<int64_t>(mode));
+    fp.addNode(file);
+    fp.addNode(operand);
+}
+
+void BinaryOpAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("BinaryOp");
+    fp.add(opSpelling(op));
+    fp.addNode(expression1);
+    fp.addNode(expression2);
+}
+
+void UnaryOpAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("UnaryOp");
+    fp.add(opSpelling(op));
+    fp.addNode(expression);
+}
+
+void ComparisonAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Comparison");
+    fp.add(opSpelling(cmpOp));
+    fp.addNode(LHS);
+    fp.addNode(RHS);
+}
+
+void LogicalOpAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("LogicalOp");
+    fp.add(opSpelling(logicalOp));
+    fp.addNode(LHS);
+    fp.addNode(RHS);
+}
+
+void StatementBlockAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Block");
+    fp.add(static_cast<int64_t>(statements.size()));
+    for (ASTNode *stmt : statements)
+        fp.addNode(stmt);
+}
+
+void IfAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("If");
+    fp.addNode(condition);
+    fp.addNode(thenBlock);
+    fp.addNode(elseBlock);
+}
+
+void ForAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("For");
+    fp.addNode(assignment);
+    fp.addNode(condition);
+    fp.addNode(step);
+    fp.addNode(forBlock);
+}
+
+void WhileAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("While");
+    fp.addNode(condition);
+    fp.addNode(body);
+}
+
+void RepeatAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Repeat");
+    fp.addNode(condition);
+    fp.addNode(body);
+}
+
+void ParameterAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Parameter");
+    fp.addNode(type);
+    fp.add(name);
+}
+
+void ProcedureAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Procedure");
+    fp.addNode(Identifier);
+    fp.add(static_cast<int64_t>(parameters.size()));
+    for (auto *param : parameters)
+        fp.addNode(param);
+    fp.addNode(statementsBlock);
+}
+
+void FuncAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Function");
+    fp.addNode(Identifier);
+    fp.add(static_cast<int64_t>(parameters.size()));
+    for (auto *param : parameters)
+        fp.addNode(param);
+    fp.addNode(returnType);
+    fp.addNode(statementsBlock);
+}
+
+void ReturnAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Return");
+    fp.addNode(expression);
+}
+
+void FuncCallAST::fingerprint(Fingerprint &fp) const
+{
+    fp.add("Call");
+    fp.add(name);
+    fp.add(static_cast<int64_t>(arguments.size()));
+    for (ASTNode *arg : arguments)
+        fp.addNode(arg);
+    fp.addCallee(name);
+}
+
+void ImportAST::fingerprint(Fingerprint &fp) const
+{
+    // Callers must be regenerated when an imported signature changes
+    fp.add("Import");
+    fp.add(moduleName);
+    for (const RoutineSignature &routine : routines)
+    {
+        fp.add(routine.name);
+        fp.add(routine.returnType);
+        for (const std::string &param : routine.paramTypes)
+            fp.add(param);
+    }
+}
+
+// ───────────────────────────────────────────
+// IncrementalCache
+
+static const char *const MainUnit = "main";
+
+// Name of the routine defined by a top-level node, empty for plain statements
+static std::string routineName(const ASTNode *node)
+{
+    if (auto *proc = dynamic_cast<const ProcedureAST *>(node))
+        return proc->Identifier->name;
+    if (auto *func = dynamic_cast<const FuncAST *>(node))
+        return func->Identifier->name;
+    return "";
+}
+
+// The signature of a routine from an IMPORTed module's interface, in the
+// form ProcedureAST::signature and FuncAST::signature give
+static std::string importedSignature(const std::string &moduleName, const RoutineSignature &routine)
+{
+    std::string sig = "IMPORT " + moduleName + (routine.returnType.empty() ? " PROCEDURE " : " FUNCTION ");
+    sig += routine.name + "(";
+    for (size_t i = 0; i < routine.paramTypes.size(); ++i)
+        sig += (i ? "," : "") + routine.paramTypes[i];
+    sig += ")";
+    if (!routine.returnType.empty())
+        sig += " RETURNS " + routine.returnType;
+    return sig;
+}
+
+IncrementalCache::IncrementalCache(const std::string &dir) : cacheDir(dir)
+{
+    if (std::error_code ec = llvm::sys::fs::create_directories(cacheDir))
+        llvm::errs() << "Incremental: cannot create cache directory " << cacheDir << ": " << ec.message() << "\n";
+}
+
+void IncrementalCache::plan(const std::vector<ASTNode *> &program)
+{
+    for (ASTNode *node : program)
+    {
+        if (auto *proc = dynamic_cast<ProcedureAST *>(node))
+            signatures[proc->Identifier->name] = proc->signature();
+        else if (auto *func = dynamic_cast<FuncAST *>(node))
+            signatures[func->Identifier->name] = func->signature();
+    }
+    // Routines of IMPORTed modules, so a caller's key changes with the .ssci;
+    // a routine the program defines itself wins
+    for (ASTNode *node : program)
+    {
+        if (auto *import = dynamic_cast<ImportAST *>(node))
+        {
+            for (const RoutineSignature &routine : import->routines)
+                signatures.emplace(routine.name, importedSignature(import->moduleName, routine));
+        }
+    }
+
+    // Mixes the signatures of everything the unit calls into its key; only
+    // names neither defined nor imported stay a bare extern
+    auto finishKey = [&](Fingerprint &fp)
+    {
+        for (const std::string &callee : fp.getCallees())
+        {
+            auto it = signatures.find(callee);
+            fp.add(it != signatures.end() ? it->second : "extern " + callee);
+        }
+        return fp.digest();
+    };
+
+    Fingerprint mainFp;
+    mainFp.add(codegenFingerprint());
+    for (ASTNode *node : program)
+    {
+        std::string name = routineName(node);
+        if (name.empty())
+        {
+            mainFp.addNode(node);
+            continue;
+        }
+
+        Fingerprint fp;
+        fp.add(codegenFingerprint());
+        fp.addNode(node);
+        Unit &unit = units[name];
+        unit.name = name;
+        unit.key = finishKey(fp);
+    }
+    Unit &mainUnit = units[MainUnit];
+    mainUnit.name = MainUnit;
+    mainUnit.key = finishKey(mainFp);
+
+    size_t reused = 0;
+    for (auto &entry : units)
+    {
+        Unit &unit = entry.second;
+        unit.cached = llvm::sys::fs::exists(unitPath(unit));
+        if (unit.cached)
+            reused++;
+        llvm::errs() << "Incremental: " << unit.name << (unit.cached ? " up to date" : " changed") << "\n";
+    }
+    llvm::errs() << "Incremental: reusing " << reused << " of " << units.size() << " units\n";
+}
+
+bool IncrementalCache::skipCodegen(ASTNode *node)
+{
+    std::string name = routineName(node);
+    if (name.empty())
+        return units[MainUnit].cached;
+
+    const Unit &unit = units[name];
+    if (!unit.cached)
+        return false;
+
+    // Callers only need the declaration; the body comes from the cache
+    FunctionType *funcType = nullptr;
+    if (auto *proc = dynamic_cast<ProcedureAST *>(node))
+        funcType = proc->functionType();
+    else
+        funcType = static_cast<FuncAST *>(node)->functionType();
+    Function::Create(funcType, Function::ExternalLinkage, name, *module);
+    return true;
+}
+
+bool IncrementalCache::finish()
+{
+    bool ok = true;
+    for (auto &entry : units)
+    {
+        if (!entry.second.cached && !writeUnit(entry.second))
+            ok = false;
+    }
+
+    if (units[MainUnit].cached)
+    {
+        builder.ClearInsertionPoint();
+        mainFunction->deleteBody();
+    }
+
+    for (auto &entry : units)
+    {
+        if (entry.second.cached && !linkUnit(entry.second))
+            ok = false;
+    }
+
+    // Linking may replace declarations with the cached definitions
+    mainFunction = module->getFunction(MainUnit);
+    return ok;
+}
+
+std::string IncrementalCache::unitPath(const Unit &unit) const
+{
+    llvm::SmallString<128> path(cacheDir);
+    llvm::sys::path::append(path, unit.name + "-" + unit.key + ".bc");
+    return std::string(path.str());
+}
+
+bool IncrementalCache::writeUnit(const Unit &unit)
+{
+    // Drop stale versions of this unit so the cache holds one entry per routine
+    std::error_code ec;
+    std::string prefix = unit.name + "-";
+    for (llvm::sys::fs::directory_iterator it(cacheDir, ec), end; it != end && !ec; it.increment(ec))
+    {
+        llvm::StringRef file = llvm::sys::path::filename(it->path());
+        if (file.startswith(prefix) && file.endswith(".bc") &&
+            file.size() == prefix.size() + unit.key.size() + 3)
+            llvm::sys::fs::remove(it->path());
+    }
+
+    // Keep only this unit's body; every other function becomes a declaration
+    ValueToValueMapTy vmap;
+    std::unique_ptr<Module> unitModule = CloneModule(*module, vmap, [&](const GlobalValue *gv)
+                                                     {
+        if (auto *func = dyn_cast<Function>(gv))
+            return func->getName() == unit.name;
+        return true; });
+
+    std::vector<GlobalVariable *> unused;
+    for (GlobalVariable &gv : unitModule->globals())
+    {
+        if (gv.hasLocalLinkage() && gv.use_empty())
+            unused.push_back(&gv);
+    }
+    for (GlobalVariable *gv : unused)
+        gv->eraseFromParent();
+
+    std::string path = unitPath(unit);
+    raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+    if (ec)
+    {
+        llvm::errs() << "Incremental: cannot write " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+    WriteBitcodeToFile(*unitModule, out);
+    return true;
+}
+
+bool IncrementalCache::linkUnit(const Unit &unit)
+{
+    std::string path = unitPath(unit);
+    auto buffer = MemoryBuffer::getFile(path);
+    if (!buffer)
+    {
+        llvm::errs() << "Incremental: cannot read " << path << ": " << buffer.getError().message() << "\n";
+        return false;
+    }
+
+    Expected<std::unique_ptr<Module>> unitModule = parseBitcodeFile(buffer.get()->getMemBufferRef(), context);
+    if (!unitModule)
+    {
+        llvm::errs() << "Incremental: bad bitcode in " << path << ": " << toString(unitModule.takeError()) << "\n";
+        return false;
+    }
+
+    if (Linker::linkModules(*module, std::move(*unitModule)))
+    {
+        llvm::errs() << "Incremental: failed to link " << path << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "AST.h"
+#include <llvm/Support/MD5.h>
+#include <set>
+
+// Accumulates a structural hash of an AST subtree
+class Fingerprint
+{
+public:
+    void add(llvm::StringRef text);
+    void add(int64_t value);
+    void add(double value);
+    void addNode(const ASTNode *node);
+
+    // Routines called from the hashed subtree; their signatures become part of the key
+    void addCallee(const std::string &name) { callees.insert(name); }
+    const std::set<std::string> &getCallees() const { return callees; }
+
+    std::string digest();
+
+private:
+    llvm::MD5 hasher;
+    std::set<std::string> callees;
+};
+
+// Incremental compilation at PROCEDURE/FUNCTION granularity.
+//
+// Every routine is a unit keyed by the hash of its body and the signatures
+// of the routines it calls; the top-level statements form the "main" unit.
+// Units whose key is found in the cache directory are not generated again:
+// the routine is only declared and its cached bitcode is linked back in.
+class IncrementalCache
+{
+public:
+    explicit IncrementalCache(const std::string &dir);
+
+    // Computes unit keys for the whole program (after semantic checks)
+    void plan(const std::vector<ASTNode *> &program);
+
+    // Returns true when codegen of this top-level node can be skipped;
+    // cached routines are declared in the module instead
+    bool skipCodegen(ASTNode *node);
+
+    // Writes regenerated units to the cache and links cached units into the module
+    bool finish();
+
+private:
+    struct Unit
+    {
+        std::string name;
+        std::string key;
+        bool cached = false;
+    };
+
+    std::string cacheDir;
+    std::map<std::string, Unit> units;
+    std::map<std::string, std::string> signatures;
+
+    std::string unitPath(const Unit &unit) const;
+    bool writeUnit(const Unit &unit);
+    bool linkUnit(const Unit &unit);
+};
+
+#endif // INCREMENTAL_H
@@ -0,0 +1,1426 @@
+#include "Interpreter.h"
+#include "AST.h"
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <typeinfo>
+
+// The I/O and RAND routines of ssc_runtime.c, linked into the compiler natively
+extern "C"
+{
+    void ssc_flush(void);
+    void ssc_output_bytes(const char *s, size_t n);
+    void ssc_output_int(int32_t value);
+    void ssc_output_real(double value);
+    void ssc_output_char(int32_t c);
+    void ssc_output_bool(int32_t value);
+    void ssc_input_int(int32_t *target);
+    void ssc_input_real(double *target);
+    void ssc_input_char(char *target);
+    void ssc_input_str(char **target);
+    void ssc_str_store(char **slot, char *value);
+    int32_t ssc_str_length(const char *s);
+    double ssc_rand(int32_t limit);
+}
+
+// --- AST to bytecode ---
+
+namespace
+{
+    struct Operand
+    {
+        VType type;
+        int32_t reg; // in the STRING registers when type is String
+    };
+
+    struct Variable
+    {
+        VType type;
+        int32_t reg = -1;   // scalars
+        int32_t array = -1; // arrays
+        std::vector<std::pair<int, int>> bounds;
+    };
+
+    struct Routine
+    {
+        int32_t index;
+        const ASTNode *definition;
+    };
+
+    bool vtypeOf(const std::string &name, VType &type)
+    {
+        static const std::map<std::string, VType> types = {
+            {"INTEGER", VType::Int}, {"REAL", VType::Real}, {"BOOLEAN", VType::Bool},
+            {"CHAR", VType::Char}, {"STRING", VType::String}};
+        auto it = types.find(name);
+        if (it == types.end())
+            return false;
+        type = it->second;
+        return true;
+    }
+
+    class BytecodeCompiler
+    {
+    public:
+        explicit BytecodeCompiler(BytecodeProgram &program) : program(program) {}
+
+        bool compile(const std::vector<ASTNode *> &statements)
+        {
+            program.functions.emplace_back();
+            program.functions[0].name = "main";
+            // Routines can be called before their definition
+            for (ASTNode *node : statements)
+                if (!declareRoutine(node))
+                    return false;
+            fn = &program.functions[0];
+            scopes.emplace_back();
+            for (ASTNode *node : statements)
+                if (!statement(node))
+                    return false;
+            emit(Op::Halt);
+            return true;
+        }
+
+        const std::string &getError() const { return error; }
+
+    private:
+        BytecodeProgram &program;
+        BytecodeFunction *fn = nullptr;
+        const FuncAST *currentFunction = nullptr;
+        std::vector<std::map<std::string, Variable>> scopes;
+        std::map<std::string, Routine> routines;
+        std::string error;
+
+        bool fail(const std::string &message)
+        {
+            if (error.empty())
+                error = message;
+            return false;
+        }
+
+        int32_t emit(Op op, int32_t a = 0, int32_t b = 0, int32_t c = 0)
+        {
+            fn->code.push_back({op, a, b, c});
+            return static_cast<int32_t>(fn->code.size() - 1);
+        }
+        int32_t here() const { return static_cast<int32_t>(fn->code.size()); }
+        // Points the jump at index to the next instruction
+        void patch(int32_t index)
+        {
+            Instr &jump = fn->code[index];
+            (jump.op == Op::Jmp ? jump.a : jump.b) = here();
+        }
+
+        Operand temp(VType type)
+        {
+            return {type, type == VType::String ? fn->numStringRegs++ : fn->numRegs++};
+        }
+
+        const Variable *lookup(const std::string &name) const
+        {
+            for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+            {
+                auto it = scope->find(name);
+                if (it != scope->end())
+                    return &it->second;
+            }
+            return nullptr;
+        }
+
+        // --- Routines ---
+
+        bool declareRoutine(ASTNode *node)
+        {
+            std::string name;
+            if (auto *proc = dynamic_cast<ProcedureAST *>(node))
+                name = proc->Identifier->name;
+            else if (auto *func = dynamic_cast<FuncAST *>(node))
+                name = func->Identifier->name;
+            else
+                return true;
+            if (routines.count(name))
+                return fail("routine " + name + " is defined twice");
+            routines[name] = {static_cast<int32_t>(program.functions.size()), node};
+            program.functions.emplace_back();
+            program.functions.back().name = name;
+            return true;
+        }
+
+        bool routine(const std::string &name, const std::vector<ParameterAST *> &parameters,
+                     StatementBlockAST *block, const FuncAST *function)
+        {
+            BytecodeFunction *outerFn = fn;
+            const FuncAST *outerFunction = currentFunction;
+            std::vector<std::map<std::string, Variable>> outerScopes;
+            outerScopes.swap(scopes);
+
+            fn = &program.functions[routines.at(name).index];
+            currentFunction = function;
+            scopes.emplace_back();
+            for (ParameterAST *param : parameters)
+            {
+                Variable var;
+                if (!vtypeOf(param->type->type, var.type))
+                    return fail("parameter type " + param->type->type);
+                var.reg = temp(var.type).reg;
+                fn->params.push_back(var.type);
+                fn->paramRegs.push_back(var.reg);
+                scopes.back()[param->name] = var;
+            }
+            if (function)
+            {
+                fn->returnsValue = true;
+                if (!vtypeOf(function->returnType->type, fn->returnType))
+                    return fail("return type " + function->returnType->type);
+            }
+            if (!statement(block))
+                return false;
+            emit(function ? Op::NoReturn : Op::RetVoid);
+
+            scopes.swap(outerScopes);
+            fn = outerFn;
+            currentFunction = outerFunction;
+            return true;
+        }
+
+        // --- Statements ---
+
+        bool block(StatementBlockAST *node)
+        {
+            for (ASTNode *stmt : node->statements)
+                if (stmt && !statement(stmt))
+                    return false;
+            return true;
+        }
+
+        bool scopedBlock(StatementBlockAST *node)
+        {
+            scopes.emplace_back();
+            bool ok = block(node);
+            scopes.pop_back();
+            return ok;
+        }
+
+        bool statement(ASTNode *node)
+        {
+            if (auto *blockNode = dynamic_cast<StatementBlockAST *>(node))
+                return block(blockNode);
+            if (auto *decl = dynamic_cast<DeclarationAST *>(node))
+                return declaration(decl);
+            if (auto *array = dynamic_cast<ArrayAST *>(node))
+                return arrayDeclaration(array);
+            if (auto *assign = dynamic_cast<AssignmentAST *>(node))
+                return assignment(assign);
+            if (auto *assign = dynamic_cast<ArrayAssignmentAST *>(node))
+                return arrayAssignment(assign);
+            if (auto *output = dynamic_cast<OutputAST *>(node))
+                return outputStatement(output);
+            if (auto *input = dynamic_cast<InputAST *>(node))
+                return inputStatement(input);
+            if (auto *ifNode = dynamic_cast<IfAST *>(node))
+                return ifStatement(ifNode);
+            if (auto *forNode = dynamic_cast<ForAST *>(node))
+                return forStatement(forNode);
+            if (auto *whileNode = dynamic_cast<WhileAST *>(node))
+                return whileStatement(whileNode);
+            if (auto *repeatNode = dynamic_cast<RepeatAST *>(node))
+                return repeatStatement(repeatNode);
+            if (auto *proc = dynamic_cast<ProcedureAST *>(node))
+                return fn == &program.functions[0] ? routine(proc->Identifier->name, proc->parameters, proc->statementsBlock, nullptr)
+                                                   : fail("nested PROCEDURE");
+            if (auto *func = dynamic_cast<FuncAST *>(node))
+                return fn == &program.functions[0] ? routine(func->Identifier->name, func->parameters, func->statementsBlock, func)
+                                                   : fail("nested FUNCTION");
+            if (auto *ret = dynamic_cast<ReturnAST *>(node))
+                return returnStatement(ret);
+            if (auto *call = dynamic_cast<FuncCallAST *>(node))
+            {
+                Operand ignored;
+                return callExpression(call, ignored, false);
+            }
+            if (dynamic_cast<ListAST *>(node))
+                return fail("LIST OF");
+            if (dynamic_cast<ImportAST *>(node))
+                return fail("IMPORT");
+            if (dynamic_cast<FileAST *>(node))
+                return fail("file statement");
+            return fail(std::string("statement ") + typeid(*node).name());
+        }
+
+        bool declaration(DeclarationAST *node)
+        {
+            Variable var;
+            if (!vtypeOf(node->type->type, var.type))
+                return fail("type " + node->type->type);
+            var.reg = temp(var.type).reg;
+            // A STRING always holds a string, starting with ""
+            if (var.type == VType::String)
+                emit(Op::MovS, var.reg, internString(""));
+            scopes.back()[node->identifier->name] = var;
+            return true;
+        }
+
+        bool arrayDeclaration(ArrayAST *node)
+        {
+            if (node->isDynamic())
+                return fail("array sized at run time");
+            Variable var;
+            if (!vtypeOf(node->type->type, var.type))
+                return fail("array of " + node->type->type);
+            int64_t length = 1;
+            for (const auto &dim : node->bounds)
+            {
+                if (dim.second < dim.first)
+                    return fail("array with last index less than first index");
+                length *= dim.second - dim.first + 1;
+                if (length > INT32_MAX)
+                    return fail("array too large");
+            }
+            var.bounds = node->bounds;
+            var.array = static_cast<int32_t>(fn->arrays.size());
+            fn->arrays.push_back({var.type, static_cast<int32_t>(length)});
+            // NULL elements read as ""
+            if (var.type == VType::String)
+                emit(Op::SAClear, var.array);
+            scopes.back()[node->identifier->name] = var;
+            return true;
+        }
+
+        // Converts value to the type of a slot: exact, or a CHAR into a STRING
+        bool convert(Operand &value, VType target)
+        {
+            if (value.type == target)
+                return true;
+            if (target == VType::String && value.type == VType::Char)
+            {
+                Operand str = temp(VType::String);
+                emit(Op::CharToStr, str.reg, value.reg);
+                value = str;
+                return true;
+            }
+            return false;
+        }
+
+        void move(const Operand &value, int32_t reg)
+        {
+            emit(value.type == VType::String ? Op::MovStr : Op::Mov, reg, value.reg);
+        }
+
+        bool assignment(AssignmentAST *node)
+        {
+            const Variable *var = lookup(node->identifier->name);
+            if (!var)
+                return fail("variable " + node->identifier->name + " not declared in this routine");
+            if (var->array >= 0)
+                return fail("whole-array assignment");
+            Operand value;
+            if (!expression(node->expression, value))
+                return false;
+            if (!convert(value, var->type))
+                return fail("assignment between different types");
+            move(value, var->reg);
+            return true;
+        }
+
+        // Zero-based element index of array var at indices, in an INTEGER register
+        bool elementIndex(const Variable &var, const std::vector<ASTNode *> &indices, Operand &index)
+        {
+            if (indices.size() != var.bounds.size())
+                return fail("wrong number of array indices");
+            for (size_t d = 0; d < indices.size(); d++)
+            {
+                Operand value;
+                if (!expression(indices[d], value))
+                    return false;
+                if (value.type != VType::Int)
+                    return fail("array index that is not INTEGER");
+                Operand offset = temp(VType::Int);
+                emit(Op::AddImm, offset.reg, value.reg, -var.bounds[d].first);
+                if (d == 0)
+                {
+                    index = offset;
+                    continue;
+                }
+                Operand scaled = temp(VType::Int);
+                emit(Op::MulImm, scaled.reg, index.reg, var.bounds[d].second - var.bounds[d].first + 1);
+                index = temp(VType::Int);
+                emit(Op::AddI, index.reg, scaled.reg, offset.reg);
+            }
+            return true;
+        }
+
+        const Variable *arrayVariable(const std::string &name)
+        {
+            const Variable *var = lookup(name);
+            if (!var || var->array < 0)
+            {
+                fail("'" + name + "' is not an array of this routine");
+                return nullptr;
+            }
+            return var;
+        }
+
+        bool arrayAssignment(ArrayAssignmentAST *node)
+        {
+            const Variable *var = arrayVariable(node->identifier->name);
+            Operand index, value;
+            if (!var || !elementIndex(*var, node->indices, index) || !expression(node->expression, value))
+                return false;
+            if (!convert(value, var->type))
+                return fail("array assignment between different types");
+            emit(var->type == VType::String ? Op::SAStore : Op::AStore, var->array, index.reg, value.reg);
+            return true;
+        }
+
+        bool outputStatement(OutputAST *node)
+        {
+            for (ASTNode *separator : node->separators)
+                if (separator)
+                    return fail("OUTPUT of a whole array");
+            for (ASTNode *expr : node->expressions)
+            {
+                Operand value;
+                if (!expression(expr, value))
+                    return false;
+                static const Op outputs[] = {Op::OutI, Op::OutR, Op::OutB, Op::OutC, Op::OutS};
+                emit(outputs[static_cast<int>(value.type)], value.reg);
+            }
+            return true;
+        }
+
+        bool inputStatement(InputAST *node)
+        {
+            static const Op inputs[] = {Op::InI, Op::InR, Op::Halt, Op::InC, Op::InS};
+            if (auto *id = dynamic_cast<IdentifierAST *>(node->target))
+            {
+                const Variable *var = lookup(id->name);
+                if (!var || var->array >= 0)
+                    return fail("INPUT into " + id->name);
+                if (var->type == VType::Bool)
+                    return fail("INPUT of a BOOLEAN");
+                emit(inputs[static_cast<int>(var->type)], var->reg);
+                return true;
+            }
+            auto *access = dynamic_cast<ArrayAccessAST *>(node->target);
+            if (!access)
+                return fail("INPUT target");
+            const Variable *var = arrayVariable(access->identifier->name);
+            Operand index;
+            if (!var || !elementIndex(*var, access->indices, index))
+                return false;
+            if (var->type == VType::Bool)
+                return fail("INPUT of a BOOLEAN");
+            // Like scanf, a failed read leaves the element as it was
+            Operand element = temp(var->type);
+            bool isString = var->type == VType::String;
+            emit(isString ? Op::SALoad : Op::ALoad, element.reg, var->array, index.reg);
+            emit(inputs[static_cast<int>(var->type)], element.reg);
+            emit(isString ? Op::SAStore : Op::AStore, var->array, index.reg, element.reg);
+            return true;
+        }
+
+        bool condition(ASTNode *node, Operand &value)
+        {
+            if (!expression(node, value))
+                return false;
+            if (value.type != VType::Bool)
+                return fail("condition that is not BOOLEAN");
+            return true;
+        }
+
+        bool ifStatement(IfAST *node)
+        {
+            Operand cond;
+            if (!condition(node->condition, cond))
+                return false;
+            int32_t toElse = emit(Op::JmpIfNot, cond.reg);
+            if (!scopedBlock(node->thenBlock))
+                return false;
+            int32_t toEnd = emit(Op::Jmp);
+            patch(toElse);
+            if (node->elseBlock && !scopedBlock(node->elseBlock))
+                return false;
+            patch(toEnd);
+            return true;
+        }
+
+        bool forStatement(ForAST *node)
+        {
+            scopes.emplace_back();
+            if (!assignment(node->assignment))
+                return false;
+            int32_t top = here();
+            Operand cond;
+            if (!condition(node->condition, cond))
+                return false;
+            int32_t toEnd = emit(Op::JmpIfNot, cond.reg);
+            if (!block(node->forBlock) || !assignment(node->step))
+                return false;
+            emit(Op::Jmp, top);
+            patch(toEnd);
+            scopes.pop_back();
+            return true;
+        }
+
+        bool whileStatement(WhileAST *node)
+        {
+            int32_t top = here();
+            Operand cond;
+            if (!condition(node->condition, cond))
+                return false;
+            int32_t toEnd = emit(Op::JmpIfNot, cond.reg);
+            if (!block(node->body))
+                return false;
+            emit(Op::Jmp, top);
+            patch(toEnd);
+            return true;
+        }
+
+        bool repeatStatement(RepeatAST *node)
+        {
+            scopes.emplace_back();
+            int32_t top = here();
+            Operand cond;
+            if (!block(node->body) || !condition(node->condition, cond))
+                return false;
+            emit(Op::JmpIfNot, cond.reg, top);
+            scopes.pop_back();
+            return true;
+        }
+
+        bool returnStatement(ReturnAST *node)
+        {
+            if (!currentFunction)
+                return fail("RETURN outside a FUNCTION");
+            Operand value;
+            if (!expression(node->expression, value))
+                return false;
+            if (!convert(value, fn->returnType))
+                return fail("RETURN of a different type");
+            emit(value.type == VType::String ? Op::SRet : Op::Ret, value.reg);
+            return true;
+        }
+
+        // --- Expressions ---
+
+        int32_t internString(const std::string &text)
+        {
+            program.strings.push_back(text);
+            return static_cast<int32_t>(program.strings.size() - 1);
+        }
+
+        bool expression(ASTNode *node, Operand &result)
+        {
+            if (auto *lit = dynamic_cast<IntegerLiteralAST *>(node))
+            {
+                result = temp(VType::Int);
+                emit(Op::MovI, result.reg, lit->value);
+                return true;
+            }
+            if (auto *lit = dynamic_cast<RealLiteralAST *>(node))
+            {
+                result = temp(VType::Real);
+                program.reals.push_back(lit->value);
+                emit(Op::MovR, result.reg, static_cast<int32_t>(program.reals.size() - 1));
+                return true;
+            }
+            if (auto *lit = dynamic_cast<CharLiteralAST *>(node))
+            {
+                result = temp(VType::Char);
+                emit(Op::MovI, result.reg, static_cast<signed char>(lit->value));
+                return true;
+            }
+            if (auto *lit = dynamic_cast<BooleanLiteralAST *>(node))
+            {
+                result = temp(VType::Bool);
+                emit(Op::MovI, result.reg, lit->value ? 1 : 0);
+                return true;
+            }
+            if (auto *lit = dynamic_cast<StringLiteralAST *>(node))
+            {
+                result = temp(VType::String);
+                emit(Op::MovS, result.reg, internString(lit->value));
+                return true;
+            }
+            if (auto *id = dynamic_cast<IdentifierAST *>(node))
+            {
+                const Variable *var = lookup(id->name);
+                if (!var)
+                    return fail("variable " + id->name + " not declared in this routine");
+                if (var->array >= 0)
+                    return fail("array " + id->name + " used as a value");
+                result = {var->type, var->reg};
+                return true;
+            }
+            if (auto *access = dynamic_cast<ArrayAccessAST *>(node))
+            {
+                const Variable *var = arrayVariable(access->identifier->name);
+                Operand index;
+                if (!var || !elementIndex(*var, access->indices, index))
+                    return false;
+                result = temp(var->type);
+                emit(var->type == VType::String ? Op::SALoad : Op::ALoad, result.reg, var->array, index.reg);
+                return true;
+            }
+            if (auto *binary = dynamic_cast<BinaryOpAST *>(node))
+                return binaryExpression(binary, result);
+            if (auto *unary = dynamic_cast<UnaryOpAST *>(node))
+            {
+                Operand value;
+                if (!expression(unary->expression, value))
+                    return false;
+                if (value.type != VType::Int && value.type != VType::Real)
+                    return fail("negation of a non-number");
+                result = temp(value.type);
+                emit(value.type == VType::Int ? Op::NegI : Op::NegR, result.reg, value.reg);
+                return true;
+            }
+            if (auto *logical = dynamic_cast<LogicalOpAST *>(node))
+                return logicalExpression(logical, result);
+            if (auto *comparison = dynamic_cast<ComparisonAST *>(node))
+                return comparisonExpression(comparison, result);
+            if (auto *call = dynamic_cast<FuncCallAST *>(node))
+                return callExpression(call, result, true);
+            return fail(std::string("expression ") + typeid(*node).name());
+        }
+
+        bool binaryExpression(BinaryOpAST *node, Operand &result)
+        {
+            Operand lhs, rhs;
+            if (!expression(node->expression1, lhs))
+                return false;
+            if (node->op == BinaryOp::Increment || node->op == BinaryOp::Decrement)
+            {
+                int32_t step = node->op == BinaryOp::Increment ? 1 : -1;
+                result = temp(lhs.type);
+                if (lhs.type == VType::Int)
+                    emit(Op::AddImm, result.reg, lhs.reg, step);
+                else if (lhs.type == VType::Real)
+                {
+                    Operand one = temp(VType::Real);
+                    program.reals.push_back(step);
+                    emit(Op::MovR, one.reg, static_cast<int32_t>(program.reals.size() - 1));
+                    emit(Op::AddR, result.reg, lhs.reg, one.reg);
+                }
+                else
+                    return fail("++ or -- of a non-number");
+                return true;
+            }
+            if (!expression(node->expression2, rhs))
+                return false;
+            if (node->op == BinaryOp::Concat)
+            {
+                if (!convert(lhs, VType::String) || !convert(rhs, VType::String))
+                    return fail("& of a non-STRING");
+                result = temp(VType::String);
+                emit(Op::Concat, result.reg, lhs.reg, rhs.reg);
+                return true;
+            }
+            static const Op intOps[] = {Op::AddI, Op::SubI, Op::MulI, Op::DivI};
+            static const Op realOps[] = {Op::AddR, Op::SubR, Op::MulR, Op::DivR};
+            int op = static_cast<int>(node->op);
+            if (lhs.type != rhs.type || (lhs.type != VType::Int && lhs.type != VType::Real))
+                return fail(std::string("operator ") + opSpelling(node->op) + " on these types");
+            result = temp(lhs.type);
+            emit(lhs.type == VType::Int ? intOps[op] : realOps[op], result.reg, lhs.reg, rhs.reg);
+            return true;
+        }
+
+        bool comparisonExpression(ComparisonAST *node, Operand &result)
+        {
+            Operand lhs, rhs;
+            if (!expression(node->LHS, lhs) || !expression(node->RHS, rhs))
+                return false;
+            static const Op intOps[] = {Op::LtI, Op::GtI, Op::EqI, Op::LeI, Op::GeI, Op::NeI};
+            static const Op realOps[] = {Op::LtR, Op::GtR, Op::EqR, Op::LeR, Op::GeR, Op::NeR};
+            static const Op stringOps[] = {Op::LtS, Op::GtS, Op::EqS, Op::LeS, Op::GeS, Op::NeS};
+            int op = static_cast<int>(node->cmpOp);
+            const Op *ops;
+            // A CHAR compared with a STRING counts as a one-character STRING
+            if (lhs.type == VType::String || rhs.type == VType::String)
+            {
+                if (!convert(lhs, VType::String) || !convert(rhs, VType::String))
+                    return fail("comparison of a STRING with a non-STRING");
+                ops = stringOps;
+            }
+            else if (lhs.type != rhs.type)
+                return fail("comparison between different types");
+            else
+                ops = lhs.type == VType::Real ? realOps : intOps;
+            result = temp(VType::Bool);
+            emit(ops[op], result.reg, lhs.reg, rhs.reg);
+            return true;
+        }
+
+        bool logicalExpression(LogicalOpAST *node, Operand &result)
+        {
+            Operand lhs, rhs;
+            if (node->logicalOp != LogicalOp::Not && !condition(node->LHS, lhs))
+                return false;
+            if (!condition(node->RHS, rhs))
+                return false;
+            result = temp(VType::Bool);
+            if (node->logicalOp == LogicalOp::Not)
+                emit(Op::Not, result.reg, rhs.reg);
+            else
+                emit(node->logicalOp == LogicalOp::And ? Op::And : Op::Or, result.reg, lhs.reg, rhs.reg);
+            return true;
+        }
+
+        bool arguments(FuncCallAST *node, std::vector<Operand> &args)
+        {
+            for (ASTNode *arg : node->arguments)
+            {
+                Operand value;
+                if (!expression(arg, value))
+                    return false;
+                args.push_back(value);
+            }
+            return true;
+        }
+
+        bool callExpression(FuncCallAST *node, Operand &result, bool needsValue)
+        {
+            auto it = routines.find(node->name);
+            if (it == routines.end())
+                return builtinCall(node, result);
+
+            std::vector<VType> params;
+            if (auto *proc = dynamic_cast<const ProcedureAST *>(it->second.definition))
+            {
+                for (ParameterAST *param : proc->parameters)
+                    params.push_back(VType::Int), vtypeOf(param->type->type, params.back());
+            }
+            else
+            {
+                auto *func = static_cast<const FuncAST *>(it->second.definition);
+                for (ParameterAST *param : func->parameters)
+                    params.push_back(VType::Int), vtypeOf(param->type->type, params.back());
+            }
+            std::vector<Operand> args;
+            if (!arguments(node, args))
+                return false;
+            if (args.size() != params.size())
+                return fail("call of " + node->name + " with the wrong number of arguments");
+            for (size_t i = 0; i < args.size(); i++)
+            {
+                if (args[i].type != params[i])
+                    return fail("argument of a different type in a call of " + node->name);
+                emit(args[i].type == VType::String ? Op::SArg : Op::Arg, args[i].reg);
+            }
+
+            bool returnsValue = dynamic_cast<const FuncAST *>(it->second.definition) != nullptr;
+            if (needsValue && !returnsValue)
+                return fail("PROCEDURE " + node->name + " used as a value");
+            if (returnsValue)
+            {
+                VType type;
+                vtypeOf(static_cast<const FuncAST *>(it->second.definition)->returnType->type, type);
+                result = temp(type);
+                emit(Op::Call, it->second.index, result.reg);
+            }
+            else
+                emit(Op::Call, it->second.index, -1);
+            return true;
+        }
+
+        bool builtinCall(FuncCallAST *node, Operand &result)
+        {
+            const std::string &name = node->name;
+            std::vector<Operand> args;
+            if (!arguments(node, args))
+                return false;
+            auto expect = [&](std::initializer_list<VType> types)
+            {
+                if (args.size() != types.size())
+                    return fail("built-in " + name + " with the wrong number of arguments");
+                size_t i = 0;
+                for (VType type : types)
+                {
+                    Operand &arg = args[i++];
+                    // INTEGER arguments are accepted where a REAL is expected
+                    if (arg.type == VType::Int && type == VType::Real)
+                    {
+                        Operand real = temp(VType::Real);
+                        emit(Op::IntToReal, real.reg, arg.reg);
+                        arg = real;
+                    }
+                    if (!convert(arg, type))
+                        return fail("argument of a different type in a call of " + name);
+                }
+                return true;
+            };
+
+            if (name == "INT" || name == "SQRT")
+            {
+                if (!expect({VType::Real}))
+                    return false;
+                result = temp(name == "INT" ? VType::Int : VType::Real);
+                emit(name == "INT" ? Op::Trunc : Op::Sqrt, result.reg, args[0].reg);
+            }
+            else if (name == "MOD" || name == "DIV")
+            {
+                if (!expect({VType::Int, VType::Int}))
+                    return false;
+                result = temp(VType::Int);
+                emit(name == "MOD" ? Op::ModI : Op::DivZ, result.reg, args[0].reg, args[1].reg);
+            }
+            else if (name == "RAND")
+            {
+                if (!expect({VType::Int}))
+                    return false;
+                result = temp(VType::Real);
+                emit(Op::Rand, result.reg, args[0].reg);
+            }
+            else if (name == "LENGTH")
+            {
+                if (args.size() == 1 && args[0].type != VType::String && args[0].type != VType::Char)
+                    return fail("LENGTH of an array");
+                if (!expect({VType::String}))
+                    return false;
+                result = temp(VType::Int);
+                emit(Op::SLen, result.reg, args[0].reg);
+            }
+            else if (name == "MID")
+            {
+                if (!expect({VType::String, VType::Int, VType::Int}))
+                    return false;
+                // start and count go in consecutive registers
+                Operand start = temp(VType::Int);
+                temp(VType::Int);
+                emit(Op::Mov, start.reg, args[1].reg);
+                emit(Op::Mov, start.reg + 1, args[2].reg);
+                result = temp(VType::String);
+                emit(Op::SMid, result.reg, args[0].reg, start.reg);
+            }
+            else if (name == "LEFT" || name == "RIGHT")
+            {
+                if (!expect({VType::String, VType::Int}))
+                    return false;
+                result = temp(VType::String);
+                emit(name == "LEFT" ? Op::SLeft : Op::SRight, result.reg, args[0].reg, args[1].reg);
+            }
+            else if (name == "UCASE" || name == "LCASE")
+            {
+                bool upper = name == "UCASE";
+                // UCASE and LCASE of a CHAR give a CHAR
+                if (args.size() == 1 && args[0].type == VType::Char)
+                {
+                    result = temp(VType::Char);
+                    emit(upper ? Op::CUpper : Op::CLower, result.reg, args[0].reg);
+                    return true;
+                }
+                if (!expect({VType::String}))
+                    return false;
+                result = temp(VType::String);
+                emit(upper ? Op::SUpper : Op::SLower, result.reg, args[0].reg);
+            }
+            else
+                return fail("built-in or routine " + name);
+            return true;
+        }
+    };
+}
+
+BytecodeProgram *compileBytecode(const std::vector<ASTNode *> &program)
+{
+    auto *bytecode = new BytecodeProgram();
+    BytecodeCompiler compiler(*bytecode);
+    if (!compiler.compile(program))
+    {
+        fprintf(stderr, "Interpreter: unsupported %s\n", compiler.getError().c_str());
+        delete bytecode;
+        return nullptr;
+    }
+    size_t instructions = 0;
+    for (const BytecodeFunction &function : bytecode->functions)
+        instructions += function.code.size();
+    fprintf(stderr, "Interpreter: %zu functions, %zu instructions\n", bytecode->functions.size(), instructions);
+    return bytecode;
+}
+
+// --- Execution ---
+
+namespace
+{
+    struct Frame
+    {
+        int32_t index; // in program.functions
+        const BytecodeFunction *function;
+        const Instr *returnTo;
+        size_t regBase, stringBase, arrayBase, stringArrayBase;
+        int32_t resultReg;
+    };
+
+    // ASCII case mapping, as ssc_str_upper and ssc_str_lower do it
+    char changeCase(char c, bool upper)
+    {
+        char from = upper ? 'a' : 'A';
+        return (unsigned char)(c - from) < 26 ? c ^ 0x20 : c;
+    }
+
+    // The clipping of ssc_str_mid, ssc_str_left and ssc_str_right
+    std::string mid(const std::string &s, int32_t start, int32_t count)
+    {
+        int64_t len = s.size(), from = (int64_t)start - 1, to = from + count;
+        if (from < 0)
+            from = 0;
+        if (to > len)
+            to = len;
+        if (from > to)
+            from = to = 0;
+        return s.substr(from, to - from);
+    }
+
+    int compareStrings(const std::string &a, const std::string &b)
+    {
+        int c = a.compare(b);
+        return c < 0 ? -1 : c > 0;
+    }
+
+    int runtimeError(const char *message)
+    {
+        ssc_flush();
+        fprintf(stderr, "Runtime error: %s\n", message);
+        return EXIT_FAILURE;
+    }
+}
+
+int runBytecode(const BytecodeProgram &program, NativeTier *tier, uint64_t threshold)
+{
+    std::vector<Register> regStack;
+    std::vector<std::string> stringStack;
+    std::vector<std::vector<Register>> arrayStack;
+    std::vector<std::vector<std::string>> stringArrayStack;
+    std::vector<Register> args;
+    std::vector<std::string> stringArgs;
+    std::vector<Frame> frames;
+
+    Register *r = nullptr;
+    std::string *s = nullptr;
+    std::vector<Register> *arrays = nullptr;
+    std::vector<std::string> *stringArrays = nullptr;
+    const Instr *ip = nullptr;
+
+    // Per routine for --tiered: calls plus backward jumps, and its native code
+    struct Tier
+    {
+        uint64_t heat = 0;
+        bool tried = false;
+        NativeEntry native = nullptr;
+    };
+    std::vector<Tier> tiers(tier ? program.functions.size() : 0);
+
+    // Pushes a frame for function and moves the pending arguments into it
+    auto enter = [&](int32_t index, const Instr *returnTo, int32_t resultReg)
+    {
+        const BytecodeFunction &function = program.functions[index];
+        Frame frame{index, &function, returnTo, regStack.size(), stringStack.size(), arrayStack.size(),
+                    stringArrayStack.size(), resultReg};
+        regStack.resize(frame.regBase + function.numRegs, Register{0});
+        stringStack.resize(frame.stringBase + function.numStringRegs);
+        for (const BytecodeArray &array : function.arrays)
+        {
+            if (array.element == VType::String)
+            {
+                stringArrayStack.emplace_back(array.length);
+                arrayStack.emplace_back();
+            }
+            else
+            {
+                arrayStack.emplace_back(array.length, Register{0});
+                stringArrayStack.emplace_back();
+            }
+        }
+        // Arguments were pushed left to right; each file is popped from its end
+        size_t numeric = 0, strings = 0;
+        for (VType type : function.params)
+            (type == VType::String ? strings : numeric)++;
+        size_t nextNumeric = args.size() - numeric, nextString = stringArgs.size() - strings;
+        for (size_t i = 0; i < function.params.size(); i++)
+        {
+            if (function.params[i] == VType::String)
+                stringStack[frame.stringBase + function.paramRegs[i]] = std::move(stringArgs[nextString++]);
+            else
+                regStack[frame.regBase + function.paramRegs[i]] = args[nextNumeric++];
+        }
+        args.resize(args.size() - numeric);
+        stringArgs.resize(stringArgs.size() - strings);
+        frames.push_back(frame);
+    };
+    // Points the register pointers at the current frame
+    auto reload = [&]()
+    {
+        const Frame &frame = frames.back();
+        r = regStack.data() + frame.regBase;
+        s = stringStack.data() + frame.stringBase;
+        arrays = arrayStack.data() + frame.arrayBase;
+        stringArrays = stringArrayStack.data() + frame.stringArrayBase;
+    };
+    // Pops the current frame and returns to the caller, or nullptr from main
+    auto leave = [&]() -> const Instr *
+    {
+        Frame frame = frames.back();
+        frames.pop_back();
+        regStack.resize(frame.regBase);
+        stringStack.resize(frame.stringBase);
+        arrayStack.resize(frame.arrayBase);
+        stringArrayStack.resize(frame.stringArrayBase);
+        if (!frames.empty())
+            reload();
+        return frame.returnTo;
+    };
+
+    enter(0, nullptr, -1);
+    reload();
+    ip = program.functions[0].code.data();
+
+#if defined(__GNUC__)
+    // Threaded dispatch: each handler jumps straight to the next one
+    static const void *const labels[] = {
+#define SSC_BYTECODE_LABEL(name) &&op_##name,
+        SSC_BYTECODE_OPS(SSC_BYTECODE_LABEL)
+#undef SSC_BYTECODE_LABEL
+    };
+#define DISPATCH() goto *labels[static_cast<uint32_t>(ip->op)]
+#define CASE(name) op_##name:
+    DISPATCH();
+#else
+#define DISPATCH() goto dispatch
+#define CASE(name) case Op::name:
+dispatch:
+    switch (ip->op)
+    {
+#endif
+
+#define NEXT() \
+    do         \
+    {          \
+        ++ip;  \
+        DISPATCH(); \
+    } while (0)
+#define INT_OP(name, expr)                                                \
+    CASE(name)                                                            \
+    {                                                                     \
+        uint32_t x = static_cast<uint32_t>(r[ip->b].i), y = static_cast<uint32_t>(r[ip->c].i); \
+        r[ip->a].i = static_cast<int32_t>(expr);                          \
+        NEXT();                                                           \
+    }
+#define BIN_OP(name, field, result, expr)          \
+    CASE(name)                                     \
+    {                                              \
+        auto x = r[ip->b].field, y = r[ip->c].field; \
+        r[ip->a].result = (expr);                  \
+        NEXT();                                    \
+    }
+#define STR_CMP(name, expr)                                    \
+    CASE(name)                                                 \
+    {                                                          \
+        int c = compareStrings(s[ip->b], s[ip->c]);            \
+        r[ip->a].i = (expr);                                   \
+        NEXT();                                                \
+    }
+
+    CASE(MovI)
+    {
+        r[ip->a].i = ip->b;
+        NEXT();
+    }
+    CASE(MovR)
+    {
+        r[ip->a].r = program.reals[ip->b];
+        NEXT();
+    }
+    CASE(MovS)
+    {
+        s[ip->a] = program.strings[ip->b];
+        NEXT();
+    }
+    CASE(Mov)
+    {
+        r[ip->a] = r[ip->b];
+        NEXT();
+    }
+    CASE(MovStr)
+    {
+        s[ip->a] = s[ip->b];
+        NEXT();
+    }
+    INT_OP(AddI, x + y)
+    INT_OP(SubI, x - y)
+    INT_OP(MulI, x * y)
+    CASE(DivI)
+    {
+        int32_t x = r[ip->b].i, y = r[ip->c].i;
+        if (y == 0 || (x == INT32_MIN && y == -1))
+            return runtimeError("division by zero");
+        r[ip->a].i = x / y;
+        NEXT();
+    }
+    CASE(AddImm)
+    {
+        r[ip->a].i = static_cast<int32_t>(static_cast<uint32_t>(r[ip->b].i) + static_cast<uint32_t>(ip->c));
+        NEXT();
+    }
+    CASE(MulImm)
+    {
+        r[ip->a].i = static_cast<int32_t>(static_cast<uint32_t>(r[ip->b].i) * static_cast<uint32_t>(ip->c));
+        NEXT();
+    }
+    BIN_OP(AddR, r, r, x + y)
+    BIN_OP(SubR, r, r, x - y)
+    BIN_OP(MulR, r, r, x * y)
+    BIN_OP(DivR, r, r, x / y)
+    CASE(NegI)
+    {
+        r[ip->a].i = static_cast<int32_t>(0u - static_cast<uint32_t>(r[ip->b].i));
+        NEXT();
+    }
+    CASE(NegR)
+    {
+        r[ip->a].r = -r[ip->b].r;
+        NEXT();
+    }
+    BIN_OP(LtI, i, i, x < y)
+    BIN_OP(GtI, i, i, x > y)
+    BIN_OP(EqI, i, i, x == y)
+    BIN_OP(LeI, i, i, x <= y)
+    BIN_OP(GeI, i, i, x >= y)
+    BIN_OP(NeI, i, i, x != y)
+    // True when either side is NaN
+    BIN_OP(LtR, r, i, !(x >= y))
+    BIN_OP(GtR, r, i, !(x <= y))
+    BIN_OP(EqR, r, i, !(x < y || x > y))
+    BIN_OP(LeR, r, i, !(x > y))
+    BIN_OP(GeR, r, i, !(x < y))
+    BIN_OP(NeR, r, i, !(x == y))
+    STR_CMP(LtS, c < 0)
+    STR_CMP(GtS, c > 0)
+    STR_CMP(EqS, c == 0)
+    STR_CMP(LeS, c <= 0)
+    STR_CMP(GeS, c >= 0)
+    STR_CMP(NeS, c != 0)
+    BIN_OP(And, i, i, x & y)
+    BIN_OP(Or, i, i, x | y)
+    CASE(Not)
+    {
+        r[ip->a].i = !r[ip->b].i;
+        NEXT();
+    }
+    CASE(IntToReal)
+    {
+        r[ip->a].r = r[ip->b].i;
+        NEXT();
+    }
+    CASE(CharToStr)
+    {
+        s[ip->a].assign(1, static_cast<char>(r[ip->b].i));
+        NEXT();
+    }
+    CASE(Concat)
+    {
+        if (ip->a == ip->b)
+            s[ip->a] += s[ip->c];
+        else
+            s[ip->a] = s[ip->b] + s[ip->c];
+        NEXT();
+    }
+    CASE(Jmp)
+    {
+        const Instr *target = frames.back().function->code.data() + ip->a;
+        // Every loop closes with a backward jump
+        if (target < ip && !tiers.empty())
+            tiers[frames.back().index].heat++;
+        ip = target;
+        DISPATCH();
+    }
+    CASE(JmpIf)
+    {
+        if (r[ip->a].i)
+        {
+            ip = frames.back().function->code.data() + ip->b;
+            DISPATCH();
+        }
+        NEXT();
+    }
+    CASE(JmpIfNot)
+    {
+        if (!r[ip->a].i)
+        {
+            const Instr *target = frames.back().function->code.data() + ip->b;
+            if (target < ip && !tiers.empty())
+                tiers[frames.back().index].heat++;
+            ip = target;
+            DISPATCH();
+        }
+        NEXT();
+    }
+    CASE(OutI)
+    {
+        ssc_output_int(r[ip->a].i);
+        NEXT();
+    }
+    CASE(OutR)
+    {
+        ssc_output_real(r[ip->a].r);
+        NEXT();
+    }
+    CASE(OutC)
+    {
+        ssc_output_char(r[ip->a].i);
+        NEXT();
+    }
+    CASE(OutB)
+    {
+        ssc_output_bool(r[ip->a].i);
+        NEXT();
+    }
+    CASE(OutS)
+    {
+        ssc_output_bytes(s[ip->a].data(), s[ip->a].size());
+        NEXT();
+    }
+    CASE(InI)
+    {
+        ssc_input_int(&r[ip->a].i);
+        NEXT();
+    }
+    CASE(InR)
+    {
+        ssc_input_real(&r[ip->a].r);
+        NEXT();
+    }
+    CASE(InC)
+    {
+        char c = static_cast<char>(r[ip->a].i);
+        ssc_input_char(&c);
+        r[ip->a].i = static_cast<signed char>(c);
+        NEXT();
+    }
+    CASE(InS)
+    {
+        // The runtime reads into one of its own strings, released once copied
+        char *text = nullptr;
+        ssc_input_str(&text);
+        if (text)
+        {
+            s[ip->a].assign(text, ssc_str_length(text));
+            ssc_str_store(&text, nullptr);
+        }
+        NEXT();
+    }
+    CASE(ALoad)
+    {
+        const std::vector<Register> &array = arrays[ip->b];
+        if (static_cast<uint32_t>(r[ip->c].i) >= array.size())
+            return runtimeError("array index out of range");
+        r[ip->a] = array[r[ip->c].i];
+        NEXT();
+    }
+    CASE(AStore)
+    {
+        std::vector<Register> &array = arrays[ip->a];
+        if (static_cast<uint32_t>(r[ip->b].i) >= array.size())
+            return runtimeError("array index out of range");
+        array[r[ip->b].i] = r[ip->c];
+        NEXT();
+    }
+    CASE(SALoad)
+    {
+        const std::vector<std::string> &array = stringArrays[ip->b];
+        if (static_cast<uint32_t>(r[ip->c].i) >= array.size())
+            return runtimeError("array index out of range");
+        s[ip->a] = array[r[ip->c].i];
+        NEXT();
+    }
+    CASE(SAStore)
+    {
+        std::vector<std::string> &array = stringArrays[ip->a];
+        if (static_cast<uint32_t>(r[ip->b].i) >= array.size())
+            return runtimeError("array index out of range");
+        array[r[ip->b].i] = s[ip->c];
+        NEXT();
+    }
+    CASE(SAClear)
+    {
+        for (std::string &element : stringArrays[ip->a])
+            element.clear();
+        NEXT();
+    }
+    CASE(Arg)
+    {
+        args.push_back(r[ip->a]);
+        NEXT();
+    }
+    CASE(SArg)
+    {
+        stringArgs.push_back(s[ip->a]);
+        NEXT();
+    }
+    CASE(Call)
+    {
+        const BytecodeFunction &callee = program.functions[ip->a];
+        if (!tiers.empty())
+        {
+            Tier &state = tiers[ip->a];
+            if (!state.native && !state.tried && ++state.heat >= threshold)
+            {
+                state.tried = true;
+                state.native = tier->compile(program, ip->a);
+            }
+            if (state.native)
+            {
+                // Native routines take numeric arguments only
+                Register result{0};
+                state.native(args.data() + args.size() - callee.params.size(), &result);
+                args.resize(args.size() - callee.params.size());
+                if (ip->b >= 0)
+                    r[ip->b] = result;
+                NEXT();
+            }
+        }
+        enter(ip->a, ip + 1, ip->b);
+        reload();
+        ip = callee.code.data();
+        DISPATCH();
+    }
+    CASE(Ret)
+    {
+        Register value = r[ip->a];
+        int32_t resultReg = frames.back().resultReg;
+        ip = leave();
+        if (resultReg >= 0)
+            r[resultReg] = value;
+        DISPATCH();
+    }
+    CASE(SRet)
+    {
+        std::string value = std::move(s[ip->a]);
+        int32_t resultReg = frames.back().resultReg;
+        ip = leave();
+        if (resultReg >= 0)
+            s[resultReg] = std::move(value);
+        DISPATCH();
+    }
+    CASE(RetVoid)
+    {
+        ip = leave();
+        DISPATCH();
+    }
+    CASE(NoReturn)
+    {
+        return runtimeError(("FUNCTION " + frames.back().function->name + " ended without RETURN").c_str());
+    }
+    CASE(Trunc)
+    {
+        r[ip->a].i = static_cast<int32_t>(r[ip->b].r);
+        NEXT();
+    }
+    CASE(ModI)
+    {
+        int32_t x = r[ip->b].i, y = r[ip->c].i;
+        r[ip->a].i = y == 0 ? 0 : x % y;
+        NEXT();
+    }
+    CASE(DivZ)
+    {
+        int32_t x = r[ip->b].i, y = r[ip->c].i;
+        r[ip->a].i = y == 0 ? 0 : x / y;
+        NEXT();
+    }
+    CASE(Sqrt)
+    {
+        r[ip->a].r = std::sqrt(r[ip->b].r);
+        NEXT();
+    }
+    CASE(Rand)
+    {
+        r[ip->a].r = ssc_rand(r[ip->b].i);
+        NEXT();
+    }
+    CASE(SLen)
+    {
+        r[ip->a].i = static_cast<int32_t>(s[ip->b].size());
+        NEXT();
+    }
+    CASE(SMid)
+    {
+        s[ip->a] = mid(s[ip->b], r[ip->c].i, r[ip->c + 1].i);
+        NEXT();
+    }
+    CASE(SLeft)
+    {
+        int64_t len = s[ip->b].size(), count = r[ip->c].i;
+        s[ip->a] = s[ip->b].substr(0, count < 0 ? 0 : count > len ? len : count);
+        NEXT();
+    }
+    CASE(SRight)
+    {
+        int64_t len = s[ip->b].size(), count = r[ip->c].i;
+        int64_t n = count < 0 ? 0 : count > len ? len : count;
+        s[ip->a] = s[ip->b].substr(len - n);
+        NEXT();
+    }
+    CASE(SUpper)
+    {
+        s[ip->a] = s[ip->b];
+        for (char &c : s[ip->a])
+            c = changeCase(c, true);
+        NEXT();
+    }
+    CASE(SLower)
+    {
+        s[ip->a] = s[ip->b];
+        for (char &c : s[ip->a])
+            c = changeCase(c, false);
+        NEXT();
+    }
+    CASE(CUpper)
+    {
+        r[ip->a].i = static_cast<signed char>(changeCase(static_cast<char>(r[ip->b].i), true));
+        NEXT();
+    }
+    CASE(CLower)
+    {
+        r[ip->a].i = static_cast<signed char>(changeCase(static_cast<char>(r[ip->b].i), false));
+        NEXT();
+    }
+    CASE(Halt)
+    {
+        ssc_flush();
+        return EXIT_SUCCESS;
+    }
+
+#if !defined(__GNUC__)
+    }
+#endif
+#undef STR_CMP
+#undef BIN_OP
+#undef INT_OP
+#undef NEXT
+#undef CASE
+#undef DISPATCH
+    return EXIT_FAILURE;
+}
+
+void dumpBytecode(const BytecodeProgram &program)
+{
+    static const char *const names[] = {
+#define SSC_BYTECODE_NAME(name) #name,
+        SSC_BYTECODE_OPS(SSC_BYTECODE_NAME)
+#undef SSC_BYTECODE_NAME
+    };
+    for (const BytecodeFunction &function : program.functions)
+    {
+        fprintf(stderr, "%s: %d registers, %d STRING registers, %zu arrays\n", function.name.c_str(),
+                function.numRegs, function.numStringRegs, function.arrays.size());
+        for (size_t i = 0; i < function.code.size(); i++)
+        {
+            const Instr &instr = function.code[i];
+            fprintf(stderr, "  %4zu  %-10s %d, %d, %d\n", i, names[static_cast<uint32_t>(instr.op)], instr.a, instr.b,
+                    instr.c);
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ASTNode;
+
+// Bytecode interpreter (--interp).
+//
+// Small programs spend far longer in LLVM than in running, so --interp
+// lowers the AST to a register bytecode and runs it straight after parsing.
+// Every routine gets a frame of numeric registers (INTEGER, REAL, CHAR and
+// BOOLEAN) and one of STRING registers, plus its fixed arrays. The dispatch
+// loop jumps through a table of label addresses (computed goto) where the
+// compiler supports it. OUTPUT and INPUT call the same ssc_runtime.c
+// routines a compiled program uses, so the text is identical.
+//
+// A program that uses something the bytecode does not cover (lists, arrays
+// sized at run time, whole-array built-ins, IMPORT, DATE) is reported on
+// stderr and run in the lazy JIT instead.
+//
+// With a NativeTier (--tiered) every routine counts its calls and the
+// backward jumps of its loops. Once the sum reaches the threshold the tier
+// is asked for native code, which replaces the bytecode from the next call
+// on.
+
+// Static type of a register or array element
+enum class VType : uint8_t { Int, Real, Bool, Char, String };
+
+// X(name): the bytecode operations. a, b and c are registers unless noted;
+// sN is a STRING register, #N an immediate, @N an instruction index.
+#define SSC_BYTECODE_OPS(X)                                                           \
+    X(MovI)     /* a = #b */                                                          \
+    X(MovR)     /* a = real constant b */                                             \
+    X(MovS)     /* sa = string constant b */                                          \
+    X(Mov)      /* a = b */                                                           \
+    X(MovStr)   /* sa = sb */                                                         \
+    X(AddI) X(SubI) X(MulI) X(DivI) /* a = b op c, INTEGER, wrapping */               \
+    X(AddImm)   /* a = b + #c, INTEGER */                                             \
+    X(MulImm)   /* a = b * #c, INTEGER */                                             \
+    X(AddR) X(SubR) X(MulR) X(DivR) /* a = b op c, REAL */                            \
+    X(NegI) X(NegR)                                                                   \
+    X(LtI) X(GtI) X(EqI) X(LeI) X(GeI) X(NeI) /* a = b cmp c, signed */               \
+    X(LtR) X(GtR) X(EqR) X(LeR) X(GeR) X(NeR) /* unordered, like FCMP_U* */           \
+    X(LtS) X(GtS) X(EqS) X(LeS) X(GeS) X(NeS) /* a = sb cmp sc */                     \
+    X(And) X(Or) X(Not)                                                               \
+    X(IntToReal) /* a = REAL(b) */                                                    \
+    X(CharToStr) /* sa = b as a one-character STRING */                               \
+    X(Concat)    /* sa = sb & sc */                                                   \
+    X(Jmp)       /* goto @a */                                                        \
+    X(JmpIf)     /* if a goto @b */                                                   \
+    X(JmpIfNot)  /* unless a goto @b */                                               \
+    X(OutI) X(OutR) X(OutC) X(OutB) X(OutS)                                           \
+    X(InI) X(InR) X(InC) X(InS)                                                       \
+    X(ALoad)     /* a = array b [c] */                                                \
+    X(AStore)    /* array a [b] = c */                                                \
+    X(SALoad)    /* sa = STRING array b [c] */                                        \
+    X(SAStore)   /* STRING array a [b] = sc */                                        \
+    X(SAClear)   /* every element of STRING array a = "" */                           \
+    X(Arg)       /* pass a to the next Call */                                        \
+    X(SArg)      /* pass sa to the next Call */                                       \
+    X(Call)      /* call routine #a, result in b (or sb), -1 for none */              \
+    X(Ret)       /* return a */                                                       \
+    X(SRet)      /* return sa */                                                      \
+    X(RetVoid)                                                                        \
+    X(NoReturn)  /* a FUNCTION ended without RETURN */                                \
+    X(Trunc)     /* a = INT(real b) */                                                \
+    X(ModI)      /* a = MOD(b, c) */                                                  \
+    X(DivZ)      /* a = DIV(b, c) */                                                  \
+    X(Sqrt)      /* a = SQRT(real b) */                                               \
+    X(Rand)      /* a = RAND(b) */                                                    \
+    X(SLen)      /* a = LENGTH(sb) */                                                 \
+    X(SMid)      /* sa = MID(sb, c, c + 1) */                                         \
+    X(SLeft)     /* sa = LEFT(sb, c) */                                               \
+    X(SRight)    /* sa = RIGHT(sb, c) */                                              \
+    X(SUpper) X(SLower) /* sa = UCASE/LCASE(sb) */                                    \
+    X(CUpper) X(CLower) /* a = UCASE/LCASE(CHAR b) */                                 \
+    X(Halt)
+
+enum class Op : uint32_t
+{
+#define SSC_BYTECODE_ENUM(name) name,
+    SSC_BYTECODE_OPS(SSC_BYTECODE_ENUM)
+#undef SSC_BYTECODE_ENUM
+};
+
+struct Instr
+{
+    Op op;
+    int32_t a, b, c;
+};
+
+// A fixed array of a routine, zeroed when its frame is created
+struct BytecodeArray
+{
+    VType element;
+    int32_t length;
+};
+
+struct BytecodeFunction
+{
+    std::string name;
+    std::vector<Instr> code;
+    int32_t numRegs = 0;
+    int32_t numStringRegs = 0;
+    std::vector<BytecodeArray> arrays;
+    // Parameters in order; each lands in paramRegs[i] of its register file
+    std::vector<VType> params;
+    std::vector<int32_t> paramRegs;
+    bool returnsValue = false;
+    VType returnType = VType::Int;
+};
+
+struct BytecodeProgram
+{
+    std::vector<BytecodeFunction> functions; // functions[0] is main
+    std::vector<double> reals;
+    std::vector<std::string> strings;
+};
+
+// A numeric register; CHAR and BOOLEAN are held in i
+union Register
+{
+    int32_t i;
+    double r;
+};
+
+// Native code for a routine: reads its arguments from args, one register
+// each in order, and stores its result, if any, in *result
+using NativeEntry = void (*)(const Register *args, Register *result);
+
+class NativeTier
+{
+public:
+    virtual ~NativeTier() = default;
+    // Native code for functions[index], or nullptr to stay in the bytecode
+    virtual NativeEntry compile(const BytecodeProgram &program, int32_t index) = 0;
+};
+
+// Compiles the top-level statements; nullptr, after printing the reason,
+// when the program needs something the interpreter does not support
+BytecodeProgram *compileBytecode(const std::vector<ASTNode *> &program);
+// Runs main and returns the program's exit status; with a tier, routines
+// whose calls and loop iterations reach threshold run as native code
+int runBytecode(const BytecodeProgram &program, NativeTier *tier = nullptr, uint64_t threshold = 0);
+// Lists the functions and their instructions on stderr
+void dumpBytecode(const BytecodeProgram &program);
+
+#endif // INTERPRETER_H
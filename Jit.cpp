@@ -0,0 +1,168 @@
+#include "Jit.h"
+#include "Optimizer.h"
+#include "Options.h"
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/Support/TargetSelect.h>
+
+using namespace llvm::orc;
+
+// Functions with a body in the program, and the ones compiled so far in the
+// order of their first calls. The JIT compiles on the calling thread.
+static size_t definedFunctions = 0;
+static std::vector<std::string> compiledFunctions;
+
+static int jitError(Error error)
+{
+    logAllUnhandledErrors(std::move(error), errs(), "JIT error: ");
+    return EXIT_FAILURE;
+}
+
+// The name a function has in the program: the JIT renames internal
+// functions to __orc_lcl.NAME.N and adds helpers of its own
+static std::string programName(StringRef name)
+{
+    if (name.consume_front("__orc_lcl."))
+        return name.rsplit('.').first.str();
+    if (name.startswith("__orc_") || name.startswith("__lljit"))
+        return "";
+    return name.str();
+}
+
+// Each partition the compile-on-demand layer hands down holds the one
+// function that was just called; it is optimized on its own here
+static Expected<ThreadSafeModule> compileRequested(ThreadSafeModule partition, MaterializationResponsibility &)
+{
+    partition.withModuleDo([](Module &part)
+                           {
+        for (Function &F : part)
+        {
+            std::string name = programName(F.getName());
+            if (!F.isDeclaration() && !name.empty())
+                compiledFunctions.push_back(name);
+        }
+        optimizeModule(part); });
+    return partition;
+}
+
+static void reportCompiled()
+{
+    fprintf(stderr, "JIT compiled %zu of %zu functions:", compiledFunctions.size(), definedFunctions);
+    for (const std::string &name : compiledFunctions)
+        fprintf(stderr, " %s", name.c_str());
+    fprintf(stderr, "\n");
+}
+
+// Moves M into a new lazy JIT that resolves libc, libm and anything else it
+// does not define from the compiler's own process
+static Expected<std::unique_ptr<LLLazyJIT>> createLazyJIT(Module &M)
+{
+    // The JIT owns the context of the modules it compiles, so the program
+    // moves into a context of its own as bitcode
+    SmallVector<char, 0> bitcode;
+    raw_svector_ostream stream(bitcode);
+    WriteBitcodeToFile(M, stream);
+    auto jitContext = std::make_unique<LLVMContext>();
+    Expected<std::unique_ptr<Module>> program =
+        parseBitcodeFile(MemoryBufferRef(StringRef(bitcode.data(), bitcode.size()), "program"), *jitContext);
+    if (!program)
+        return program.takeError();
+    for (Function &F : **program)
+    {
+        if (!F.isDeclaration())
+            definedFunctions++;
+    }
+
+    Expected<std::unique_ptr<LLLazyJIT>> jit = LLLazyJITBuilder().create();
+    if (!jit)
+        return jit.takeError();
+    (*jit)->setPartitionFunction(CompileOnDemandLayer::compileRequested);
+    (*jit)->getIRTransformLayer().setTransform(compileRequested);
+
+    JITDylib &mainDylib = (*jit)->getMainJITDylib();
+    Expected<std::unique_ptr<DynamicLibrarySearchGenerator>> process =
+        DynamicLibrarySearchGenerator::GetForCurrentProcess((*jit)->getDataLayout().getGlobalPrefix());
+    if (!process)
+        return process.takeError();
+    mainDylib.addGenerator(std::move(*process));
+
+    if (Error error = (*jit)->addLazyIRModule(ThreadSafeModule(std::move(*program), std::move(jitContext))))
+        return error;
+    return jit;
+}
+
+static bool verifyForJIT(Module &M)
+{
+    if (verifyModule(M, &errs()))
+    {
+        errs() << "Module verification failed, not running it\n";
+        return false;
+    }
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    return true;
+}
+
+int runLazyJIT(Module &M)
+{
+    if (!verifyForJIT(M))
+        return EXIT_FAILURE;
+    Expected<std::unique_ptr<LLLazyJIT>> jit = createLazyJIT(M);
+    if (!jit)
+        return jitError(jit.takeError());
+
+    JITDylib &mainDylib = (*jit)->getMainJITDylib();
+    // Global constructors register profiles and line counters with the runtime
+    if (Error error = (*jit)->initialize(mainDylib))
+        return jitError(std::move(error));
+    Expected<JITEvaluatedSymbol> entry = (*jit)->lookup("main");
+    if (!entry)
+        return jitError(entry.takeError());
+
+    fflush(stdout);
+    auto *programMain = jitTargetAddressToFunction<int (*)()>(entry->getAddress());
+    int status = programMain();
+
+    // Global destructors flush the program's output buffer
+    if (Error error = (*jit)->deinitialize(mainDylib))
+        return jitError(std::move(error));
+    if (compilerOptions.jitReport)
+        reportCompiled();
+
+    // Handlers the program registered with atexit run after this returns,
+    // so its code has to stay mapped
+    jit->release();
+    return status;
+}
+
+// The JIT of --tiered, alive until the process exits
+static LLLazyJIT *loadedJIT = nullptr;
+
+bool loadLazyJIT(Module &M)
+{
+    if (!verifyForJIT(M))
+        return false;
+    Expected<std::unique_ptr<LLLazyJIT>> jit = createLazyJIT(M);
+    if (!jit)
+    {
+        jitError(jit.takeError());
+        return false;
+    }
+    loadedJIT = jit->release();
+    return true;
+}
+
+void *lookupLazyJIT(const std::string &name)
+{
+    if (!loadedJIT)
+        return nullptr;
+    Expected<JITEvaluatedSymbol> symbol = loadedJIT->lookup(name);
+    if (!symbol)
+    {
+        jitError(symbol.takeError());
+        return nullptr;
+    }
+    return jitTargetAddressToPointer<void *>(symbol->getAddress());
+}
@@ -0,0 +1,28 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "common_includes.h"
+
+// Lazy JIT execution (--jit).
+//
+// Instead of printing IR, the program is handed to ORC's LLLazyJIT and its
+// main is called straight away. Every function (PROCEDURE, FUNCTION and the
+// runtime routines the program uses) starts as a stub; the first call
+// through a stub optimizes that one function at the -O level and compiles
+// it to machine code. Routines a run never calls are never compiled, so a
+// short test case starts as soon as its top-level code is ready.
+//
+// With --jit=report the functions that were compiled are listed on stderr
+// when main returns.
+
+// Runs M's main in the JIT and returns its exit status
+int runLazyJIT(Module &M);
+
+// For --tiered: loads M into a lazy JIT that stays alive until the process
+// exits, without running anything. False after reporting an error.
+bool loadLazyJIT(Module &M);
+// The address of a function of the loaded module, compiled on its first
+// call; nullptr after reporting an error
+void *lookupLazyJIT(const std::string &name);
+
+#endif // JIT_H
@@ -0,0 +1,113 @@
+#include "LineProfile.h"
+#include "AST.h"
+#include "Options.h"
+#include "Runtime.h"
+#include "SourceInput.h"
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
+extern int yylineno;
+
+// Arrays are per source file, so a module and the program that imports it
+// keep separate counts. They have common linkage until finishLineProfile, so
+// the copies in cached incremental units merge with the module's own.
+static const char *const CountsPrefix = "__ssc_lines.";
+static const char *const CyclesPrefix = "__ssc_cycles.";
+
+static std::string sourceName()
+{
+    if (!compilerOptions.inputFile)
+        return "stdin";
+    return std::string(llvm::sys::path::filename(compilerOptions.inputFile));
+}
+
+// counts[line] / cycles[line], one slot per source line
+static GlobalVariable *lineArray(const char *prefix)
+{
+    std::string name = prefix + sourceName();
+    if (GlobalVariable *array = module->getNamedGlobal(name))
+        return array;
+    ArrayType *type = ArrayType::get(builder.getInt64Ty(), yylineno + 1);
+    return new GlobalVariable(*module, type, false, GlobalValue::CommonLinkage, ConstantAggregateZero::get(type), name);
+}
+
+static void addToLine(GlobalVariable *array, int line, Value *amount)
+{
+    Value *slot = builder.CreateConstInBoundsGEP2_64(array->getValueType(), array, 0, line, "line.slot");
+    Value *value = builder.CreateLoad(builder.getInt64Ty(), slot, "line.value");
+    builder.CreateStore(builder.CreateAdd(value, amount, "line.add"), slot);
+}
+
+static Value *readCycles()
+{
+    return builder.CreateCall(Intrinsic::getDeclaration(module, Intrinsic::readcyclecounter), {}, "line.cycles");
+}
+
+// Definitions run no code where they appear, except arrays sized at run time
+static bool isExecutable(ASTNode *statement)
+{
+    auto *array = dynamic_cast<ArrayAST *>(statement);
+    return !dynamic_cast<ProcedureAST *>(statement) && !dynamic_cast<FuncAST *>(statement) &&
+           !dynamic_cast<DeclarationAST *>(statement) && !(array && !array->isDynamic()) &&
+           !dynamic_cast<ImportAST *>(statement);
+}
+
+static bool isLoop(ASTNode *statement)
+{
+    return dynamic_cast<ForAST *>(statement) || dynamic_cast<WhileAST *>(statement) ||
+           dynamic_cast<RepeatAST *>(statement);
+}
+
+Value *beginLineProfile(ASTNode *statement)
+{
+    if (!compilerOptions.profileLines || statement->line <= 0 || !isExecutable(statement))
+        return nullptr;
+
+    // Loops count their condition tests instead (countLoopTest)
+    if (!isLoop(statement))
+        addToLine(lineArray(CountsPrefix), statement->line, builder.getInt64(1));
+    return compilerOptions.profileCycles ? readCycles() : nullptr;
+}
+
+void endLineProfile(ASTNode *statement, Value *start)
+{
+    // Nothing can follow a RETURN in its block
+    BasicBlock *current = builder.GetInsertBlock();
+    if (start && current && !current->getTerminator())
+        addToLine(lineArray(CyclesPrefix), statement->line, builder.CreateSub(readCycles(), start, "line.elapsed"));
+}
+
+void countLoopTest(int line)
+{
+    if (compilerOptions.profileLines && line > 0)
+        addToLine(lineArray(CountsPrefix), line, builder.getInt64(1));
+}
+
+void finishLineProfile(Module &M)
+{
+    if (!compilerOptions.profileLines)
+        return;
+    GlobalVariable *counts = M.getNamedGlobal(CountsPrefix + sourceName());
+    if (!counts)
+        return;
+    GlobalVariable *cycles = M.getNamedGlobal(CyclesPrefix + sourceName());
+    counts->setLinkage(GlobalValue::InternalLinkage);
+    if (cycles)
+        cycles->setLinkage(GlobalValue::InternalLinkage);
+
+    // The runtime prints the source text of each executed line, so the program carries its source
+    Function *ctor = Function::Create(FunctionType::get(Type::getVoidTy(context), false), GlobalValue::InternalLinkage,
+                                      "__ssc_lines.register", M);
+    IRBuilder<> b(BasicBlock::Create(context, "entry", ctor));
+    PointerType *i64Ptr = PointerType::getUnqual(b.getInt64Ty());
+    unsigned lines = cast<ArrayType>(counts->getValueType())->getNumElements();
+    b.CreateCall(getRuntimeFunction("ssc_lines_register"),
+                 {b.CreateBitCast(counts, i64Ptr),
+                  cycles ? b.CreateBitCast(cycles, i64Ptr) : ConstantPointerNull::get(i64Ptr),
+                  b.getInt32(lines),
+                  b.CreateGlobalStringPtr(sourceName(), "lines.file", 0, &M),
+                  b.CreateGlobalStringPtr(StringRef(sourceInputText(), sourceInputSize()), "lines.source", 0, &M)});
+    b.CreateRetVoid();
+    appendToGlobalCtors(M, ctor, 0);
+}
@@ -0,0 +1,30 @@
+#ifndef LINE_PROFILE_H
+#define LINE_PROFILE_H
+
+#include "common_includes.h"
+
+class ASTNode;
+
+// Source-line execution profile (--profile-lines).
+//
+// Every statement increments counts[line] when it starts, where line is the
+// .ssc line the parser recorded for it; loop statements count each test of
+// their condition instead, so a loop line shows how often it iterated. The
+// counters are one plain i64 array per source file, indexed by line, with no
+// atomics. With --profile-lines=cycles each statement also adds the cycles
+// it took (including nested statements and calls) to cycles[line].
+//
+// At exit, or when the program is stopped by SIGXCPU, SIGINT or SIGTERM, the
+// runtime prints a table of the executed lines with their source text to
+// stderr (ssc_lines_register in ssc_runtime.c).
+
+// Called around the codegen of every statement (codegenStatement in AST.cpp);
+// begin returns the start cycle count for end, or nullptr
+Value *beginLineProfile(ASTNode *statement);
+void endLineProfile(ASTNode *statement, Value *start);
+// Counts one test of a loop condition; called at the start of the condition block
+void countLoopTest(int line);
+// Makes the counter arrays internal and registers them with the runtime
+void finishLineProfile(Module &M);
+
+#endif // LINE_PROFILE_H
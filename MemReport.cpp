@@ -0,0 +1,374 @@
+#include "MemReport.h"
+#include "IR.h"
+#include "Passes.h"
+#include <atomic>
+#include <map>
+#include <new>
+#include <sys/resource.h>
+#if defined(__GLIBCXX__) && !defined(__cpp_exceptions)
+#include <bits/functexcept.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+static const char *const phaseNames[] = {"init", "lex", "parse", "sema", "codegen", "optimize", "emit", "run"};
+static const size_t phaseCount = sizeof(phaseNames) / sizeof(phaseNames[0]);
+
+struct PhaseCounters
+{
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> allocated{0};
+    std::atomic<uint64_t> freed{0};
+    long rssGrowthKB = 0;
+};
+
+static bool enabled = false;
+static bool asJSON = false;
+static MemPhase current = MemPhase::Init;
+static PhaseCounters phases[phaseCount];
+// Bytes counted by new and not yet deleted; deletes of blocks from before
+// the report was enabled can take it below zero
+static std::atomic<int64_t> liveBytes{0};
+static std::atomic<int64_t> peakLiveBytes{0};
+static long peakRSSKB = 0;
+
+struct NodeClass
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+static std::map<std::string, NodeClass> astClasses;
+
+// --- Operator new and delete ---
+
+#if defined(__GLIBC__)
+static void countNew(void *block)
+{
+    if (!enabled)
+        return;
+    size_t size = malloc_usable_size(block);
+    PhaseCounters &phase = phases[static_cast<size_t>(current)];
+    phase.allocations.fetch_add(1, std::memory_order_relaxed);
+    phase.allocated.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        ;
+}
+
+static void countDelete(void *block)
+{
+    if (!enabled || !block)
+        return;
+    size_t size = malloc_usable_size(block);
+    phases[static_cast<size_t>(current)].freed.fetch_add(size, std::memory_order_relaxed);
+    liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+// Null when the heap is exhausted; alignment 0 is malloc's own
+static void *allocate(size_t size, size_t alignment = 0)
+{
+    void *block = nullptr;
+    if (alignment <= alignof(std::max_align_t))
+        block = malloc(size ? size : 1);
+    else if (posix_memalign(&block, alignment, size ? size : 1) != 0)
+        block = nullptr;
+    if (block)
+        countNew(block);
+    return block;
+}
+
+[[noreturn]] static void throwBadAlloc()
+{
+#if defined(__cpp_exceptions)
+    throw std::bad_alloc();
+#elif defined(__GLIBCXX__)
+    // The compiler is built with -fno-exceptions; libstdc++ throws it for us,
+    // as its own operator new does
+    std::__throw_bad_alloc();
+#else
+    abort();
+#endif
+}
+
+// The throwing forms retry through the new-handler before giving up
+static void *allocateOrThrow(size_t size, size_t alignment = 0)
+{
+    for (;;)
+    {
+        if (void *block = allocate(size, alignment))
+            return block;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throwBadAlloc();
+        handler();
+    }
+}
+
+static void release(void *block)
+{
+    countDelete(block);
+    free(block);
+}
+
+void *operator new(size_t size) { return allocateOrThrow(size); }
+void *operator new[](size_t size) { return allocateOrThrow(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void operator delete(void *block) noexcept { release(block); }
+void operator delete[](void *block) noexcept { release(block); }
+void operator delete(void *block, size_t) noexcept { release(block); }
+void operator delete[](void *block, size_t) noexcept { release(block); }
+void operator delete(void *block, const std::nothrow_t &) noexcept { release(block); }
+void operator delete[](void *block, const std::nothrow_t &) noexcept { release(block); }
+
+// Over-aligned types; posix_memalign's blocks are freed with free as well
+void *operator new(size_t size, std::align_val_t align) { return allocateOrThrow(size, size_t(align)); }
+void *operator new[](size_t size, std::align_val_t align) { return allocateOrThrow(size, size_t(align)); }
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return allocate(size, size_t(align));
+}
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return allocate(size, size_t(align));
+}
+void operator delete(void *block, std::align_val_t) noexcept { release(block); }
+void operator delete[](void *block, std::align_val_t) noexcept { release(block); }
+void operator delete(void *block, size_t, std::align_val_t) noexcept { release(block); }
+void operator delete[](void *block, size_t, std::align_val_t) noexcept { release(block); }
+void operator delete(void *block, std::align_val_t, const std::nothrow_t &) noexcept { release(block); }
+void operator delete[](void *block, std::align_val_t, const std::nothrow_t &) noexcept { release(block); }
+#endif
+
+// --- Phases ---
+
+static long maxRSSKB()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Charges the growth of the peak RSS since the last call to the current phase
+static void chargeRSS()
+{
+    long rss = maxRSSKB();
+    phases[static_cast<size_t>(current)].rssGrowthKB += rss - peakRSSKB;
+    peakRSSKB = rss;
+}
+
+void setMemPhase(MemPhase phase)
+{
+    // The lexer runs once per token, too often for getrusage; the RSS it
+    // adds is charged to the parser
+    if (enabled && phase != current && phase != MemPhase::Lex && current != MemPhase::Lex)
+        chargeRSS();
+    current = phase;
+}
+
+MemPhaseScope::MemPhaseScope(MemPhase phase) : previous(current)
+{
+    setMemPhase(phase);
+}
+
+MemPhaseScope::~MemPhaseScope()
+{
+    setMemPhase(previous);
+}
+
+// --- AST ---
+
+namespace
+{
+    size_t heapString(const std::string &s)
+    {
+        // Short strings live inside the std::string itself
+        return s.capacity() > 15 ? s.capacity() + 1 : 0;
+    }
+
+    template <class T>
+    size_t heapVector(const std::vector<T> &v)
+    {
+        return v.capacity() * sizeof(T);
+    }
+
+    // Counts each node under its class with the strings and vectors it owns
+    class ASTMemoryVisitor : public ASTVisitor
+    {
+    public:
+#define COUNT_NODE(Node, owned)                 \
+    void visit(Node &node) override             \
+    {                                           \
+        NodeClass &counts = astClasses[#Node];  \
+        counts.count++;                         \
+        counts.bytes += sizeof(Node) + (owned); \
+        ASTVisitor::visit(node);                \
+    }
+        COUNT_NODE(TypeAST, heapString(node.type))
+        COUNT_NODE(CharLiteralAST, 0)
+        COUNT_NODE(StringLiteralAST, heapString(node.value))
+        COUNT_NODE(IntegerLiteralAST, 0)
+        COUNT_NODE(RealLiteralAST, 0)
+        COUNT_NODE(DateLiteralAST, heapString(node.value))
+        COUNT_NODE(BooleanLiteralAST, 0)
+        COUNT_NODE(IdentifierAST, heapString(node.name))
+        COUNT_NODE(DeclarationAST, 0)
+        COUNT_NODE(ArrayAST, heapVector(node.bounds) + heapVector(node.boundExpressions))
+        COUNT_NODE(ListAST, 0)
+        COUNT_NODE(AssignmentAST, 0)
+        COUNT_NODE(ArrayAssignmentAST, heapVector(node.indices))
+        COUNT_NODE(ArrayAccessAST, heapVector(node.indices))
+        COUNT_NODE(OutputAST, heapVector(node.expressions) + heapVector(node.separators))
+        COUNT_NODE(InputAST, 0)
+        COUNT_NODE(FileAST, 0)
+        COUNT_NODE(BinaryOpAST, 0)
+        COUNT_NODE(UnaryOpAST, 0)
+        COUNT_NODE(ComparisonAST, 0)
+        COUNT_NODE(LogicalOpAST, 0)
+        COUNT_NODE(StatementBlockAST, heapVector(node.statements))
+        COUNT_NODE(IfAST, 0)
+        COUNT_NODE(ForAST, 0)
+        COUNT_NODE(WhileAST, 0)
+        COUNT_NODE(RepeatAST, 0)
+        COUNT_NODE(ParameterAST, heapString(node.name))
+        COUNT_NODE(ProcedureAST, heapVector(node.parameters))
+        COUNT_NODE(FuncAST, heapVector(node.parameters))
+        COUNT_NODE(ReturnAST, 0)
+        COUNT_NODE(FuncCallAST, heapString(node.name) + heapVector(node.arguments))
+        COUNT_NODE(ImportAST, heapString(node.moduleName) + heapVector(node.routines))
+#undef COUNT_NODE
+    };
+}
+
+void recordASTMemory(std::vector<ASTNode *> &program)
+{
+    if (!enabled)
+        return;
+    ASTMemoryVisitor visitor;
+    for (ASTNode *node : program)
+        if (node)
+            node->accept(visitor);
+}
+
+// --- Report ---
+
+struct ModuleSize
+{
+    size_t functions = 0, blocks = 0, instructions = 0, globals = 0;
+};
+
+static ModuleSize moduleSize()
+{
+    ModuleSize size;
+    if (!module)
+        return size;
+    for (Function &F : *module)
+    {
+        if (F.isDeclaration())
+            continue;
+        size.functions++;
+        for (BasicBlock &BB : F)
+        {
+            size.blocks++;
+            size.instructions += BB.size();
+        }
+    }
+    size.globals = module->global_size();
+    return size;
+}
+
+static void printText()
+{
+    fprintf(stderr, "Memory: peak RSS %ld KB, peak C++ heap %lld bytes\n", peakRSSKB,
+            (long long)peakLiveBytes.load());
+    fprintf(stderr, "  %-9s %12s %14s %14s %10s\n", "phase", "allocations", "allocated", "freed", "RSS KB");
+    for (size_t i = 0; i < phaseCount; i++)
+    {
+        const PhaseCounters &phase = phases[i];
+        fprintf(stderr, "  %-9s %12llu %14llu %14llu %10ld\n", phaseNames[i],
+                (unsigned long long)phase.allocations.load(), (unsigned long long)phase.allocated.load(),
+                (unsigned long long)phase.freed.load(), phase.rssGrowthKB);
+    }
+
+    uint64_t nodes = 0, bytes = 0;
+    for (const auto &entry : astClasses)
+    {
+        nodes += entry.second.count;
+        bytes += entry.second.bytes;
+    }
+    fprintf(stderr, "  AST: %llu nodes, %llu bytes before lowering, %zu bytes still allocated\n",
+            (unsigned long long)nodes, (unsigned long long)bytes, astLiveBytes());
+    for (const auto &entry : astClasses)
+        fprintf(stderr, "    %-20s %10llu nodes %12llu bytes\n", entry.first.c_str(),
+                (unsigned long long)entry.second.count, (unsigned long long)entry.second.bytes);
+
+    if (globalSymbolTable)
+    {
+        const SymbolTable::Stats &symbols = globalSymbolTable->getStats();
+        fprintf(stderr, "  Symbol table: peak %zu symbols in %zu scopes, %zu bytes; lookups copied %llu entries\n",
+                symbols.peakSymbols, symbols.peakScopes, symbols.peakBytes,
+                (unsigned long long)symbols.copiedEntries);
+    }
+    ModuleSize size = moduleSize();
+    fprintf(stderr, "  Module: %zu functions, %zu blocks, %zu instructions, %zu globals\n", size.functions,
+            size.blocks, size.instructions, size.globals);
+}
+
+static void printJSON()
+{
+    fprintf(stderr, "{\"peak_rss_kb\":%ld,\"peak_heap_bytes\":%lld,\"phases\":{", peakRSSKB,
+            (long long)peakLiveBytes.load());
+    for (size_t i = 0; i < phaseCount; i++)
+    {
+        const PhaseCounters &phase = phases[i];
+        fprintf(stderr, "%s\"%s\":{\"allocations\":%llu,\"allocated\":%llu,\"freed\":%llu,\"rss_kb\":%ld}",
+                i ? "," : "", phaseNames[i], (unsigned long long)phase.allocations.load(),
+                (unsigned long long)phase.allocated.load(), (unsigned long long)phase.freed.load(),
+                phase.rssGrowthKB);
+    }
+    fprintf(stderr, "},\"ast\":{\"live_bytes\":%zu,\"classes\":{", astLiveBytes());
+    bool first = true;
+    for (const auto &entry : astClasses)
+    {
+        fprintf(stderr, "%s\"%s\":{\"nodes\":%llu,\"bytes\":%llu}", first ? "" : ",", entry.first.c_str(),
+                (unsigned long long)entry.second.count, (unsigned long long)entry.second.bytes);
+        first = false;
+    }
+    fprintf(stderr, "}}");
+    if (globalSymbolTable)
+    {
+        const SymbolTable::Stats &symbols = globalSymbolTable->getStats();
+        fprintf(stderr, ",\"symbol_table\":{\"peak_symbols\":%zu,\"peak_scopes\":%zu,\"peak_bytes\":%zu,"
+                        "\"copied_entries\":%llu}",
+                symbols.peakSymbols, symbols.peakScopes, symbols.peakBytes,
+                (unsigned long long)symbols.copiedEntries);
+    }
+    ModuleSize size = moduleSize();
+    fprintf(stderr, ",\"module\":{\"functions\":%zu,\"blocks\":%zu,\"instructions\":%zu,\"globals\":%zu}}\n",
+            size.functions, size.blocks, size.instructions, size.globals);
+}
+
+static void printMemReport()
+{
+    chargeRSS();
+    enabled = false;
+    if (asJSON)
+        printJSON();
+    else
+        printText();
+}
+
+void enableMemReport(bool json)
+{
+    enabled = true;
+    asJSON = json;
+    peakRSSKB = maxRSSKB();
+    atexit(printMemReport);
+}
+
+bool memReportEnabled()
+{
+    return enabled;
+}
@@ -0,0 +1,44 @@
+#ifndef MEM_REPORT_H
+#define MEM_REPORT_H
+
+#include <stdint.h>
+#include <vector>
+
+class ASTNode;
+
+// Memory accounting (--mem-report).
+//
+// Once enabled, the global operator new and delete count every C++
+// allocation, LLVM's included, against the phase the compiler is in, and
+// the growth of the peak RSS is charged to the phase that caused it. At
+// exit the report adds the AST bytes by node class (taken just before the
+// statements are lowered), the AST still allocated, the symbol table's
+// largest size and the stack entries its lookups copied, and the size of
+// the LLVM module. Allocations made with malloc, such as the lexer's
+// buffers and the runtime's, only show in the RSS.
+
+enum class MemPhase : uint8_t { Init, Lex, Parse, Sema, Codegen, Optimize, Emit, Run };
+
+// Starts counting; the report is printed to stderr at exit, as one line of
+// JSON when json is set
+void enableMemReport(bool json);
+bool memReportEnabled();
+
+// Charges what follows to phase
+void setMemPhase(MemPhase phase);
+
+// Makes phase current until the end of the scope
+class MemPhaseScope
+{
+public:
+    explicit MemPhaseScope(MemPhase phase);
+    ~MemPhaseScope();
+
+private:
+    MemPhase previous;
+};
+
+// Adds the nodes of the top-level statements to the AST bytes by class
+void recordASTMemory(std::vector<ASTNode *> &program);
+
+#endif // MEM_REPORT_H
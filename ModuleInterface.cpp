@@ -0,0 +1,151 @@
+#include "ModuleInterface.h"
+#include "AST.h"
+#include <llvm/Support/FileSystem.h>
+
+using namespace ssci;
+
+static const char *const TypeNames[] = {"", "INTEGER", "REAL", "STRING", "CHAR", "BOOLEAN", "DATE"};
+static const size_t TypeNameCount = sizeof(TypeNames) / sizeof(TypeNames[0]);
+
+static bool encodeType(const std::string &name, uint8_t &code)
+{
+    for (size_t i = 0; i < TypeNameCount; i++)
+    {
+        if (name == TypeNames[i])
+        {
+            code = static_cast<uint8_t>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<ModuleInterface> ModuleInterface::load(const std::string &path)
+{
+    // Large interfaces are mmapped by MemoryBuffer; nothing is copied or parsed up front
+    auto buffer = MemoryBuffer::getFile(path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!buffer)
+    {
+        llvm::errs() << "Module error: cannot open interface " << path << ": " << buffer.getError().message() << "\n";
+        return nullptr;
+    }
+
+    const char *base = buffer.get()->getBufferStart();
+    size_t fileSize = buffer.get()->getBufferSize();
+    auto *header = reinterpret_cast<const InterfaceHeader *>(base);
+
+    bool valid = fileSize >= sizeof(InterfaceHeader) &&
+                 memcmp(header->magic, Magic, sizeof(Magic)) == 0 &&
+                 header->version == Version &&
+                 sizeof(InterfaceHeader) + uint64_t(header->functionCount) * sizeof(InterfaceFunction) <= header->paramTypesOffset &&
+                 uint64_t(header->paramTypesOffset) + header->paramTypesSize <= fileSize &&
+                 uint64_t(header->stringsOffset) + header->stringsSize <= fileSize;
+    if (!valid)
+    {
+        llvm::errs() << "Module error: " << path << " is not an SSC interface file (or has a different version)\n";
+        return nullptr;
+    }
+
+    std::unique_ptr<ModuleInterface> iface(new ModuleInterface());
+    iface->header = header;
+    iface->functions = reinterpret_cast<const InterfaceFunction *>(base + sizeof(InterfaceHeader));
+    iface->paramTypes = reinterpret_cast<const uint8_t *>(base + header->paramTypesOffset);
+    iface->strings = base + header->stringsOffset;
+
+    for (size_t i = 0; i < header->functionCount; i++)
+    {
+        const InterfaceFunction &fn = iface->functions[i];
+        bool ok = uint64_t(fn.nameOffset) + fn.nameLength <= header->stringsSize &&
+                  uint64_t(fn.paramOffset) + fn.paramCount <= header->paramTypesSize &&
+                  fn.returnType < TypeNameCount;
+        for (size_t p = 0; ok && p < fn.paramCount; p++)
+            ok = iface->paramTypes[fn.paramOffset + p] != Void && iface->paramTypes[fn.paramOffset + p] < TypeNameCount;
+        if (!ok)
+        {
+            llvm::errs() << "Module error: corrupt routine entry " << i << " in " << path << "\n";
+            return nullptr;
+        }
+    }
+
+    iface->buffer = std::move(*buffer);
+    return iface;
+}
+
+bool ModuleInterface::write(const std::string &path, const std::vector<RoutineSignature> &routines)
+{
+    std::vector<InterfaceFunction> records;
+    std::vector<uint8_t> types;
+    std::string strings;
+
+    for (const RoutineSignature &routine : routines)
+    {
+        InterfaceFunction fn = {};
+        fn.nameOffset = strings.size();
+        fn.nameLength = routine.name.size();
+        fn.paramOffset = types.size();
+        fn.paramCount = routine.paramTypes.size();
+        if (routine.paramTypes.size() > UINT8_MAX || !encodeType(routine.returnType, fn.returnType))
+        {
+            llvm::errs() << "Module error: cannot export " << routine.name << "\n";
+            return false;
+        }
+        for (const std::string &param : routine.paramTypes)
+        {
+            uint8_t code;
+            if (param.empty() || !encodeType(param, code))
+            {
+                llvm::errs() << "Module error: cannot export parameter type " << param << " of " << routine.name << "\n";
+                return false;
+            }
+            types.push_back(code);
+        }
+        strings += routine.name;
+        records.push_back(fn);
+    }
+
+    InterfaceHeader header = {};
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.functionCount = records.size();
+    header.paramTypesOffset = sizeof(InterfaceHeader) + records.size() * sizeof(InterfaceFunction);
+    header.paramTypesSize = types.size();
+    header.stringsOffset = header.paramTypesOffset + header.paramTypesSize;
+    header.stringsSize = strings.size();
+
+    std::error_code ec;
+    raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+    if (ec)
+    {
+        llvm::errs() << "Module error: cannot write " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(InterfaceFunction));
+    out.write(reinterpret_cast<const char *>(types.data()), types.size());
+    out << strings;
+    return true;
+}
+
+RoutineSignature ModuleInterface::routine(size_t i) const
+{
+    const InterfaceFunction &fn = functions[i];
+    RoutineSignature sig;
+    sig.name.assign(strings + fn.nameOffset, fn.nameLength);
+    sig.returnType = TypeNames[fn.returnType];
+    for (size_t p = 0; p < fn.paramCount; p++)
+        sig.paramTypes.push_back(TypeNames[paramTypes[fn.paramOffset + p]]);
+    return sig;
+}
+
+llvm::Type *ModuleInterface::typeOf(const std::string &typeName)
+{
+    if (typeName.empty())
+        return Type::getVoidTy(context);
+    return TypeAST::typeMap.at(typeName)(context);
+}
+
+std::vector<std::string> &importedInterfaces()
+{
+    static std::vector<std::string> paths;
+    return paths;
+}
@@ -0,0 +1,90 @@
+#ifndef MODULE_INTERFACE_H
+#define MODULE_INTERFACE_H
+
+#include "common_includes.h"
+#include <llvm/Support/MemoryBuffer.h>
+#include <cstdint>
+
+// Binary interface (.ssci) of a separately compiled SSC module.
+//
+// The file is a flat little-endian image that is used in place after being
+// mapped: a header, a fixed-size record per exported routine, the parameter
+// type codes of all routines and a string table holding their names.
+//
+//   InterfaceHeader | InterfaceFunction[functionCount] | uint8_t paramTypes[] | char strings[]
+
+namespace ssci
+{
+    const char Magic[4] = {'S', 'S', 'C', 'I'};
+    const uint32_t Version = 1;
+
+    // Type codes; Void is only valid as a return type
+    enum TypeCode : uint8_t
+    {
+        Void,
+        Integer,
+        Real,
+        String,
+        Char,
+        Boolean,
+        Date
+    };
+
+    struct InterfaceHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t functionCount;
+        uint32_t paramTypesOffset;
+        uint32_t paramTypesSize;
+        uint32_t stringsOffset;
+        uint32_t stringsSize;
+    };
+
+    struct InterfaceFunction
+    {
+        uint32_t nameOffset; // into the string table
+        uint32_t nameLength;
+        uint32_t paramOffset; // into the parameter type array
+        uint8_t paramCount;
+        uint8_t returnType;
+        uint16_t reserved;
+    };
+}
+
+// Signature of an exported routine in SSC type names ("INTEGER", ...)
+struct RoutineSignature
+{
+    std::string name;
+    std::string returnType; // empty for a PROCEDURE
+    std::vector<std::string> paramTypes;
+};
+
+class ModuleInterface
+{
+public:
+    // Maps an interface file; returns null (after reporting) when it is missing or malformed
+    static std::unique_ptr<ModuleInterface> load(const std::string &path);
+
+    // Writes the interface for the given routines
+    static bool write(const std::string &path, const std::vector<RoutineSignature> &routines);
+
+    size_t size() const { return header->functionCount; }
+    RoutineSignature routine(size_t i) const;
+
+    // llvm::Type of a signature type name, void for an empty name
+    static llvm::Type *typeOf(const std::string &typeName);
+
+private:
+    std::unique_ptr<llvm::MemoryBuffer> buffer;
+    const ssci::InterfaceHeader *header = nullptr;
+    const ssci::InterfaceFunction *functions = nullptr;
+    const uint8_t *paramTypes = nullptr;
+    const char *strings = nullptr;
+};
+
+// Paths of the interfaces loaded by IMPORT, in order; -o links the object
+// next to each one into the executable
+std::vector<std::string> &importedInterfaces();
+
+#endif // MODULE_INTERFACE_H
@@ -0,0 +1,49 @@
+#include "Optimizer.h"
+#include "Options.h"
+#include "Target.h"
+#include <llvm/Passes/PassBuilder.h>
+
+// The vectorizer and inliner cost their choices for the selected target.
+// The JIT optimizes one function at a time, so the machine is kept.
+static TargetMachine *targetMachine(const std::string &triple)
+{
+    static std::unique_ptr<TargetMachine> machine;
+    static std::string machineTriple;
+    if (triple.empty())
+        return nullptr;
+    if (!machine || machineTriple != triple)
+    {
+        machine = createTargetMachine(triple, CodeGenOpt::Default, TargetOptions());
+        machineTriple = triple;
+    }
+    return machine.get();
+}
+
+bool optimizeModule(Module &M)
+{
+    if (verifyModule(M, &errs()))
+    {
+        errs() << "Module verification failed, skipping optimization\n";
+        return false;
+    }
+    if (compilerOptions.optLevel == 0)
+        return true;
+
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+
+    PassBuilder PB(targetMachine(M.getTargetTriple()));
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    static const OptimizationLevel levels[] = {OptimizationLevel::O0, OptimizationLevel::O1,
+                                               OptimizationLevel::O2, OptimizationLevel::O3};
+    ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(levels[compilerOptions.optLevel]);
+    MPM.run(M, MAM);
+    return true;
+}
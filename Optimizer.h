@@ -0,0 +1,9 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "common_includes.h"
+
+// Verifies the module and runs the LLVM pipeline for the -O level in compilerOptions
+bool optimizeModule(Module &M);
+
+#endif // OPTIMIZER_H
@@ -0,0 +1,330 @@
+#include "Options.h"
+#include "Profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+CompilerOptions compilerOptions;
+
+// Matches "--name=value" and returns the value part
+static const char *optionValue(const char *arg, const char *name)
+{
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) == 0 && arg[len] == '=')
+        return arg + len + 1;
+    return nullptr;
+}
+
+bool parseCommandLine(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = nullptr;
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            printUsage(argv[0]);
+            return false;
+        }
+        else if ((value = optionValue(arg, "--incremental")))
+        {
+            compilerOptions.incrementalDir = value;
+        }
+        else if (strncmp(arg, "-I", 2) == 0)
+        {
+            if (arg[2] != '\0')
+                compilerOptions.importPaths.push_back(arg + 2);
+            else if (i + 1 < argc)
+                compilerOptions.importPaths.push_back(argv[++i]);
+            else
+            {
+                fprintf(stderr, "Missing directory after -I\n");
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--module") == 0)
+        {
+            compilerOptions.moduleMode = true;
+        }
+        else if ((value = optionValue(arg, "--emit-interface")))
+        {
+            compilerOptions.interfaceFile = value;
+        }
+        else if (strcmp(arg, "--stream") == 0)
+        {
+            compilerOptions.stream = true;
+        }
+        else if (strcmp(arg, "--no-link-runtime") == 0)
+        {
+            compilerOptions.linkRuntime = false;
+        }
+        else if (strcmp(arg, "--profile-generate") == 0)
+        {
+            compilerOptions.profileGenerate = "ssc.prof";
+        }
+        else if ((value = optionValue(arg, "--profile-generate")))
+        {
+            compilerOptions.profileGenerate = value;
+        }
+        else if ((value = optionValue(arg, "--profile-use")))
+        {
+            compilerOptions.profileUse = value;
+        }
+        else if (strcmp(arg, "-g") == 0)
+        {
+            compilerOptions.debugInfo = true;
+        }
+        else if (strcmp(arg, "--profile-lines") == 0)
+        {
+            compilerOptions.profileLines = true;
+        }
+        else if ((value = optionValue(arg, "--profile-lines")))
+        {
+            if (strcmp(value, "cycles") != 0)
+            {
+                fprintf(stderr, "Unknown --profile-lines mode: %s\n", value);
+                return false;
+            }
+            compilerOptions.profileLines = true;
+            compilerOptions.profileCycles = true;
+        }
+        else if (strcmp(arg, "--jit") == 0)
+        {
+            compilerOptions.jit = true;
+        }
+        else if ((value = optionValue(arg, "--jit")))
+        {
+            if (strcmp(value, "report") != 0)
+            {
+                fprintf(stderr, "Unknown --jit mode: %s\n", value);
+                return false;
+            }
+            compilerOptions.jit = true;
+            compilerOptions.jitReport = true;
+        }
+        else if (strcmp(arg, "--interp") == 0)
+        {
+            compilerOptions.interp = true;
+        }
+        else if ((value = optionValue(arg, "--interp")))
+        {
+            if (strcmp(value, "dump") != 0)
+            {
+                fprintf(stderr, "Unknown --interp mode: %s\n", value);
+                return false;
+            }
+            compilerOptions.interp = true;
+            compilerOptions.dumpBytecode = true;
+        }
+        else if (strcmp(arg, "--tiered") == 0)
+        {
+            compilerOptions.interp = true;
+            compilerOptions.tiered = true;
+        }
+        else if ((value = optionValue(arg, "--tier-threshold")))
+        {
+            int threshold = atoi(value);
+            if (threshold < 1)
+            {
+                fprintf(stderr, "--tier-threshold needs a positive number\n");
+                return false;
+            }
+            compilerOptions.tierThreshold = threshold;
+        }
+        else if ((value = optionValue(arg, "--emit-objects")))
+        {
+            compilerOptions.objectPrefix = value;
+        }
+        else if (strcmp(arg, "-o") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Missing file after -o\n");
+                return false;
+            }
+            compilerOptions.outputFile = argv[++i];
+        }
+        else if (strncmp(arg, "-j", 2) == 0)
+        {
+            const char *count = arg[2] != '\0' ? arg + 2 : (i + 1 < argc ? argv[++i] : "");
+            int jobs = atoi(count);
+            if (jobs < 1)
+            {
+                fprintf(stderr, "-j needs a number of threads\n");
+                return false;
+            }
+            compilerOptions.jobs = jobs;
+        }
+        else if ((value = optionValue(arg, "--march")))
+        {
+            compilerOptions.march = value;
+        }
+        else if ((value = optionValue(arg, "--mcpu")))
+        {
+            compilerOptions.mcpu = value;
+        }
+        else if ((value = optionValue(arg, "--target-features")))
+        {
+            compilerOptions.targetFeatures = value;
+        }
+        else if (strcmp(arg, "--multiversion") == 0)
+        {
+            compilerOptions.multiversion = true;
+        }
+        else if (strcmp(arg, "--lex-bench") == 0)
+        {
+            compilerOptions.lexBench = true;
+        }
+        else if (strcmp(arg, "--ast-stats") == 0)
+        {
+            compilerOptions.astStats = true;
+        }
+        else if (strcmp(arg, "--time-passes") == 0)
+        {
+            compilerOptions.timePasses = true;
+        }
+        else if (strcmp(arg, "--mem-report") == 0)
+        {
+            compilerOptions.memReport = true;
+        }
+        else if ((value = optionValue(arg, "--mem-report")))
+        {
+            if (strcmp(value, "json") != 0)
+            {
+                fprintf(stderr, "Unknown --mem-report format: %s\n", value);
+                return false;
+            }
+            compilerOptions.memReport = true;
+            compilerOptions.memReportJSON = true;
+        }
+        else if (arg[0] == '-' && arg[1] == 'O' && arg[2] >= '0' && arg[2] <= '3' && arg[3] == '\0')
+        {
+            compilerOptions.optLevel = arg[2] - '0';
+        }
+        else if (arg[0] == '-' && arg[1] != '\0')
+        {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            printUsage(argv[0]);
+            return false;
+        }
+        else if (!compilerOptions.inputFile)
+        {
+            compilerOptions.inputFile = arg;
+        }
+        else
+        {
+            fprintf(stderr, "Only one input file is supported: %s\n", arg);
+            return false;
+        }
+    }
+    if (!compilerOptions.profileGenerate.empty() && !compilerOptions.profileUse.empty())
+    {
+        fprintf(stderr, "--profile-generate and --profile-use cannot be combined\n");
+        return false;
+    }
+    // The cache plans its units from the whole program before any codegen
+    if (compilerOptions.stream && !compilerOptions.incrementalDir.empty())
+    {
+        fprintf(stderr, "--stream cannot be combined with --incremental\n");
+        return false;
+    }
+    // Profile checksums cover all of main, which --stream never holds at once
+    if (compilerOptions.stream && (!compilerOptions.profileGenerate.empty() || !compilerOptions.profileUse.empty()))
+    {
+        fprintf(stderr, "--stream cannot be combined with --profile-generate or --profile-use\n");
+        return false;
+    }
+    // The program reads stdin, and it needs main and the runtime in the JIT
+    if (compilerOptions.jit && (!compilerOptions.inputFile || compilerOptions.moduleMode || !compilerOptions.linkRuntime))
+    {
+        fprintf(stderr, "--jit needs a source file and cannot be combined with --module or --no-link-runtime\n");
+        return false;
+    }
+    // The executable gets its runtime from the module and has a main
+    if (!compilerOptions.outputFile.empty() &&
+        (compilerOptions.moduleMode || !compilerOptions.linkRuntime || compilerOptions.jit ||
+         compilerOptions.interp || !compilerOptions.objectPrefix.empty()))
+    {
+        fprintf(stderr, "-o cannot be combined with --module, --no-link-runtime, --jit, --interp or --emit-objects\n");
+        return false;
+    }
+    // Programs the bytecode cannot run fall back to the JIT, so the same applies
+    if (compilerOptions.interp && (!compilerOptions.inputFile || compilerOptions.moduleMode || !compilerOptions.linkRuntime))
+    {
+        fprintf(stderr, "--interp needs a source file and cannot be combined with --module or --no-link-runtime\n");
+        return false;
+    }
+    // The bytecode is compiled from the whole program at once
+    if (compilerOptions.interp && compilerOptions.stream)
+    {
+        fprintf(stderr, "--interp cannot be combined with --stream\n");
+        return false;
+    }
+    // Counters and debug info would only cover the routines that went native
+    if (compilerOptions.tiered && (compilerOptions.debugInfo || compilerOptions.profileLines ||
+                                   !compilerOptions.profileGenerate.empty() || !compilerOptions.profileUse.empty()))
+    {
+        fprintf(stderr, "--tiered cannot be combined with -g, --profile-lines, --profile-generate or --profile-use\n");
+        return false;
+    }
+    // Code for another architecture cannot run in the compiler
+    if (!compilerOptions.march.empty() && (compilerOptions.jit || compilerOptions.interp))
+    {
+        fprintf(stderr, "--march cannot be combined with --jit, --interp or --tiered\n");
+        return false;
+    }
+    // The routines --tiered compiles never pass through the module the dispatchers are added to
+    if (compilerOptions.multiversion && compilerOptions.tiered)
+    {
+        fprintf(stderr, "--multiversion cannot be combined with --tiered\n");
+        return false;
+    }
+    return true;
+}
+
+void printUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [options] [file.ssc]\n", program);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --incremental=DIR   Reuse cached bitcode for unchanged PROCEDURE/FUNCTION units\n");
+    fprintf(stderr, "  -I DIR              Search DIR for the interfaces of IMPORTed modules\n");
+    fprintf(stderr, "  --module            Compile a module: routines only, no main function\n");
+    fprintf(stderr, "  --emit-interface=FILE  Write the exported routine signatures to FILE (.ssci)\n");
+    fprintf(stderr, "  --stream            Check and generate each top-level statement as soon as it is parsed\n");
+    fprintf(stderr, "  --no-link-runtime   Do not link the embedded runtime; link ssc_runtime.o instead\n");
+    fprintf(stderr, "  -O0 .. -O3          Optimization level (runs after the runtime is linked)\n");
+    fprintf(stderr, "  -g                  Emit DWARF debug info for gdb and perf\n");
+    fprintf(stderr, "  --profile-generate[=FILE]  Count branches and calls, add them to FILE (ssc.prof) at exit\n");
+    fprintf(stderr, "  --profile-use=FILE[,FILE]  Optimize with branch weights and entry counts from profiles\n");
+    fprintf(stderr, "  --profile-lines[=cycles]  Count executions (and cycles) of every source line, report at exit\n");
+    fprintf(stderr, "  -o FILE             Compile and link an executable in-process (no llc or linker needed)\n");
+    fprintf(stderr, "  --emit-objects=PREFIX  Generate machine code into PREFIX.0.o, PREFIX.1.o, ... instead of IR\n");
+    fprintf(stderr, "  -j N                Use N threads and objects for --emit-objects\n");
+    fprintf(stderr, "  --march=ARCH        Generate code for ARCH (x86-64, aarch64, ...) as llc would\n");
+    fprintf(stderr, "  --mcpu=CPU          Generate code for CPU; native for the one compiling\n");
+    fprintf(stderr, "  --target-features=+F,-G  Enable or disable CPU features on top of --mcpu's\n");
+    fprintf(stderr, "  --multiversion      Build SSE4.2, AVX2 and AVX-512 versions of loops, chosen when called\n");
+    fprintf(stderr, "  --jit[=report]      Run the program, compiling each routine on its first call (and list them)\n");
+    fprintf(stderr, "  --interp[=dump]     Run the program in the bytecode interpreter (and list the bytecode)\n");
+    fprintf(stderr, "  --tiered            Start in the interpreter and run hot routines as JIT-compiled native code\n");
+    fprintf(stderr, "  --tier-threshold=N  Calls plus loop iterations before a routine goes native (1000)\n");
+    fprintf(stderr, "  --lex-bench         Only run the lexer over the input and report tokens/sec\n");
+    fprintf(stderr, "  --ast-stats         Report the number of AST nodes and bytes per node\n");
+    fprintf(stderr, "  --time-passes       Report the time spent in each AST pass (sema, fold, loops, lower)\n");
+    fprintf(stderr, "  --mem-report[=json] Report memory use by phase, AST class, symbol table and module at exit\n");
+    fprintf(stderr, "  --help              Display this help message\n");
+}
+
+std::string codegenFingerprint()
+{
+    std::string salt = "ssc-ir-v3";
+    std::string profile = profileCodegenKey();
+    if (!profile.empty())
+        salt += "+" + profile;
+    if (compilerOptions.profileLines)
+        salt += compilerOptions.profileCycles ? "+lines-cycles" : "+lines";
+    if (compilerOptions.debugInfo)
+        salt += "+g";
+    return salt;
+}
@@ -0,0 +1,52 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+
+// Command line options for ssc_compiler
+struct CompilerOptions
+{
+    const char *inputFile = nullptr;      // source file, stdin when null
+    std::string incrementalDir;           // --incremental=DIR bitcode cache
+    std::vector<std::string> importPaths; // -I DIR, searched for IMPORTed .ssci files
+    bool moduleMode = false;              // --module: routines only, no main
+    std::string interfaceFile;            // --emit-interface=FILE
+    bool linkRuntime = true;              // --no-link-runtime leaves ssc_ calls external
+    unsigned optLevel = 0;                // -O0 .. -O3
+    bool stream = false;                  // --stream: generate each top-level statement as it is parsed
+    bool lexBench = false;                // --lex-bench: run only the lexer and time it
+    bool astStats = false;                // --ast-stats: report AST node counts and sizes
+    bool timePasses = false;              // --time-passes: report the time of each AST pass
+    bool memReport = false;               // --mem-report[=json]: report memory use per phase at exit
+    bool memReportJSON = false;
+    std::string profileGenerate;          // --profile-generate[=FILE]: instrument, write FILE at exit
+    std::string profileUse;               // --profile-use=FILE[,FILE...]
+    bool profileLines = false;            // --profile-lines: per-line execution counts
+    bool profileCycles = false;           // --profile-lines=cycles: also cycles per line
+    bool debugInfo = false;               // -g: DWARF line tables and variables
+    bool jit = false;                     // --jit: run main now, compile each function on its first call
+    bool jitReport = false;               // --jit=report: also list the compiled functions
+    bool interp = false;                  // --interp: run the program in the bytecode interpreter
+    bool dumpBytecode = false;            // --interp=dump: also list the bytecode
+    bool tiered = false;                  // --tiered: interpret, then run hot routines as native code
+    unsigned tierThreshold = 1000;        // --tier-threshold=N: calls plus loop iterations before a routine goes native
+    std::string outputFile;               // -o FILE: link an executable in-process instead of printing IR
+    std::string objectPrefix;             // --emit-objects=PREFIX: write PREFIX.N.o instead of IR
+    unsigned jobs = 1;                    // -jN: threads (and objects) for --emit-objects
+    std::string march;                    // --march=ARCH: target architecture, as for llc
+    std::string mcpu;                     // --mcpu=CPU: target CPU, native for the host's
+    std::string targetFeatures;           // --target-features=+F,-G: on top of the CPU's
+    bool multiversion = false;            // --multiversion: SSE4.2/AVX2/AVX-512 versions of loops, picked at run time
+};
+
+extern CompilerOptions compilerOptions;
+
+// Parses argv into compilerOptions, returns false on a bad option
+bool parseCommandLine(int argc, char **argv);
+void printUsage(const char *program);
+
+// Options that change the generated IR; mixed into incremental cache keys
+std::string codegenFingerprint();
+
+#endif // OPTIONS_H
@@ -0,0 +1,43 @@
+#include "ParallelCodegen.h"
+#include "Target.h"
+#include <llvm/CodeGen/ParallelCG.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Target/TargetOptions.h>
+
+bool emitObjects(Module &M, const std::string &prefix, unsigned jobs)
+{
+    if (verifyModule(M, &errs()))
+    {
+        errs() << "Module verification failed, not generating code\n";
+        return false;
+    }
+    std::string triple = M.getTargetTriple();
+    std::unique_ptr<TargetMachine> machine = createTargetMachine(triple, CodeGenOpt::Default, TargetOptions());
+    if (!machine)
+        return false;
+    M.setDataLayout(machine->createDataLayout());
+    // Every partition gets a TargetMachine of its own; they are not shared between threads
+    auto makeTargetMachine = [triple]()
+    { return createTargetMachine(triple, CodeGenOpt::Default, TargetOptions()); };
+
+    std::vector<std::unique_ptr<raw_fd_ostream>> files;
+    std::vector<raw_pwrite_stream *> streams;
+    for (unsigned i = 0; i < std::max(jobs, 1u); ++i)
+    {
+        std::string path = prefix + "." + std::to_string(i) + ".o";
+        std::error_code ec;
+        files.push_back(std::make_unique<raw_fd_ostream>(path, ec, sys::fs::OF_None));
+        if (ec)
+        {
+            errs() << "Cannot write " << path << ": " << ec.message() << "\n";
+            return false;
+        }
+        streams.push_back(files.back().get());
+    }
+
+    splitCodeGen(M, streams, {}, makeTargetMachine, CGFT_ObjectFile);
+    for (auto &file : files)
+        file->close();
+    fprintf(stderr, "Wrote %zu objects %s.*.o\n", files.size(), prefix.c_str());
+    return true;
+}
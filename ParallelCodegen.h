@@ -0,0 +1,19 @@
+#ifndef PARALLEL_CODEGEN_H
+#define PARALLEL_CODEGEN_H
+
+#include "common_includes.h"
+
+// Native code generation on several threads (--emit-objects with -j).
+//
+// Once the module has been generated and optimized, it is split into up to
+// jobs partitions of whole functions (llvm::SplitModule); symbols local to
+// one partition but used by another are promoted to hidden globals. Each
+// partition is moved into an LLVMContext of its own as bitcode and compiled
+// to PREFIX.N.o on its own thread, so a program with many routines takes
+// about as long as its largest partition. Linking the objects together
+// gives the same program as compiling the whole module with llc.
+
+// Writes the objects for M and returns false on an error
+bool emitObjects(Module &M, const std::string &prefix, unsigned jobs);
+
+#endif // PARALLEL_CODEGEN_H
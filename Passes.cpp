@@ -0,0 +1,447 @@
+#include "Passes.h"
+#include <climits>
+
+#define DEFINE_ACCEPT(Node) \
+    void Node::accept(ASTVisitor &visitor) { visitor.visit(*this); }
+
+DEFINE_ACCEPT(TypeAST)
+DEFINE_ACCEPT(CharLiteralAST)
+DEFINE_ACCEPT(StringLiteralAST)
+DEFINE_ACCEPT(IntegerLiteralAST)
+DEFINE_ACCEPT(RealLiteralAST)
+DEFINE_ACCEPT(DateLiteralAST)
+DEFINE_ACCEPT(BooleanLiteralAST)
+DEFINE_ACCEPT(IdentifierAST)
+DEFINE_ACCEPT(DeclarationAST)
+DEFINE_ACCEPT(ArrayAST)
+DEFINE_ACCEPT(ListAST)
+DEFINE_ACCEPT(AssignmentAST)
+DEFINE_ACCEPT(ArrayAssignmentAST)
+DEFINE_ACCEPT(ArrayAccessAST)
+DEFINE_ACCEPT(OutputAST)
+DEFINE_ACCEPT(InputAST)
+DEFINE_ACCEPT(FileAST)
+DEFINE_ACCEPT(BinaryOpAST)
+DEFINE_ACCEPT(UnaryOpAST)
+DEFINE_ACCEPT(ComparisonAST)
+DEFINE_ACCEPT(LogicalOpAST)
+DEFINE_ACCEPT(StatementBlockAST)
+DEFINE_ACCEPT(IfAST)
+DEFINE_ACCEPT(ForAST)
+DEFINE_ACCEPT(WhileAST)
+DEFINE_ACCEPT(RepeatAST)
+DEFINE_ACCEPT(ParameterAST)
+DEFINE_ACCEPT(ProcedureAST)
+DEFINE_ACCEPT(FuncAST)
+DEFINE_ACCEPT(ReturnAST)
+DEFINE_ACCEPT(FuncCallAST)
+DEFINE_ACCEPT(ImportAST)
+
+// --- Default traversal: children left to right ---
+
+void ASTVisitor::visitSlot(ASTNode *&slot)
+{
+    if (slot)
+        slot->accept(*this);
+}
+
+void ASTVisitor::visitSlots(std::vector<ASTNode *> &slots)
+{
+    for (ASTNode *&slot : slots)
+        visitSlot(slot);
+}
+
+void ASTVisitor::visit(DeclarationAST &node)
+{
+    visitChild(node.identifier);
+    visitChild(node.type);
+}
+
+void ASTVisitor::visit(ArrayAST &node)
+{
+    visitChild(node.identifier);
+    visitChild(node.type);
+    visitSlots(node.boundExpressions);
+}
+
+void ASTVisitor::visit(ListAST &node)
+{
+    visitChild(node.identifier);
+    visitChild(node.type);
+}
+
+void ASTVisitor::visit(AssignmentAST &node)
+{
+    visitChild(node.identifier);
+    visitSlot(node.expression);
+}
+
+void ASTVisitor::visit(ArrayAssignmentAST &node)
+{
+    visitChild(node.identifier);
+    visitSlots(node.indices);
+    visitSlot(node.expression);
+}
+
+void ASTVisitor::visit(ArrayAccessAST &node)
+{
+    visitChild(node.identifier);
+    visitSlots(node.indices);
+}
+
+void ASTVisitor::visit(OutputAST &node)
+{
+    visitSlots(node.expressions);
+    visitSlots(node.separators);
+}
+
+void ASTVisitor::visit(InputAST &node)
+{
+    visitSlot(node.target);
+}
+
+void ASTVisitor::visit(FileAST &node)
+{
+    visitSlot(node.file);
+    visitSlot(node.operand);
+}
+
+void ASTVisitor::visit(BinaryOpAST &node)
+{
+    visitSlot(node.expression1);
+    visitSlot(node.expression2);
+}
+
+void ASTVisitor::visit(UnaryOpAST &node)
+{
+    visitSlot(node.expression);
+}
+
+void ASTVisitor::visit(ComparisonAST &node)
+{
+    visitSlot(node.LHS);
+    visitSlot(node.RHS);
+}
+
+void ASTVisitor::visit(LogicalOpAST &node)
+{
+    visitSlot(node.LHS);
+    visitSlot(node.RHS);
+}
+
+void ASTVisitor::visit(StatementBlockAST &node)
+{
+    visitSlots(node.statements);
+}
+
+void ASTVisitor::visit(IfAST &node)
+{
+    visitChild(node.condition);
+    visitChild(node.thenBlock);
+    visitChild(node.elseBlock);
+}
+
+void ASTVisitor::visit(ForAST &node)
+{
+    visitChild(node.assignment);
+    visitChild(node.condition);
+    visitChild(node.step);
+    visitChild(node.forBlock);
+}
+
+void ASTVisitor::visit(WhileAST &node)
+{
+    visitChild(node.condition);
+    visitChild(node.body);
+}
+
+void ASTVisitor::visit(RepeatAST &node)
+{
+    visitChild(node.body);
+    visitChild(node.condition);
+}
+
+void ASTVisitor::visit(ParameterAST &node)
+{
+    visitChild(node.type);
+}
+
+void ASTVisitor::visit(ProcedureAST &node)
+{
+    visitChild(node.Identifier);
+    for (ParameterAST *param : node.parameters)
+        visitChild(param);
+    visitChild(node.statementsBlock);
+}
+
+void ASTVisitor::visit(FuncAST &node)
+{
+    visitChild(node.Identifier);
+    for (ParameterAST *param : node.parameters)
+        visitChild(param);
+    visitChild(node.returnType);
+    visitChild(node.statementsBlock);
+}
+
+void ASTVisitor::visit(ReturnAST &node)
+{
+    visitSlot(node.expression);
+}
+
+void ASTVisitor::visit(FuncCallAST &node)
+{
+    visitSlots(node.arguments);
+}
+
+// --- Pass manager ---
+
+ASTPassManager::Stopwatch::Stopwatch(Timing &timing)
+    : timing(timing), start(std::chrono::steady_clock::now()) {}
+
+ASTPassManager::Stopwatch::~Stopwatch()
+{
+    timing.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    timing.runs++;
+}
+
+ASTPassManager::Timing &ASTPassManager::timing(const std::string &name)
+{
+    for (auto &entry : timings)
+        if (entry.first == name)
+            return entry.second;
+    timings.emplace_back(name, Timing());
+    return timings.back().second;
+}
+
+void ASTPassManager::addPass(std::unique_ptr<ASTPass> pass)
+{
+    passes.push_back(std::move(pass));
+}
+
+void ASTPassManager::run(std::vector<ASTNode *> &program)
+{
+    for (auto &pass : passes)
+    {
+        bool changed;
+        {
+            Stopwatch stopwatch(timing(pass->getName()));
+            changed = pass->run(program, *this);
+        }
+        if (changed)
+            analyses.clear();
+    }
+    analyses.clear();
+}
+
+void ASTPassManager::printTimes() const
+{
+    double total = 0;
+    for (const auto &entry : timings)
+        total += entry.second.seconds;
+    fprintf(stderr, "AST pass timing (%.3f ms total):\n", total * 1000);
+    for (const auto &entry : timings)
+        fprintf(stderr, "  %-16s %10.3f ms %6.1f%%  %u runs\n", entry.first.c_str(), entry.second.seconds * 1000,
+                total > 0 ? entry.second.seconds * 100 / total : 0.0, entry.second.runs);
+}
+
+// --- Semantic checks ---
+
+bool SemaPass::run(std::vector<ASTNode *> &program, ASTPassManager &)
+{
+    for (ASTNode *node : program)
+    {
+        fprintf(stderr, "sematic check for node type: %s\n", typeid(*node).name());
+        node->semanticCheck();
+    }
+    return false;
+}
+
+// --- Constant folding ---
+
+namespace
+{
+    class FoldVisitor : public ASTVisitor
+    {
+    public:
+        bool changed = false;
+
+        void visitSlot(ASTNode *&slot) override
+        {
+            ASTVisitor::visitSlot(slot);
+            if (!slot)
+                return;
+            int line = slot->line;
+            if (ASTNode *folded = fold(slot))
+            {
+                folded->line = line;
+                slot = folded;
+                changed = true;
+            }
+        }
+
+    private:
+        // The folded literal, after freeing node and its operands; nullptr to keep node
+        static ASTNode *fold(ASTNode *node)
+        {
+            if (auto *unary = dynamic_cast<UnaryOpAST *>(node))
+                return foldNegate(unary);
+            auto *binary = dynamic_cast<BinaryOpAST *>(node);
+            if (!binary || !binary->expression2)
+                return nullptr;
+            ASTNode *folded = nullptr;
+            auto *intL = dynamic_cast<IntegerLiteralAST *>(binary->expression1);
+            auto *intR = dynamic_cast<IntegerLiteralAST *>(binary->expression2);
+            auto *realL = dynamic_cast<RealLiteralAST *>(binary->expression1);
+            auto *realR = dynamic_cast<RealLiteralAST *>(binary->expression2);
+            if (intL && intR)
+                folded = foldInteger(binary->op, intL->value, intR->value);
+            else if (realL && realR)
+                folded = foldReal(binary->op, realL->value, realR->value);
+            if (folded)
+            {
+                delete binary->expression1;
+                delete binary->expression2;
+                delete binary;
+            }
+            return folded;
+        }
+
+        // Wraps like the i32 instructions performBinaryOperation emits
+        static ASTNode *foldInteger(BinaryOp op, int lhs, int rhs)
+        {
+            uint32_t a = static_cast<uint32_t>(lhs), b = static_cast<uint32_t>(rhs);
+            switch (op)
+            {
+            case BinaryOp::Add:
+                return new IntegerLiteralAST(static_cast<int>(a + b));
+            case BinaryOp::Subtract:
+                return new IntegerLiteralAST(static_cast<int>(a - b));
+            case BinaryOp::Multiply:
+                return new IntegerLiteralAST(static_cast<int>(a * b));
+            case BinaryOp::Divide:
+                // Division by zero and INT_MIN / -1 are left to run time
+                if (rhs == 0 || (lhs == INT_MIN && rhs == -1))
+                    return nullptr;
+                return new IntegerLiteralAST(lhs / rhs);
+            default:
+                return nullptr;
+            }
+        }
+
+        static ASTNode *foldReal(BinaryOp op, double lhs, double rhs)
+        {
+            switch (op)
+            {
+            case BinaryOp::Add:
+                return new RealLiteralAST(lhs + rhs);
+            case BinaryOp::Subtract:
+                return new RealLiteralAST(lhs - rhs);
+            case BinaryOp::Multiply:
+                return new RealLiteralAST(lhs * rhs);
+            case BinaryOp::Divide:
+                return new RealLiteralAST(lhs / rhs);
+            default:
+                return nullptr;
+            }
+        }
+
+        static ASTNode *foldNegate(UnaryOpAST *unary)
+        {
+            ASTNode *folded = nullptr;
+            if (auto *intLit = dynamic_cast<IntegerLiteralAST *>(unary->expression))
+                folded = new IntegerLiteralAST(static_cast<int>(0u - static_cast<uint32_t>(intLit->value)));
+            else if (auto *realLit = dynamic_cast<RealLiteralAST *>(unary->expression))
+                folded = new RealLiteralAST(-realLit->value);
+            if (folded)
+            {
+                delete unary->expression;
+                delete unary;
+            }
+            return folded;
+        }
+    };
+}
+
+bool ConstantFoldPass::run(std::vector<ASTNode *> &program, ASTPassManager &)
+{
+    FoldVisitor visitor;
+    for (ASTNode *&node : program)
+        visitor.visitSlot(node);
+    return visitor.changed;
+}
+
+// --- Loops ---
+
+namespace
+{
+    class LoopVisitor : public ASTVisitor
+    {
+    public:
+        explicit LoopVisitor(std::map<const ASTNode *, LoopAnalysis::Loop> &loops) : loops(loops) {}
+
+        void visit(ForAST &node) override { visitLoop(node); }
+        void visit(WhileAST &node) override { visitLoop(node); }
+        void visit(RepeatAST &node) override { visitLoop(node); }
+        void visit(FuncCallAST &node) override
+        {
+            // Every loop around the call contains it
+            for (const ASTNode *loop : open)
+                loops[loop].containsCall = true;
+            ASTVisitor::visit(node);
+        }
+
+    private:
+        template <class Node>
+        void visitLoop(Node &node)
+        {
+            LoopAnalysis::Loop &loop = loops[&node];
+            loop.depth = open.size() + 1;
+            open.push_back(&node);
+            ASTVisitor::visit(node);
+            open.pop_back();
+        }
+
+        std::map<const ASTNode *, LoopAnalysis::Loop> &loops;
+        std::vector<const ASTNode *> open;
+    };
+}
+
+void LoopAnalysis::compute(std::vector<ASTNode *> &program)
+{
+    LoopVisitor visitor(loops);
+    for (ASTNode *node : program)
+        node->accept(visitor);
+}
+
+const LoopAnalysis::Loop *LoopAnalysis::lookup(const ASTNode *node) const
+{
+    auto it = loops.find(node);
+    return it == loops.end() ? nullptr : &it->second;
+}
+
+size_t LoopAnalysis::countWithCalls() const
+{
+    size_t count = 0;
+    for (const auto &entry : loops)
+        if (entry.second.containsCall)
+            count++;
+    return count;
+}
+
+unsigned LoopAnalysis::maxDepth() const
+{
+    unsigned depth = 0;
+    for (const auto &entry : loops)
+        depth = std::max(depth, entry.second.depth);
+    return depth;
+}
+
+bool LoopReportPass::run(std::vector<ASTNode *> &program, ASTPassManager &manager)
+{
+    LoopAnalysis &analysis = manager.getAnalysis<LoopAnalysis>(program);
+    if (analysis.size() == 0)
+        return false;
+    fprintf(stderr, "Loops: %zu, deepest nesting %u, %zu calling a routine\n", analysis.size(), analysis.maxDepth(),
+            analysis.countWithCalls());
+    return false;
+}
@@ -0,0 +1,205 @@
+#ifndef PASSES_H
+#define PASSES_H
+
+#include "AST.h"
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <typeindex>
+
+// Passes over the AST.
+//
+// An ASTVisitor has one visit() per node class. The defaults walk the
+// children, so a pass only overrides the nodes it is interested in.
+// Children held as plain ASTNode * are visited through visitSlot(), which
+// a rewriting pass overrides to replace the node in its parent.
+//
+// The ASTPassManager runs its passes in the order they were added over the
+// top-level statements, times each one for --time-passes, and keeps the
+// analyses passes ask for until a pass reports that it changed the AST.
+
+class ASTVisitor
+{
+public:
+    virtual ~ASTVisitor() = default;
+
+    // Visits the node held in slot; may replace it
+    virtual void visitSlot(ASTNode *&slot);
+
+    virtual void visit(TypeAST &node) {}
+    virtual void visit(CharLiteralAST &node) {}
+    virtual void visit(StringLiteralAST &node) {}
+    virtual void visit(IntegerLiteralAST &node) {}
+    virtual void visit(RealLiteralAST &node) {}
+    virtual void visit(DateLiteralAST &node) {}
+    virtual void visit(BooleanLiteralAST &node) {}
+    virtual void visit(IdentifierAST &node) {}
+    virtual void visit(DeclarationAST &node);
+    virtual void visit(ArrayAST &node);
+    virtual void visit(ListAST &node);
+    virtual void visit(AssignmentAST &node);
+    virtual void visit(ArrayAssignmentAST &node);
+    virtual void visit(ArrayAccessAST &node);
+    virtual void visit(OutputAST &node);
+    virtual void visit(InputAST &node);
+    virtual void visit(FileAST &node);
+    virtual void visit(BinaryOpAST &node);
+    virtual void visit(UnaryOpAST &node);
+    virtual void visit(ComparisonAST &node);
+    virtual void visit(LogicalOpAST &node);
+    virtual void visit(StatementBlockAST &node);
+    virtual void visit(IfAST &node);
+    virtual void visit(ForAST &node);
+    virtual void visit(WhileAST &node);
+    virtual void visit(RepeatAST &node);
+    virtual void visit(ParameterAST &node);
+    virtual void visit(ProcedureAST &node);
+    virtual void visit(FuncAST &node);
+    virtual void visit(ReturnAST &node);
+    virtual void visit(FuncCallAST &node);
+    virtual void visit(ImportAST &node) {}
+
+protected:
+    // Children with a more specific type than ASTNode * cannot be replaced
+    template <class Node>
+    void visitChild(Node *node)
+    {
+        if (node)
+            node->accept(*this);
+    }
+    void visitSlots(std::vector<ASTNode *> &slots);
+};
+
+// Results computed from the AST and shared between passes
+class ASTAnalysis
+{
+public:
+    virtual ~ASTAnalysis() = default;
+    virtual void compute(std::vector<ASTNode *> &program) = 0;
+};
+
+class ASTPassManager;
+
+class ASTPass
+{
+public:
+    explicit ASTPass(const std::string &name) : name(name) {}
+    virtual ~ASTPass() = default;
+    const std::string &getName() const { return name; }
+    // Returns true when the AST changed, which drops the cached analyses
+    virtual bool run(std::vector<ASTNode *> &program, ASTPassManager &manager) = 0;
+
+private:
+    std::string name;
+};
+
+// A pass made from a function, for steps that live with their callers
+class CallbackPass : public ASTPass
+{
+public:
+    using Callback = std::function<bool(std::vector<ASTNode *> &)>;
+    CallbackPass(const std::string &name, Callback callback) : ASTPass(name), callback(std::move(callback)) {}
+    bool run(std::vector<ASTNode *> &program, ASTPassManager &) override { return callback(program); }
+
+private:
+    Callback callback;
+};
+
+class ASTPassManager
+{
+public:
+    void addPass(std::unique_ptr<ASTPass> pass);
+
+    // Runs every pass in order; the analyses are dropped afterwards because
+    // the last passes may free the AST
+    void run(std::vector<ASTNode *> &program);
+
+    // The analysis for the program being run, computed on first use
+    template <class Analysis>
+    Analysis &getAnalysis(std::vector<ASTNode *> &program)
+    {
+        std::unique_ptr<ASTAnalysis> &slot = analyses[std::type_index(typeid(Analysis))];
+        if (!slot)
+        {
+            slot.reset(new Analysis());
+            Stopwatch stopwatch(timing(Analysis::name));
+            slot->compute(program);
+        }
+        return static_cast<Analysis &>(*slot);
+    }
+
+    // Prints the time spent in each pass and analysis to stderr
+    void printTimes() const;
+
+private:
+    struct Timing
+    {
+        double seconds = 0;
+        unsigned runs = 0;
+    };
+    struct Stopwatch
+    {
+        explicit Stopwatch(Timing &timing);
+        ~Stopwatch();
+        Timing &timing;
+        std::chrono::steady_clock::time_point start;
+    };
+    Timing &timing(const std::string &name);
+
+    std::vector<std::unique_ptr<ASTPass>> passes;
+    std::map<std::type_index, std::unique_ptr<ASTAnalysis>> analyses;
+    // In the order the passes and analyses first ran
+    std::vector<std::pair<std::string, Timing>> timings;
+};
+
+// --- Passes ---
+
+// semanticCheck() of every top-level statement
+class SemaPass : public ASTPass
+{
+public:
+    SemaPass() : ASTPass("sema") {}
+    bool run(std::vector<ASTNode *> &program, ASTPassManager &manager) override;
+};
+
+// Replaces arithmetic on INTEGER or REAL literals with its result
+class ConstantFoldPass : public ASTPass
+{
+public:
+    ConstantFoldPass() : ASTPass("fold") {}
+    bool run(std::vector<ASTNode *> &program, ASTPassManager &manager) override;
+};
+
+// FOR, WHILE and REPEAT loops with their nesting depth and whether their
+// body calls a routine
+class LoopAnalysis : public ASTAnalysis
+{
+public:
+    static constexpr const char *name = "loop analysis";
+    struct Loop
+    {
+        unsigned depth = 1; // 1 for a loop that is not inside another loop
+        bool containsCall = false;
+    };
+
+    void compute(std::vector<ASTNode *> &program) override;
+    // nullptr when node is not a loop of the program
+    const Loop *lookup(const ASTNode *node) const;
+    size_t size() const { return loops.size(); }
+    unsigned maxDepth() const;
+    size_t countWithCalls() const;
+
+private:
+    std::map<const ASTNode *, Loop> loops;
+};
+
+// Reports the loops of the program from LoopAnalysis
+class LoopReportPass : public ASTPass
+{
+public:
+    LoopReportPass() : ASTPass("loops") {}
+    bool run(std::vector<ASTNode *> &program, ASTPassManager &manager) override;
+};
+
+#endif // PASSES_H
@@ -0,0 +1,313 @@
+#include "Profile.h"
+#include "Incremental.h"
+#include "Options.h"
+#include "Runtime.h"
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/ProfileData/InstrProf.h>
+#include <llvm/ProfileData/ProfileCommon.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
+// Counter arrays are named CounterPrefix + routine and carry the routine
+// name and checksum as !ssc.profile metadata, so they can be found again
+// after incremental units have been linked back in
+static const char *const CounterPrefix = "__ssc_prof.";
+static const char *const ProfileMetadata = "ssc.profile";
+
+struct ProfileRecord
+{
+    uint64_t checksum = 0;
+    std::vector<uint64_t> counts;
+};
+
+// Routine currently being generated or annotated
+struct FunctionProfile
+{
+    std::string name;
+    uint64_t checksum = 0;
+    unsigned counters = 1; // slot 0 is the entry count
+    GlobalVariable *placeholder = nullptr;
+    const ProfileRecord *record = nullptr;
+};
+
+static std::map<std::string, ProfileRecord> loadedProfiles;
+static std::string loadedDigest;
+static std::map<Function *, FunctionProfile> activeFunctions;
+static std::vector<std::vector<uint64_t>> usedRecords;
+
+static bool generating()
+{
+    return !compilerOptions.profileGenerate.empty();
+}
+
+static bool annotating()
+{
+    return !compilerOptions.profileUse.empty();
+}
+
+// ───────────────────────────────────────────
+// Reading profiles
+
+// One record per line: NAME CHECKSUM COUNT C0 C1 ... ; '#' starts a comment
+static bool parseProfile(StringRef path, StringRef text)
+{
+    SmallVector<StringRef, 0> lines;
+    text.split(lines, '\n', -1, false);
+    for (StringRef line : lines)
+    {
+        line = line.trim();
+        if (line.empty() || line.startswith("#"))
+            continue;
+
+        SmallVector<StringRef, 16> fields;
+        line.split(fields, ' ', -1, false);
+        ProfileRecord record;
+        unsigned count = 0;
+        if (fields.size() < 3 || fields[1].getAsInteger(16, record.checksum) || fields[2].getAsInteger(10, count) ||
+            fields.size() != 3 + count)
+        {
+            errs() << "Profile: malformed record in " << path << ": " << line << "\n";
+            return false;
+        }
+        for (unsigned i = 0; i < count; ++i)
+        {
+            uint64_t value = 0;
+            if (fields[3 + i].getAsInteger(10, value))
+            {
+                errs() << "Profile: bad counter in " << path << ": " << line << "\n";
+                return false;
+            }
+            record.counts.push_back(value);
+        }
+
+        // Records of the same routine from several runs or files are summed
+        auto it = loadedProfiles.find(fields[0].str());
+        if (it == loadedProfiles.end())
+            loadedProfiles.emplace(fields[0].str(), std::move(record));
+        else if (it->second.checksum != record.checksum || it->second.counts.size() != record.counts.size())
+            errs() << "Profile: conflicting records for " << fields[0] << ", keeping the first\n";
+        else
+            for (size_t i = 0; i < record.counts.size(); ++i)
+                it->second.counts[i] += record.counts[i];
+    }
+    return true;
+}
+
+bool loadProfiles(const std::string &files)
+{
+    SmallVector<StringRef, 4> paths;
+    StringRef(files).split(paths, ',', -1, false);
+    MD5 hasher;
+    for (StringRef path : paths)
+    {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(path);
+        if (!buffer)
+        {
+            errs() << "Profile: cannot read " << path << ": " << buffer.getError().message() << "\n";
+            return false;
+        }
+        if (!parseProfile(path, (*buffer)->getBuffer()))
+            return false;
+        hasher.update((*buffer)->getBuffer());
+    }
+    MD5::MD5Result result;
+    hasher.final(result);
+    loadedDigest = std::string(result.digest().str());
+    fprintf(stderr, "Profile: loaded %zu routine records\n", loadedProfiles.size());
+    return true;
+}
+
+std::string profileCodegenKey()
+{
+    if (generating())
+        return "profile-generate";
+    if (annotating())
+        return "profile-use:" + loadedDigest;
+    return "";
+}
+
+// ───────────────────────────────────────────
+// Sites
+
+static uint64_t checksumOf(Fingerprint &fp)
+{
+    uint64_t checksum = 0;
+    StringRef(fp.digest()).substr(0, 16).getAsInteger(16, checksum);
+    return checksum;
+}
+
+// Emits counters[slot] += 1 at the builder's insertion point
+static void emitIncrement(IRBuilder<> &b, GlobalVariable *counters, unsigned slot)
+{
+    Type *i64 = b.getInt64Ty();
+    Value *address = b.CreateConstGEP1_64(i64, counters, slot, "prof.addr");
+    Value *count = b.CreateLoad(i64, address, "prof.count");
+    b.CreateStore(b.CreateAdd(count, b.getInt64(1), "prof.inc"), address);
+}
+
+void profileBeginFunction(Function *F, Fingerprint &fp)
+{
+    if (!generating() && !annotating())
+        return;
+
+    FunctionProfile &profile = activeFunctions[F];
+    profile.name = F->getName().str();
+    profile.checksum = checksumOf(fp);
+
+    if (generating())
+    {
+        // Stands in for the counter array until the number of sites is known
+        profile.placeholder = new GlobalVariable(*module, builder.getInt64Ty(), false, GlobalValue::InternalLinkage,
+                                                 builder.getInt64(0), "prof.placeholder");
+        emitIncrement(builder, profile.placeholder, 0);
+        return;
+    }
+
+    auto it = loadedProfiles.find(profile.name);
+    if (it == loadedProfiles.end())
+        return;
+    if (it->second.checksum != profile.checksum)
+        errs() << "Profile: " << profile.name << " changed since it was profiled, ignoring its counts\n";
+    else
+        profile.record = &it->second;
+}
+
+// Scales a pair of counts into the 32-bit range of branch weights
+static MDNode *branchWeights(uint64_t taken, uint64_t notTaken)
+{
+    uint64_t larger = std::max(taken, notTaken);
+    uint64_t scale = larger > UINT32_MAX ? larger / UINT32_MAX + 1 : 1;
+    return MDBuilder(context).createBranchWeights(static_cast<uint32_t>(taken / scale),
+                                                  static_cast<uint32_t>(notTaken / scale));
+}
+
+void profileBranch(BranchInst *branch)
+{
+    auto it = activeFunctions.find(branch->getFunction());
+    if (it == activeFunctions.end() || !branch->isConditional())
+        return;
+    FunctionProfile &profile = it->second;
+    unsigned executed = profile.counters++;
+    unsigned taken = profile.counters++;
+
+    if (profile.placeholder)
+    {
+        // The first successor is a fresh block whose only predecessor is this branch
+        IRBuilder<> before(branch);
+        emitIncrement(before, profile.placeholder, executed);
+        BasicBlock *successor = branch->getSuccessor(0);
+        IRBuilder<> atSuccessor(successor, successor->getFirstInsertionPt());
+        emitIncrement(atSuccessor, profile.placeholder, taken);
+        return;
+    }
+
+    if (!profile.record || taken >= profile.record->counts.size())
+        return;
+    uint64_t total = profile.record->counts[executed];
+    uint64_t first = std::min(profile.record->counts[taken], total);
+    if (total > 0)
+        branch->setMetadata(LLVMContext::MD_prof, branchWeights(first, total - first));
+}
+
+void profileEndFunction(Function *F)
+{
+    auto it = activeFunctions.find(F);
+    if (it == activeFunctions.end())
+        return;
+    FunctionProfile &profile = it->second;
+
+    if (profile.placeholder)
+    {
+        ArrayType *arrayType = ArrayType::get(builder.getInt64Ty(), profile.counters);
+        auto *counters = new GlobalVariable(*module, arrayType, false, GlobalValue::InternalLinkage,
+                                            ConstantAggregateZero::get(arrayType), CounterPrefix + profile.name);
+        MDBuilder md(context);
+        counters->setMetadata(ProfileMetadata,
+                              MDNode::get(context, {md.createString(profile.name),
+                                                    md.createConstant(builder.getInt64(profile.checksum))}));
+        profile.placeholder->replaceAllUsesWith(ConstantExpr::getBitCast(counters, profile.placeholder->getType()));
+        profile.placeholder->eraseFromParent();
+    }
+    else if (profile.record)
+    {
+        if (profile.record->counts.size() != profile.counters)
+            errs() << "Profile: " << profile.name << " has " << profile.record->counts.size()
+                   << " counters, expected " << profile.counters << "\n";
+        else
+        {
+            F->setEntryCount(profile.record->counts[0]);
+            usedRecords.push_back(profile.record->counts);
+        }
+    }
+    activeFunctions.erase(it);
+}
+
+// ───────────────────────────────────────────
+// Module
+
+// Builds { name, checksum, counters, count } for every counter array still in
+// use and calls ssc_profile_register from a global constructor
+static void registerCounters(Module &M)
+{
+    Type *i8Ptr = Type::getInt8PtrTy(context);
+    Type *i64 = Type::getInt64Ty(context);
+    Type *i32 = Type::getInt32Ty(context);
+    StructType *entryType = StructType::get(context, {i8Ptr, i64, PointerType::getUnqual(i64), i32});
+
+    std::vector<Constant *> entries;
+    std::vector<GlobalVariable *> unused;
+    for (GlobalVariable &gv : M.globals())
+    {
+        MDNode *info = gv.getMetadata(ProfileMetadata);
+        if (!info)
+            continue;
+        // e.g. main's counters in a module, once main has been removed
+        if (gv.use_empty())
+        {
+            unused.push_back(&gv);
+            continue;
+        }
+        StringRef name = cast<MDString>(info->getOperand(0))->getString();
+        Constant *checksum = cast<ConstantAsMetadata>(info->getOperand(1))->getValue();
+        Constant *nameString = ConstantExpr::getBitCast(
+            IRBuilder<>(context).CreateGlobalString(name, "prof.name", 0, &M), i8Ptr);
+        unsigned count = cast<ArrayType>(gv.getValueType())->getNumElements();
+        entries.push_back(ConstantStruct::get(entryType, {nameString, checksum,
+                                                          ConstantExpr::getBitCast(&gv, PointerType::getUnqual(i64)),
+                                                          ConstantInt::get(i32, count)}));
+    }
+    for (GlobalVariable *gv : unused)
+        gv->eraseFromParent();
+    if (entries.empty())
+        return;
+
+    ArrayType *tableType = ArrayType::get(entryType, entries.size());
+    auto *table = new GlobalVariable(M, tableType, true, GlobalValue::InternalLinkage,
+                                     ConstantArray::get(tableType, entries), "__ssc_prof.table");
+
+    Function *ctor = Function::Create(FunctionType::get(Type::getVoidTy(context), false), GlobalValue::InternalLinkage,
+                                      "__ssc_prof.register", M);
+    IRBuilder<> b(BasicBlock::Create(context, "entry", ctor));
+    Value *path = b.CreateGlobalStringPtr(compilerOptions.profileGenerate, "prof.path", 0, &M);
+    b.CreateCall(getRuntimeFunction("ssc_profile_register"),
+                 {b.CreateBitCast(table, i8Ptr), b.getInt32(entries.size()), path});
+    b.CreateRetVoid();
+    appendToGlobalCtors(M, ctor, 0);
+}
+
+void finishProfile(Module &M)
+{
+    if (generating())
+    {
+        registerCounters(M);
+        return;
+    }
+    if (!annotating() || usedRecords.empty())
+        return;
+
+    // Lets the inliner and block placement tell hot code from cold
+    InstrProfSummaryBuilder summaryBuilder(ProfileSummaryBuilder::DefaultCutoffs);
+    for (std::vector<uint64_t> &counts : usedRecords)
+        summaryBuilder.addRecord(InstrProfRecord(counts));
+    M.setProfileSummary(summaryBuilder.getSummary()->getMD(context), ProfileSummary::PSK_Instr);
+}
@@ -0,0 +1,37 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "common_includes.h"
+
+class Fingerprint;
+
+// Profile-guided optimization.
+//
+// With --profile-generate every routine (and main) gets an array of i64
+// counters: slot 0 counts entries, and each conditional branch of an IF,
+// FOR, WHILE or REPEAT gets two slots, one for how often the branch ran and
+// one for how often its first successor was taken. The runtime adds the
+// counters into the profile file at exit (ssc_profile_register in
+// ssc_runtime.c).
+//
+// With --profile-use the same sites are numbered the same way during
+// codegen, and the recorded counts become branch weights, function entry
+// counts and a module profile summary for the optimizer. A routine whose
+// AST checksum differs from the one in the profile is left unannotated.
+
+// Reads and merges the comma-separated profile files of --profile-use
+bool loadProfiles(const std::string &files);
+
+// Called with the builder at the start of F's entry block; fp holds the routine's AST
+void profileBeginFunction(Function *F, Fingerprint &fp);
+// Called right after a conditional branch is created
+void profileBranch(BranchInst *branch);
+// Called once all of F has been generated
+void profileEndFunction(Function *F);
+// Registers the module's counters with the runtime, or attaches the profile summary
+void finishProfile(Module &M);
+
+// Part of the incremental cache key: instrumentation and profile data change the IR
+std::string profileCodegenKey();
+
+#endif // PROFILE_H
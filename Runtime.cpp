@@ -0,0 +1,351 @@
+#include "Runtime.h"
+#include "Options.h"
+#include "Strings.h"
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <functional>
+#include <unordered_map>
+
+// Bitcode of ssc_runtime.c, placed in the binary by RuntimeEmbed.S
+extern "C" const char ssc_runtime_bc[];
+extern "C" const char ssc_runtime_bc_end[];
+
+using RuntimeTypeGenerator = std::function<FunctionType *(LLVMContext &)>;
+
+// Signatures of the runtime entry points used by generated code
+static const std::unordered_map<std::string, RuntimeTypeGenerator> runtimeFunctions = {
+    {"ssc_output_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_output_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getDoubleTy(ctx)}, false); }},
+    {"ssc_output_char", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_output_bool", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_output_str", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_input_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt32PtrTy(ctx)}, false); }},
+    {"ssc_input_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getDoublePtrTy(ctx)}, false); }},
+    {"ssc_input_char", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_input_str", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {PointerType::getUnqual(Type::getInt8PtrTy(ctx))}, false); }},
+    {"ssc_output_array_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt32PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_output_array_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getDoublePtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_output_array_char", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_output_array_bool", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt1PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_output_array_str", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {PointerType::getUnqual(Type::getInt8PtrTy(ctx)), Type::getInt32Ty(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_input_array_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt32PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_input_array_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getDoublePtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_input_array_char", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_input_array_str", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {PointerType::getUnqual(Type::getInt8PtrTy(ctx)), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_file_open", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_file_read", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), PointerType::getUnqual(Type::getInt8PtrTy(ctx))}, false); }},
+    {"ssc_file_write_str", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_file_write_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_file_write_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getDoubleTy(ctx)}, false); }},
+    {"ssc_file_close", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_file_eof", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getDoubleTy(ctx)}, false); }},
+    {"ssc_mod", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt32Ty(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_div", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt32Ty(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_rand", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getDoubleTy(ctx), {Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_sqrt", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getDoubleTy(ctx), {Type::getDoubleTy(ctx)}, false); }},
+    {"ssc_array_sum_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt32PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_sum_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getDoubleTy(ctx), {Type::getDoublePtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_min_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt32PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_min_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getDoubleTy(ctx), {Type::getDoublePtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_max_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt32PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_max_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getDoubleTy(ctx), {Type::getDoublePtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_cpu_level", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {}, false); }},
+    {"ssc_array_fill_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt32PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_fill_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getDoublePtrTy(ctx), Type::getInt32Ty(ctx), Type::getDoubleTy(ctx)}, false); }},
+    {"ssc_array_sort_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt32PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_sort_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getDoublePtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_find_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt32PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_find_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getDoublePtrTy(ctx), Type::getInt32Ty(ctx), Type::getDoubleTy(ctx)}, false); }},
+    {"ssc_array_bsearch_int", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt32PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_array_bsearch_real", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getDoublePtrTy(ctx), Type::getInt32Ty(ctx), Type::getDoubleTy(ctx)}, false); }},
+    {"ssc_str_length", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_str_mid", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt8PtrTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_str_left", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt8PtrTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_str_right", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt8PtrTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_str_upper", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt8PtrTy(ctx), {Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_str_lower", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt8PtrTy(ctx), {Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_str_concat", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt8PtrTy(ctx), {PointerType::getUnqual(Type::getInt8PtrTy(ctx)), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_str_append", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {PointerType::getUnqual(Type::getInt8PtrTy(ctx)), PointerType::getUnqual(Type::getInt8PtrTy(ctx)), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_str_store", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {PointerType::getUnqual(Type::getInt8PtrTy(ctx)), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_str_init", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {PointerType::getUnqual(Type::getInt8PtrTy(ctx)), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_str_share", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {PointerType::getUnqual(Type::getInt8PtrTy(ctx)), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_str_compare", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt8PtrTy(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_str_equal", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt32Ty(ctx), {Type::getInt8PtrTy(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_vec_init", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt32Ty(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_vec_init_dims", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt32Ty(ctx), Type::getInt32PtrTy(ctx), Type::getInt32PtrTy(ctx)}, false); }},
+    {"ssc_vec_push", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getInt8PtrTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_vec_assign", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx)}, false); }},
+    {"ssc_profile_register", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt8PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+    {"ssc_lines_register", [](LLVMContext &ctx)
+     { return FunctionType::get(Type::getVoidTy(ctx), {Type::getInt64PtrTy(ctx), Type::getInt64PtrTy(ctx), Type::getInt32Ty(ctx), Type::getInt8PtrTy(ctx), Type::getInt8PtrTy(ctx)}, false); }},
+};
+
+// Pseudocode built-in name -> runtime function
+static const std::unordered_map<std::string, std::string> builtinRoutines = {
+    {"INT", "ssc_int"},
+    {"MOD", "ssc_mod"},
+    {"DIV", "ssc_div"},
+    {"RAND", "ssc_rand"},
+    {"SQRT", "ssc_sqrt"},
+    {"LENGTH", "ssc_str_length"},
+    {"MID", "ssc_str_mid"},
+    {"LEFT", "ssc_str_left"},
+    {"RIGHT", "ssc_str_right"},
+    {"UCASE", "ssc_str_upper"},
+    {"LCASE", "ssc_str_lower"},
+    {"EOF", "ssc_file_eof"},
+};
+
+// Whole-array built-in -> runtime kernel, completed with _int or _real by element type
+static const std::unordered_map<std::string, std::string> arrayBuiltins = {
+    {"SUM", "ssc_array_sum"},
+    {"MINIMUM", "ssc_array_min"},
+    {"MAXIMUM", "ssc_array_max"},
+    {"FILL", "ssc_array_fill"},
+    {"SORT", "ssc_array_sort"},
+    {"LINEARSEARCH", "ssc_array_find"},
+    {"BINARYSEARCH", "ssc_array_bsearch"},
+};
+
+FunctionCallee getRuntimeFunction(const std::string &name)
+{
+    return module->getOrInsertFunction(name, runtimeFunctions.at(name)(context));
+}
+
+bool isBuiltinRoutine(const std::string &name)
+{
+    return builtinRoutines.count(name) != 0;
+}
+
+Value *emitBuiltinCall(const std::string &name, const std::vector<Value *> &args)
+{
+    // UCASE and LCASE of a CHAR give a CHAR
+    if ((name == "UCASE" || name == "LCASE") && args.size() == 1 && args[0]->getType()->isIntegerTy(8))
+        return emitCharCase(args[0], name == "UCASE");
+
+    FunctionCallee callee = getRuntimeFunction(builtinRoutines.at(name));
+    FunctionType *funcType = callee.getFunctionType();
+    if (funcType->getNumParams() != args.size())
+    {
+        errs() << "Built-in " << name << " expects " << funcType->getNumParams() << " arguments\n";
+        return nullptr;
+    }
+
+    std::vector<Value *> callArgs;
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        Value *arg = args[i];
+        Type *paramType = funcType->getParamType(i);
+        // INTEGER arguments are accepted where a REAL is expected
+        if (arg->getType()->isIntegerTy(32) && paramType->isDoubleTy())
+            arg = builder.CreateSIToFP(arg, paramType, "toreal");
+        // and a CHAR where a STRING is expected
+        if (arg->getType()->isIntegerTy(8) && isStringType(paramType))
+            arg = emitStringOperand(arg);
+        if (arg->getType() != paramType)
+        {
+            errs() << "Type mismatch in argument " << i << " of built-in " << name << "\n";
+            return nullptr;
+        }
+        callArgs.push_back(arg);
+    }
+    Value *result = builder.CreateCall(callee, callArgs);
+    // EOF(f) is a BOOLEAN
+    if (name == "EOF")
+        return builder.CreateICmpNE(result, builder.getInt32(0), "eof");
+    return result;
+}
+
+bool isArrayBuiltin(const std::string &name)
+{
+    return arrayBuiltins.count(name) != 0 || name == "LENGTH" || name == "APPEND";
+}
+
+Value *emitArrayBuiltin(const std::string &name, Value *data, Type *element, Value *length, Value *firstIndex,
+                        const std::vector<Value *> &args)
+{
+    bool takesValue = name == "FILL" || name == "LINEARSEARCH" || name == "BINARYSEARCH";
+    if (args.size() != (takesValue ? 1u : 0u))
+    {
+        errs() << "Built-in " << name << " expects " << (takesValue ? "an array and a value" : "one array") << "\n";
+        return nullptr;
+    }
+
+    Value *value = nullptr;
+    if (takesValue)
+    {
+        value = args[0];
+        if (value->getType()->isIntegerTy(32) && element->isDoubleTy())
+            value = builder.CreateSIToFP(value, element, "toreal");
+        if (value->getType() != element)
+        {
+            errs() << "Type mismatch: " << name << " value does not match the array's element type\n";
+            return nullptr;
+        }
+    }
+
+    // CHAR and BOOLEAN elements take one byte each, so FILL is a memset
+    if (name == "FILL" && (element->isIntegerTy(8) || element->isIntegerTy(1)))
+        return builder.CreateMemSet(data, builder.CreateZExt(value, builder.getInt8Ty()), length, MaybeAlign());
+
+    const char *suffix = element->isIntegerTy(32) ? "_int" : element->isDoubleTy() ? "_real" : nullptr;
+    if (!suffix)
+    {
+        errs() << "Built-in " << name << " needs an INTEGER or REAL array\n";
+        return nullptr;
+    }
+
+    std::vector<Value *> callArgs = {data, length};
+    if (value)
+        callArgs.push_back(value);
+    Value *result = builder.CreateCall(getRuntimeFunction(arrayBuiltins.at(name) + suffix), callArgs);
+
+    // Searches return a 0-based position or -1; give the position in the array's own index range
+    auto *constantFirst = dyn_cast<ConstantInt>(firstIndex);
+    if (takesValue && name != "FILL" && !(constantFirst && constantFirst->isZero()))
+    {
+        Value *found = builder.CreateICmpSGE(result, builder.getInt32(0), "found");
+        result = builder.CreateSelect(found, builder.CreateAdd(result, firstIndex), builder.getInt32(-1), "position");
+    }
+    return result;
+}
+
+// Size of one element as the i32 the ssc_vec_ functions take
+static Value *elementSize(Type *element)
+{
+    return builder.CreateTrunc(ConstantExpr::getSizeOf(element), builder.getInt32Ty(), "elem.size");
+}
+
+void emitArrayInit(Value *descriptor, Type *element, Value *first, Value *last)
+{
+    builder.CreateCall(getRuntimeFunction("ssc_vec_init"),
+                       {builder.CreatePointerCast(descriptor, builder.getInt8PtrTy()), elementSize(element), first, last});
+}
+
+void emitArrayInitDims(Value *descriptor, Type *element, const std::vector<Value *> &bounds, Value *dimensions)
+{
+    // The bounds go in an array in the entry block, so a declaration in a loop does not grow the stack
+    Function *function = builder.GetInsertBlock()->getParent();
+    IRBuilder<> entry(&function->getEntryBlock(), function->getEntryBlock().begin());
+    ArrayType *boundsType = ArrayType::get(builder.getInt32Ty(), bounds.size());
+    AllocaInst *boundsArray = entry.CreateAlloca(boundsType, nullptr, "array.bounds");
+    for (size_t i = 0; i < bounds.size(); ++i)
+        builder.CreateStore(bounds[i], builder.CreateConstInBoundsGEP2_32(boundsType, boundsArray, 0, i));
+    builder.CreateCall(getRuntimeFunction("ssc_vec_init_dims"),
+                       {builder.CreatePointerCast(descriptor, builder.getInt8PtrTy()), elementSize(element),
+                        builder.getInt32(bounds.size() / 2),
+                        builder.CreateConstInBoundsGEP2_32(boundsType, boundsArray, 0, 0),
+                        builder.CreatePointerCast(dimensions, Type::getInt32PtrTy(context))});
+}
+
+void emitArrayAssign(Value *descriptor, Value *source, Type *element)
+{
+    builder.CreateCall(getRuntimeFunction("ssc_vec_assign"),
+                       {builder.CreatePointerCast(descriptor, builder.getInt8PtrTy()),
+                        builder.CreatePointerCast(source, builder.getInt8PtrTy()), elementSize(element)});
+}
+
+Value *emitListPush(Value *descriptor, Type *element)
+{
+    Value *slot = builder.CreateCall(getRuntimeFunction("ssc_vec_push"),
+                                     {builder.CreatePointerCast(descriptor, builder.getInt8PtrTy()), elementSize(element)},
+                                     "list.slot");
+    return builder.CreatePointerCast(slot, element->getPointerTo(), "list.elem");
+}
+
+bool linkRuntime(Module &M)
+{
+    StringRef bitcode(ssc_runtime_bc, ssc_runtime_bc_end - ssc_runtime_bc);
+    Expected<std::unique_ptr<Module>> runtime = parseBitcodeFile(MemoryBufferRef(bitcode, "ssc_runtime.bc"), M.getContext());
+    if (!runtime)
+    {
+        errs() << "Runtime: cannot read embedded bitcode: " << toString(runtime.takeError()) << "\n";
+        return false;
+    }
+
+    // Generated modules carry no target information of their own; adopt the runtime's
+    if (M.getTargetTriple().empty())
+        M.setTargetTriple((*runtime)->getTargetTriple());
+    if (M.getDataLayoutStr().empty())
+        M.setDataLayout((*runtime)->getDataLayout());
+    // The dispatchers of --multiversion are added after linking and call ssc_cpu_level
+    if (compilerOptions.multiversion)
+        M.getOrInsertFunction("ssc_cpu_level", runtimeFunctions.at("ssc_cpu_level")(M.getContext()));
+
+    if (Linker::linkModules(M, std::move(*runtime), Linker::Flags::LinkOnlyNeeded))
+    {
+        errs() << "Runtime: failed to link runtime bitcode\n";
+        return false;
+    }
+
+    // User routines stay external for modules and incremental units; the weak
+    // runtime state stays shared between a program and the modules it imports
+    internalizeModule(M, [](const GlobalValue &gv)
+                      { return !gv.getName().startswith("ssc_") || gv.hasWeakLinkage(); });
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include "common_includes.h"
+
+// Declares (once) an ssc_ function of the SSC runtime (ssc_runtime.c) in the current module
+FunctionCallee getRuntimeFunction(const std::string &name);
+
+// Built-in routines such as INT, MOD, RAND, LENGTH and MID are lowered to runtime calls
+bool isBuiltinRoutine(const std::string &name);
+Value *emitBuiltinCall(const std::string &name, const std::vector<Value *> &args);
+
+// SUM, MINIMUM, MAXIMUM, FILL, SORT, LINEARSEARCH and BINARYSEARCH take a
+// whole array: data points to its first element and args are the remaining
+// arguments. The array's current length is passed to a runtime kernel.
+// LENGTH and APPEND on arrays and lists are generated by FuncCallAST.
+bool isArrayBuiltin(const std::string &name);
+Value *emitArrayBuiltin(const std::string &name, Value *data, Type *element, Value *length, Value *firstIndex,
+                        const std::vector<Value *> &args);
+
+// Dynamic arrays and LISTs (struct ssc_vec): sets up the descriptor of an
+// array with the given bounds, copies the elements of one into another, and
+// adds an element at the end of a list, returning the address of the new one
+void emitArrayInit(Value *descriptor, Type *element, Value *first, Value *last);
+// An array of several dimensions; bounds holds the first and last index of
+// each and dimensions points to the descriptor's inner dimension fields
+void emitArrayInitDims(Value *descriptor, Type *element, const std::vector<Value *> &bounds, Value *dimensions);
+void emitArrayAssign(Value *descriptor, Value *source, Type *element);
+Value *emitListPush(Value *descriptor, Type *element);
+
+// Links the runtime bitcode embedded in ssc_compiler into the module.
+// Only the runtime functions the program uses are pulled in, and they are
+// internalized so the optimizer can inline them and drop what it does not need.
+bool linkRuntime(Module &M);
+
+#endif // RUNTIME_H
@@ -0,0 +1,120 @@
+#include "SourceInput.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// flex needs two NUL bytes after the text of a buffer it scans in place
+static const size_t EndPadding = 2;
+
+static const char *sourceText = "";
+static size_t sourceSize = 0;
+
+// Reserves size + 2 zeroed bytes and maps the file over the start of them.
+// Bytes past the end of the file read as zero, so the padding is already in
+// place. The mapping is private and writable because flex NUL-terminates
+// yytext in the buffer while a token is current; the file is never written.
+static bool mapSource(int fd, size_t size)
+{
+    size_t total = size + EndPadding;
+    void *base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return false;
+    if (size > 0)
+    {
+        if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+        {
+            munmap(base, total);
+            return false;
+        }
+        madvise(base, size, MADV_SEQUENTIAL);
+    }
+    sourceText = static_cast<const char *>(base);
+    sourceSize = size;
+    scanSourceBuffer(static_cast<char *>(base), total);
+    return true;
+}
+
+// Pipes and terminals cannot be mapped; read them into one heap buffer instead
+static bool readSource(int fd)
+{
+    size_t capacity = 64 * 1024;
+    size_t length = 0;
+    char *buffer = static_cast<char *>(malloc(capacity));
+    if (!buffer)
+        return false;
+
+    for (;;)
+    {
+        if (capacity - length < EndPadding + 1)
+        {
+            capacity *= 2;
+            char *grown = static_cast<char *>(realloc(buffer, capacity));
+            if (!grown)
+            {
+                free(buffer);
+                return false;
+            }
+            buffer = grown;
+        }
+        ssize_t n = read(fd, buffer + length, capacity - length - EndPadding);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            free(buffer);
+            return false;
+        }
+        if (n == 0)
+            break;
+        length += static_cast<size_t>(n);
+    }
+
+    buffer[length] = '\0';
+    buffer[length + 1] = '\0';
+    sourceText = buffer;
+    sourceSize = length;
+    scanSourceBuffer(buffer, length + EndPadding);
+    return true;
+}
+
+bool openSourceInput(const char *path)
+{
+    int fd = STDIN_FILENO;
+    if (path)
+    {
+        fd = open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            fprintf(stderr, "Error opening file: %s\n", path);
+            return false;
+        }
+    }
+
+    struct stat st;
+    bool ok;
+    // A redirected stdin may already have been read from; only map it from the start
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && lseek(fd, 0, SEEK_CUR) == 0)
+        ok = mapSource(fd, static_cast<size_t>(st.st_size)) || readSource(fd);
+    else
+        ok = readSource(fd);
+
+    if (!ok)
+        fprintf(stderr, "Error reading source: %s\n", path ? path : "stdin");
+    if (path)
+        close(fd);
+    return ok;
+}
+
+size_t sourceInputSize()
+{
+    return sourceSize;
+}
+
+const char *sourceInputText()
+{
+    return sourceText;
+}
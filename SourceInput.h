@@ -0,0 +1,37 @@
+#ifndef SOURCE_INPUT_H
+#define SOURCE_INPUT_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// Text of an identifier or string literal token, pointing into the source
+// buffer. The buffer lives until the compiler exits, so a view stays valid
+// after the lexer has moved on and nothing is copied until an AST node
+// needs its own std::string.
+struct TokenView
+{
+    const char *text;
+    unsigned length;
+
+    std::string str() const { return std::string(text, length); }
+    bool equals(const std::string &s) const
+    {
+        return s.size() == length && memcmp(s.data(), text, length) == 0;
+    }
+};
+
+// Makes the whole source available to the scanner as one buffer that flex
+// scans in place. Regular files (including a redirected stdin) are mapped;
+// pipes and terminals are read to the end first. path == nullptr means stdin.
+bool openSourceInput(const char *path);
+
+// Length in bytes of the source opened by openSourceInput
+size_t sourceInputSize();
+// Start of the source text, sourceInputSize() bytes long
+const char *sourceInputText();
+
+// Defined in ssc.l: hands flex a buffer whose last two bytes are NUL
+void scanSourceBuffer(char *base, size_t size);
+
+#endif // SOURCE_INPUT_H
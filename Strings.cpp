@@ -0,0 +1,144 @@
+#include "Strings.h"
+#include "Runtime.h"
+
+// { len, cap, refs, reserved, text }: struct ssc_str_header followed by the
+// text. The reference count of a literal is SSC_STR_LITERAL, so the runtime
+// never writes or frees it.
+static Constant *literalObject(StringRef text)
+{
+    Type *i32 = Type::getInt32Ty(context);
+    return ConstantStruct::getAnon({ConstantInt::get(i32, text.size()), ConstantInt::get(i32, 0),
+                                    ConstantInt::get(i32, UINT32_MAX), ConstantInt::get(i32, 0),
+                                    ConstantDataArray::getString(context, text)});
+}
+
+// Address of the text of a literal object
+static Constant *textOf(GlobalVariable *gv)
+{
+    Constant *zero = ConstantInt::get(Type::getInt32Ty(context), 0);
+    Constant *field = ConstantInt::get(Type::getInt32Ty(context), 4);
+    return ConstantExpr::getInBoundsGetElementPtr(gv->getValueType(), gv, ArrayRef<Constant *>{zero, field, zero});
+}
+
+bool isStringType(Type *type)
+{
+    return type->isPointerTy() && type->getPointerElementType()->isIntegerTy(8);
+}
+
+Constant *emitStringLiteral(StringRef text)
+{
+    Constant *object = literalObject(text);
+    auto *gv = new GlobalVariable(*module, object->getType(), true, GlobalValue::PrivateLinkage, object, ".str");
+    gv->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+    return textOf(gv);
+}
+
+// 256 one-character literals, so a CHAR becomes a STRING without allocating
+static GlobalVariable *charStrings()
+{
+    if (GlobalVariable *gv = module->getNamedGlobal("__ssc_str.chars"))
+        return gv;
+    std::vector<Constant *> objects;
+    for (unsigned c = 0; c < 256; ++c)
+        objects.push_back(literalObject(StringRef(std::string(1, static_cast<char>(c)))));
+    ArrayType *tableType = ArrayType::get(objects[0]->getType(), objects.size());
+    auto *gv = new GlobalVariable(*module, tableType, true, GlobalValue::PrivateLinkage,
+                                  ConstantArray::get(tableType, objects), "__ssc_str.chars");
+    gv->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+    return gv;
+}
+
+Value *emitStringOperand(Value *value)
+{
+    Type *type = value->getType();
+    if (type->isIntegerTy(8))
+    {
+        GlobalVariable *table = charStrings();
+        Value *index = builder.CreateZExt(value, builder.getInt32Ty(), "char.index");
+        return builder.CreateInBoundsGEP(table->getValueType(), table,
+                                         {builder.getInt32(0), index, builder.getInt32(4), builder.getInt32(0)},
+                                         "char.str");
+    }
+    if (isStringType(type))
+        return value;
+    if (type->isPointerTy())
+        return builder.CreatePointerCast(value, builder.getInt8PtrTy());
+    return nullptr;
+}
+
+// Fills an [n x i8*] in the entry block, so concatenations inside loops do not grow the stack
+static Value *partsArray(const std::vector<Value *> &parts)
+{
+    Function *function = builder.GetInsertBlock()->getParent();
+    IRBuilder<> entry(&function->getEntryBlock(), function->getEntryBlock().begin());
+    ArrayType *arrayType = ArrayType::get(builder.getInt8PtrTy(), parts.size());
+    AllocaInst *array = entry.CreateAlloca(arrayType, nullptr, "concat.parts");
+    for (size_t i = 0; i < parts.size(); ++i)
+        builder.CreateStore(parts[i], builder.CreateConstInBoundsGEP2_32(arrayType, array, 0, i));
+    return builder.CreateConstInBoundsGEP2_32(arrayType, array, 0, 0, "parts");
+}
+
+Value *emitConcat(const std::vector<Value *> &parts)
+{
+    return builder.CreateCall(getRuntimeFunction("ssc_str_concat"),
+                              {partsArray(parts), builder.getInt32(parts.size())}, "concat");
+}
+
+void emitAppend(Value *slot, const std::vector<Value *> &parts)
+{
+    builder.CreateCall(getRuntimeFunction("ssc_str_append"),
+                       {slot, partsArray(parts), builder.getInt32(parts.size())});
+}
+
+void emitStringStore(Value *value, Value *slot, bool init)
+{
+    builder.CreateCall(getRuntimeFunction(init ? "ssc_str_init" : "ssc_str_store"), {slot, value});
+}
+
+void emitStringShare(Value *elements, Value *count)
+{
+    builder.CreateCall(getRuntimeFunction("ssc_str_share"), {elements, count});
+}
+
+Value *emitStringComparison(Value *lhs, Value *rhs, CompareOp op)
+{
+    lhs = emitStringOperand(lhs);
+    rhs = emitStringOperand(rhs);
+    if (!lhs || !rhs)
+    {
+        errs() << "comparison between a STRING and a non-STRING value\n";
+        return nullptr;
+    }
+
+    // Equality only needs the lengths and one memcmp
+    if (op == CompareOp::Equal || op == CompareOp::NotEqual)
+    {
+        Value *equal = builder.CreateCall(getRuntimeFunction("ssc_str_equal"), {lhs, rhs}, "streq");
+        return op == CompareOp::Equal ? builder.CreateICmpNE(equal, builder.getInt32(0), "sequal")
+                                      : builder.CreateICmpEQ(equal, builder.getInt32(0), "snotequal");
+    }
+    // ssc_str_compare orders like strcmp; indexed by CompareOp
+    static const struct
+    {
+        CmpInst::Predicate predicate;
+        const char *name;
+    } orderTable[] = {
+        {CmpInst::ICMP_SLT, "sless"},
+        {CmpInst::ICMP_SGT, "sgreater"},
+        {CmpInst::ICMP_EQ, "sequal"},
+        {CmpInst::ICMP_SLE, "slessequal"},
+        {CmpInst::ICMP_SGE, "sgreaterequal"},
+        {CmpInst::ICMP_NE, "snotequal"},
+    };
+    Value *order = builder.CreateCall(getRuntimeFunction("ssc_str_compare"), {lhs, rhs}, "strcmp");
+    const auto &lowering = orderTable[static_cast<unsigned>(op)];
+    return builder.CreateICmp(lowering.predicate, order, builder.getInt32(0), lowering.name);
+}
+
+Value *emitCharCase(Value *c, bool upper)
+{
+    // Letters of the other case differ only in bit 5
+    Value *offset = builder.CreateSub(c, builder.getInt8(upper ? 'a' : 'A'));
+    Value *isLetter = builder.CreateICmpULT(offset, builder.getInt8(26), "isletter");
+    return builder.CreateSelect(isLetter, builder.CreateXor(c, builder.getInt8(0x20)), c, upper ? "ucase" : "lcase");
+}
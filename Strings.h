@@ -0,0 +1,37 @@
+#ifndef STRINGS_H
+#define STRINGS_H
+
+#include "common_includes.h"
+#include "IR.h"
+
+// STRING values.
+//
+// A STRING is an i8* to NUL-terminated text that follows a
+// { i32 len, i32 cap, i32 refs, i32 reserved } header, so LENGTH is a load
+// and OUTPUT needs no strlen. Literals are constant globals with the header
+// filled in. Every store of a STRING into a variable, parameter or array
+// element goes through the runtime (ssc_str_store in ssc_runtime.c), which
+// counts the slots holding each string: s = s & x appends in place when s
+// is the only holder, and temporaries are recycled instead of leaked.
+
+bool isStringType(Type *type);
+// A literal as an i8* into a constant global
+Constant *emitStringLiteral(StringRef text);
+// A STRING, or a CHAR as a one-character STRING; nullptr for other types
+Value *emitStringOperand(Value *value);
+
+// a & b & ... with a single allocation
+Value *emitConcat(const std::vector<Value *> &parts);
+// *slot = *slot & parts..., in place when nothing else holds *slot
+void emitAppend(Value *slot, const std::vector<Value *> &parts);
+// Stores a STRING into a slot; init is for a slot with no STRING in it yet
+void emitStringStore(Value *value, Value *slot, bool init = false);
+// Counts the count STRINGs at elements once more after a whole-array copy
+void emitStringShare(Value *elements, Value *count);
+
+// <, >, ==, <=, >=, != on STRING or CHAR operands
+Value *emitStringComparison(Value *lhs, Value *rhs, CompareOp op);
+// UCASE and LCASE of a CHAR
+Value *emitCharCase(Value *c, bool upper);
+
+#endif // STRINGS_H
@@ -1,69 +1,182 @@
 #include "Symbol_Table.h"
+#include "DebugInfo.h"
 #include "IR.h"
+#include "ModuleInterface.h"
 #include <llvm/IR/IRBuilder.h>
 
+// Estimated heap bytes of a scope entry: the hash node, the name when it is
+// too long for the string itself, and the symbol with its shared_ptr count
+static size_t entryBytes(const std::string &id, const Symbol &symbol)
+{
+    size_t bytes = sizeof(std::pair<const std::string, std::shared_ptr<Symbol>>) + 2 * sizeof(void *);
+    if (id.capacity() > 15)
+        bytes += id.capacity() + 1;
+    bytes += 2 * sizeof(long);
+    switch (symbol.kind)
+    {
+    case Symbol::Kind::Array:
+        bytes += sizeof(ArraySymbol) + static_cast<const ArraySymbol &>(symbol).getRank() * sizeof(std::pair<int, int>);
+        break;
+    case Symbol::Kind::Function:
+        bytes += sizeof(FunctionSymbol) +
+                 static_cast<const FunctionSymbol &>(symbol).getParamTypes().capacity() * sizeof(llvm::Type *);
+        break;
+    default:
+        bytes += sizeof(VariableSymbol);
+        break;
+    }
+    return bytes;
+}
+
 void SymbolTable::enterScope()
 {
     SymbolTableStack.push({});
+    stats.scopes++;
+    stats.peakScopes = std::max(stats.peakScopes, stats.scopes);
 }
 
 void SymbolTable::exitScope()
 {
     if (!SymbolTableStack.empty())
     {
+        for (const auto &entry : SymbolTableStack.top())
+            stats.bytes -= entryBytes(entry.first, *entry.second);
+        stats.symbols -= SymbolTableStack.top().size();
+        stats.scopes--;
         SymbolTableStack.pop();
     }
 }
 
+void SymbolTable::insert(const std::string &id, std::shared_ptr<Symbol> symbol)
+{
+    std::shared_ptr<Symbol> &slot = SymbolTableStack.top()[id];
+    if (slot)
+        stats.bytes -= entryBytes(id, *slot);
+    else
+        stats.symbols++;
+    stats.bytes += entryBytes(id, *symbol);
+    slot = std::move(symbol);
+    stats.peakSymbols = std::max(stats.peakSymbols, stats.symbols);
+    stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+}
+
 llvm::Value *SymbolTable::lookupSymbol(const std::string &id, llvm::Value *index)
 {
+    if (index)
+        return lookupSymbol(id, std::vector<llvm::Value *>{index});
+
+    stats.copiedEntries += stats.symbols;
     auto scopes = SymbolTableStack; // now works because shared_ptr is copyable
     while (!scopes.empty())
     {
         auto &scope = scopes.top();
         auto it = scope.find(id);
         if (it != scope.end())
-        {
-            auto sym = it->second;
+            return it->second->getValue();
+        scopes.pop();
+    }
+    return nullptr;
+}
 
-            if (index == nullptr)
-            {
-                return sym->getValue();
-            }
+llvm::Value *SymbolTable::lookupSymbol(const std::string &id, const std::vector<llvm::Value *> &indices)
+{
+    ArraySymbol *arraySym = lookupArray(id);
+    if (!arraySym || !arraySym->getValue())
+        return nullptr;
+    if (indices.size() != arraySym->getRank())
+    {
+        llvm::errs() << "Array '" << id << "' has " << arraySym->getRank() << " dimensions but is indexed with "
+                     << indices.size() << "\n";
+        return nullptr;
+    }
 
-            if (auto *arraySym = dynamic_cast<ArraySymbol *>(sym.get()))
-            {
-                llvm::Value *arrayPtr = arraySym->getValue();         // Alloca'd [N x i32]*
-                llvm::Type *elementType = arraySym->getElementType(); // i32
+    // One GEP on the flattened offset, whatever the number of dimensions
+    llvm::Value *offset = arraySym->emitOffset(indices, id);
+    if (arraySym->isFixed())
+        return builder.CreateGEP(arraySym->getType(), arraySym->getValue(), {builder.getInt32(0), offset},
+                                 id + "_elem_ptr");
+    return builder.CreateInBoundsGEP(arraySym->getElementType(), arraySym->emitData(), offset, id + "_elem_ptr");
+}
 
-                llvm::Value *zero = llvm::ConstantInt::get(builder.getInt32Ty(), 0);
+// Descriptor fields, as in struct ssc_vec
+enum
+{
+    DescriptorData,
+    DescriptorLength,
+    DescriptorCapacity,
+    DescriptorFirst,
+    DescriptorDimensions
+};
 
-                if (arraySym->getStartIndex() != 0)
-                {
-                    llvm::Value *startIdx = llvm::ConstantInt::get(builder.getInt32Ty(), arraySym->getStartIndex());
-                    index = builder.CreateSub(index, startIdx, id + "_adjusted_index");
-                }
+llvm::Value *ArraySymbol::emitData() const
+{
+    if (isFixed())
+        return builder.CreateConstInBoundsGEP2_32(getType(), value, 0, 0, "array.data");
+    return builder.CreateLoad(elementType->getPointerTo(), builder.CreateStructGEP(getType(), value, DescriptorData),
+                              "array.data");
+}
 
-                llvm::Value *gep = builder.CreateGEP(
-                    arraySym->getType(), // This is [N x i32]
-                    arrayPtr,
-                    {zero, index}, // Accessing index-th element
-                    id + "_elem_ptr");
+llvm::Value *ArraySymbol::emitLength() const
+{
+    if (isFixed())
+        return builder.getInt32(getType()->getArrayNumElements());
+    return builder.CreateLoad(builder.getInt32Ty(), builder.CreateStructGEP(getType(), value, DescriptorLength),
+                              "array.length");
+}
 
-                return gep;
-            }
-            else
-            {
-                return nullptr;
-            }
+llvm::Value *ArraySymbol::emitFirstIndex() const
+{
+    if (isFixed())
+        return builder.getInt32(bounds[0].first);
+    return builder.CreateLoad(builder.getInt32Ty(), builder.CreateStructGEP(getType(), value, DescriptorFirst),
+                              "array.first");
+}
+
+llvm::Value *ArraySymbol::emitInnerDimensions() const
+{
+    return builder.CreateInBoundsGEP(getType(), value,
+                                     {builder.getInt32(0), builder.getInt32(DescriptorDimensions),
+                                      builder.getInt32(0), builder.getInt32(0)},
+                                     "array.dims");
+}
+
+// ((i0 - first0) * extent1 + (i1 - first1)) * extent2 + ..., with the bounds
+// of a fixed array as constants
+llvm::Value *ArraySymbol::emitOffset(const std::vector<llvm::Value *> &indices, const std::string &name) const
+{
+    llvm::Value *offset = nullptr;
+    for (size_t d = 0; d < indices.size(); ++d)
+    {
+        llvm::Value *first;
+        llvm::Value *extent = nullptr;
+        if (isFixed())
+        {
+            first = bounds[d].first != 0 ? builder.getInt32(bounds[d].first) : nullptr;
+            extent = builder.getInt32(bounds[d].second - bounds[d].first + 1);
         }
-        scopes.pop();
+        else if (d == 0)
+            first = emitFirstIndex();
+        else
+        {
+            llvm::Value *dim = builder.CreateInBoundsGEP(getType(), value,
+                                                         {builder.getInt32(0), builder.getInt32(DescriptorDimensions),
+                                                          builder.getInt32(d - 1)});
+            llvm::Type *dimType = llvm::StructType::get(context, {builder.getInt32Ty(), builder.getInt32Ty()});
+            first = builder.CreateLoad(builder.getInt32Ty(), builder.CreateStructGEP(dimType, dim, 0), "dim.first");
+            extent = builder.CreateLoad(builder.getInt32Ty(), builder.CreateStructGEP(dimType, dim, 1), "dim.extent");
+        }
+
+        llvm::Value *index = indices[d];
+        if (first)
+            index = builder.CreateSub(index, first, name + "_adjusted_index");
+        offset = offset ? builder.CreateAdd(builder.CreateMul(offset, extent), index) : index;
     }
-    return nullptr;
+    return offset;
 }
 
 llvm::Type *SymbolTable::getSymbolType(const std::string &id)
 {
+    stats.copiedEntries += stats.symbols;
     auto scopes = SymbolTableStack;
     while (!scopes.empty())
     {
@@ -78,24 +191,23 @@ llvm::Type *SymbolTable::getSymbolType(const std::string &id)
     return nullptr;
 }
 
-void SymbolTable::declareSymbol(const std::string &id, llvm::Type *type, bool isArray, int startIndex, int endIndex)
+void SymbolTable::declareSymbol(const std::string &id, llvm::Type *type, bool isArray,
+                                const std::vector<std::pair<int, int>> &bounds, ArraySymbol::Extent extent)
 {
     if (SymbolTableStack.empty())
         return;
 
     if (isArray)
     {
-        int size = endIndex - startIndex + 1;
-        llvm::Type *arrayType = llvm::ArrayType::get(type, size); // [N x i32]
-        SymbolTableStack.top()[id] = std::make_shared<ArraySymbol>(type, nullptr, startIndex, endIndex);
+        insert(id, std::make_shared<ArraySymbol>(type, nullptr, bounds, extent));
     }
     else
     {
-        SymbolTableStack.top()[id] = std::make_shared<VariableSymbol>(type, nullptr);
+        insert(id, std::make_shared<VariableSymbol>(type, nullptr));
     }
 }
 
-AllocaInst *SymbolTable::allocateSymbol(const std::string &id)
+AllocaInst *SymbolTable::allocateSymbol(const std::string &id, unsigned argNo)
 {
     std::stack<std::unordered_map<std::string, std::shared_ptr<Symbol>>> temp;
 
@@ -110,6 +222,8 @@ AllocaInst *SymbolTable::allocateSymbol(const std::string &id)
             {
                 AllocaInst *alloca = builder.CreateAlloca(sym->getType(), nullptr, id);
                 sym->setValue(alloca);
+                auto *array = dynamic_cast<ArraySymbol *>(sym.get());
+                debugVariable(alloca, id, argNo, array ? array->getStartIndex() : 0);
                 return alloca;
             }
             else
@@ -132,6 +246,7 @@ AllocaInst *SymbolTable::allocateSymbol(const std::string &id)
 
 bool SymbolTable::checkDeclaration(const std::string &id)
 {
+    stats.copiedEntries += stats.symbols;
     auto scopes = SymbolTableStack;
     while (!scopes.empty())
     {
@@ -141,3 +256,67 @@ bool SymbolTable::checkDeclaration(const std::string &id)
     }
     return false;
 }
+
+
+void SymbolTable::declareFunction(const std::string &id, llvm::Function *func, llvm::Type *retType,
+                                  std::vector<llvm::Type *> paramTypes)
+{
+    if (SymbolTableStack.empty())
+        return;
+    insert(id, std::make_shared<FunctionSymbol>(func, retType, std::move(paramTypes)));
+}
+
+FunctionSymbol *SymbolTable::lookupFunction(const std::string &id)
+{
+    stats.copiedEntries += stats.symbols;
+    auto scopes = SymbolTableStack;
+    while (!scopes.empty())
+    {
+        auto it = scopes.top().find(id);
+        if (it != scopes.top().end())
+            return dynamic_cast<FunctionSymbol *>(it->second.get());
+        scopes.pop();
+    }
+    return nullptr;
+}
+
+ArraySymbol *SymbolTable::lookupArray(const std::string &id)
+{
+    stats.copiedEntries += stats.symbols;
+    auto scopes = SymbolTableStack;
+    while (!scopes.empty())
+    {
+        auto it = scopes.top().find(id);
+        if (it != scopes.top().end())
+            return dynamic_cast<ArraySymbol *>(it->second.get());
+        scopes.pop();
+    }
+    return nullptr;
+}
+
+bool SymbolTable::importInterface(const ModuleInterface &iface)
+{
+    bool ok = true;
+    for (size_t i = 0; i < iface.size(); i++)
+    {
+        RoutineSignature sig = iface.routine(i);
+        llvm::Type *retType = ModuleInterface::typeOf(sig.returnType);
+        std::vector<llvm::Type *> paramTypes;
+        for (const std::string &param : sig.paramTypes)
+            paramTypes.push_back(ModuleInterface::typeOf(param));
+
+        llvm::FunctionType *funcType = llvm::FunctionType::get(retType, paramTypes, false);
+        llvm::Function *func = module->getFunction(sig.name);
+        if (func && func->getFunctionType() != funcType)
+        {
+            llvm::errs() << "Semantic error: imported routine '" << sig.name << "' conflicts with an existing declaration\n";
+            ok = false;
+            continue;
+        }
+        if (!func)
+            func = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, sig.name, module);
+
+        declareFunction(sig.name, func, retType, paramTypes);
+    }
+    return ok;
+}
\ No newline at end of file
@@ -52,19 +52,47 @@ public:
 // Array Symbol
 class ArraySymbol : public Symbol
 {
+public:
+    // Fixed arrays have literal bounds and are stored in the symbol's alloca.
+    // Arrays with bounds computed at run time and growable LISTs are a
+    // { T*, i32 length, i32 capacity, i32 first } descriptor of a heap block
+    // (struct ssc_vec in ssc_runtime.c), followed for an array of several
+    // dimensions by the first index and extent of each dimension after the
+    // first. Either way the elements are contiguous in row-major order.
+    enum class Extent
+    {
+        Fixed,
+        Runtime,
+        Growable
+    };
+
+private:
     llvm::Value *value;
     llvm::Type *elementType;
-    int startIndex;
-    int endIndex;
+    // First and last index of each dimension, outermost first. Only the
+    // number of dimensions is used unless the array is fixed.
+    std::vector<std::pair<int, int>> bounds;
+    Extent extent;
 
 public:
-    ArraySymbol(llvm::Type *elemType, llvm::Value *v, int start, int end)
-        : Symbol(Kind::Array), value(v), elementType(elemType),
-          startIndex(start), endIndex(end) {}
+    ArraySymbol(llvm::Type *elemType, llvm::Value *v, const std::vector<std::pair<int, int>> &dims,
+                Extent ext = Extent::Fixed)
+        : Symbol(Kind::Array), value(v), elementType(elemType), bounds(dims), extent(ext) {}
 
     llvm::Type *getType() const override
     {
-        int size = endIndex - startIndex + 1;
+        llvm::LLVMContext &ctx = elementType->getContext();
+        if (extent != Extent::Fixed)
+        {
+            llvm::Type *i32 = llvm::Type::getInt32Ty(ctx);
+            std::vector<llvm::Type *> fields = {elementType->getPointerTo(), i32, i32, i32};
+            if (bounds.size() > 1)
+                fields.push_back(llvm::ArrayType::get(llvm::StructType::get(ctx, {i32, i32}), bounds.size() - 1));
+            return llvm::StructType::get(ctx, fields);
+        }
+        uint64_t size = 1;
+        for (const auto &dim : bounds)
+            size *= dim.second - dim.first + 1;
         return llvm::ArrayType::get(elementType, size);
     }
 
@@ -72,8 +100,20 @@ public:
     void setValue(llvm::Value *v) override { value = v; }
 
     llvm::Type *getElementType() const { return elementType; }
-    int getStartIndex() const { return startIndex; }
-    int getEndIndex() const { return endIndex; }
+    int getStartIndex() const { return bounds[0].first; }
+    unsigned getRank() const { return bounds.size(); }
+    Extent getExtent() const { return extent; }
+    bool isFixed() const { return extent == Extent::Fixed; }
+
+    // Address of the first element, number of elements and first index;
+    // constants for a fixed array, loaded from the descriptor otherwise
+    llvm::Value *emitData() const;
+    llvm::Value *emitLength() const;
+    llvm::Value *emitFirstIndex() const;
+    // Row-major position of the element at indices, counted from the first element
+    llvm::Value *emitOffset(const std::vector<llvm::Value *> &indices, const std::string &name) const;
+    // The { first, extent } pairs of the dimensions after the first, in the descriptor
+    llvm::Value *emitInnerDimensions() const;
 };
 
 // ───────────────────────────────────────────
@@ -101,6 +141,8 @@ public:
     const std::vector<llvm::Type *> &getParamTypes() const { return paramTypes; }
 };
 
+class ModuleInterface;
+
 // ───────────────────────────────────────────
 // Symbol Table with scoped support
 class SymbolTable
@@ -112,14 +154,39 @@ public:
     void exitScope();
 
     llvm::Value *lookupSymbol(const std::string &id, llvm::Value *index = nullptr);
+    // Address of an element of an array of any number of dimensions
+    llvm::Value *lookupSymbol(const std::string &id, const std::vector<llvm::Value *> &indices);
     void declareSymbol(const std::string &id, llvm::Type *type,
-                       bool isArray = false, int startIndex = -1, int endIndex = -1);
-    llvm::AllocaInst *allocateSymbol(const std::string &id);
+                       bool isArray = false, const std::vector<std::pair<int, int>> &bounds = {},
+                       ArraySymbol::Extent extent = ArraySymbol::Extent::Fixed);
+    // argNo is the 1-based parameter number when id is a routine parameter (for debug info)
+    llvm::AllocaInst *allocateSymbol(const std::string &id, unsigned argNo = 0);
     llvm::Type *getSymbolType(const std::string &id);
     bool checkDeclaration(const std::string &id);
 
+    void declareFunction(const std::string &id, llvm::Function *func, llvm::Type *retType,
+                         std::vector<llvm::Type *> paramTypes);
+    FunctionSymbol *lookupFunction(const std::string &id);
+    ArraySymbol *lookupArray(const std::string &id);
+    // Declares every routine exported by a separately compiled module
+    bool importInterface(const ModuleInterface &iface);
+
+    // Sizes for --mem-report; bytes are estimated from the entries
+    struct Stats
+    {
+        size_t symbols = 0, peakSymbols = 0;
+        size_t scopes = 0, peakScopes = 0;
+        size_t bytes = 0, peakBytes = 0;
+        uint64_t copiedEntries = 0; // copied by lookups that walk a copy of the stack
+    };
+    const Stats &getStats() const { return stats; }
+
 private:
+    // Declares id in the innermost scope, replacing a symbol of the same name
+    void insert(const std::string &id, std::shared_ptr<Symbol> symbol);
+
     std::stack<std::unordered_map<std::string, std::shared_ptr<Symbol>>> SymbolTableStack;
+    Stats stats;
 };
 
 #endif // SYMBOL_TABLE_H
@@ -0,0 +1,278 @@
+#include "Target.h"
+#include "Options.h"
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+// The CPU and features chosen by applyTarget; without options the code is
+// for the generic CPU of the triple, as it always was
+static std::string targetCPU = "generic";
+static std::string targetFeatures;
+
+// Every target is registered for --march; their asm parsers read the
+// runtime's inline asm when objects are written
+static void initTargets()
+{
+    static const bool initialized = []()
+    {
+        InitializeAllTargetInfos();
+        InitializeAllTargets();
+        InitializeAllTargetMCs();
+        InitializeAllAsmPrinters();
+        InitializeAllAsmParsers();
+        return true;
+    }();
+    (void)initialized;
+}
+
+static std::string hostFeatures()
+{
+    StringMap<bool> host;
+    SubtargetFeatures features;
+    if (sys::getHostCPUFeatures(host))
+    {
+        for (const auto &feature : host)
+            features.AddFeature(feature.first(), feature.second);
+    }
+    return features.getString();
+}
+
+static void appendFeatures(std::string &features, StringRef more)
+{
+    if (more.empty())
+        return;
+    if (!features.empty())
+        features += ",";
+    features += more.str();
+}
+
+// Gives F the selected CPU and features, keeping those it was compiled with of its own
+static void setFunctionTarget(Function &F)
+{
+    std::string features = targetFeatures;
+    SmallVector<StringRef, 16> own;
+    F.getFnAttribute("target-features").getValueAsString().split(own, ',', -1, false);
+    for (StringRef feature : own)
+    {
+        if (feature.startswith("+"))
+            appendFeatures(features, feature);
+    }
+    F.addFnAttr("target-cpu", targetCPU);
+    // Tuning follows the CPU
+    F.removeFnAttr("tune-cpu");
+    if (!features.empty())
+        F.addFnAttr("target-features", features);
+}
+
+bool applyTarget(Module &M)
+{
+    initTargets();
+    Triple runtimeTriple(M.getTargetTriple());
+    Triple triple(M.getTargetTriple().empty() ? sys::getDefaultTargetTriple() : M.getTargetTriple());
+    if (!compilerOptions.march.empty())
+    {
+        std::string error;
+        if (!TargetRegistry::lookupTarget(compilerOptions.march, triple, error))
+        {
+            fprintf(stderr, "--march=%s: %s\n", compilerOptions.march.c_str(), error.c_str());
+            return false;
+        }
+        // The embedded runtime is bitcode for the machine the compiler was built for
+        if (compilerOptions.linkRuntime && triple.getArch() != runtimeTriple.getArch())
+        {
+            fprintf(stderr, "--march=%s needs --no-link-runtime and an ssc_runtime.o built for %s\n",
+                    compilerOptions.march.c_str(), triple.getArchName().str().c_str());
+            return false;
+        }
+    }
+
+    if (compilerOptions.mcpu == "native")
+    {
+        if (triple.getArch() != Triple(sys::getProcessTriple()).getArch())
+        {
+            fprintf(stderr, "--mcpu=native cannot be combined with --march=%s\n", compilerOptions.march.c_str());
+            return false;
+        }
+        targetCPU = sys::getHostCPUName().str();
+        targetFeatures = hostFeatures();
+    }
+    else if (!compilerOptions.mcpu.empty())
+        targetCPU = compilerOptions.mcpu;
+    appendFeatures(targetFeatures, compilerOptions.targetFeatures);
+
+    M.setTargetTriple(triple.str());
+    std::unique_ptr<TargetMachine> machine = createTargetMachine(triple.str(), CodeGenOpt::Default, TargetOptions());
+    if (!machine)
+        return false;
+    M.setDataLayout(machine->createDataLayout());
+
+    if (compilerOptions.mcpu.empty() && compilerOptions.targetFeatures.empty())
+        return true;
+    for (Function &F : M)
+    {
+        if (!F.isDeclaration())
+            setFunctionTarget(F);
+    }
+    fprintf(stderr, "Target: %s, CPU %s%s%s\n", triple.str().c_str(), targetCPU.c_str(),
+            compilerOptions.targetFeatures.empty() ? "" : ", features ", compilerOptions.targetFeatures.c_str());
+    return true;
+}
+
+std::unique_ptr<TargetMachine> createTargetMachine(const std::string &triple, CodeGenOpt::Level level,
+                                                   const TargetOptions &options)
+{
+    initTargets();
+    std::string error;
+    const Target *target = TargetRegistry::lookupTarget(triple, error);
+    if (!target)
+    {
+        errs() << "Cannot generate code for " << triple << ": " << error << "\n";
+        return nullptr;
+    }
+    return std::unique_ptr<TargetMachine>(
+        target->createTargetMachine(triple, targetCPU, targetFeatures, options, Reloc::PIC_, None, level));
+}
+
+// --- Multiversioning ---
+
+struct Version
+{
+    const char *suffix;
+    const char *features;
+    int32_t level; // as returned by ssc_cpu_level
+};
+
+// Best first, the order the dispatchers try them in
+static const Version versions[] = {
+    {"avx512", "+avx512f,+avx512bw,+avx512vl", 3},
+    {"avx2", "+avx2", 2},
+    {"sse4.2", "+sse4.2", 1},
+};
+
+// User routines with a loop and the runtime's array kernels; the rest of
+// the runtime does not loop over data. The features of a function are no
+// guide here: applyTarget has already merged --mcpu and --target-features
+// into every one of them.
+static bool wantsVersions(Function &F)
+{
+    if (F.isDeclaration() || F.hasAvailableExternallyLinkage() || F.isVarArg())
+        return false;
+    StringRef name = F.getName();
+    if (name.startswith("ssc_") && !name.startswith("ssc_array_"))
+        return false;
+    // Kernels the runtime writes for a level of their own are named ssc_..._avx2 and stay as they are
+    if (name.startswith("ssc_") && name.endswith("_avx2"))
+        return false;
+    DominatorTree DT(F);
+    LoopInfo LI(DT);
+    return !LI.empty();
+}
+
+// A copy of F's body named NAME.suffix, compiled with features on top of F's own
+static Function *cloneVersion(Function &F, const char *suffix, const char *features)
+{
+    ValueToValueMapTy map;
+    Function *clone = CloneFunction(&F, map);
+    clone->setName(F.getName() + "." + suffix);
+    clone->setLinkage(GlobalValue::InternalLinkage);
+    if (features)
+    {
+        std::string merged = F.getFnAttribute("target-features").getValueAsString().str();
+        appendFeatures(merged, features);
+        clone->addFnAttr("target-features", merged);
+    }
+    // Recursive calls stay in the version instead of going through the dispatcher
+    for (BasicBlock &BB : *clone)
+    {
+        for (Instruction &I : BB)
+        {
+            auto *call = dyn_cast<CallInst>(&I);
+            if (call && call->getCalledFunction() == &F)
+                call->setCalledFunction(clone);
+        }
+    }
+    return clone;
+}
+
+static void emitTailCall(BasicBlock *block, Function *callee, ArrayRef<Value *> args)
+{
+    IRBuilder<> b(block);
+    CallInst *call = b.CreateCall(callee, args);
+    call->setTailCall();
+    call->setCallingConv(callee->getCallingConv());
+    if (callee->getReturnType()->isVoidTy())
+        b.CreateRetVoid();
+    else
+        b.CreateRet(call);
+}
+
+// Moves F's body into its versions and makes F pick one by the CPU's level
+static void addVersions(Function &F, const std::vector<const Version *> &levels, FunctionCallee cpuLevel)
+{
+    Function *fallback = cloneVersion(F, "default", nullptr);
+    std::vector<Function *> clones;
+    for (const Version *version : levels)
+        clones.push_back(cloneVersion(F, version->suffix, version->features));
+
+    // deleteBody leaves a declaration, which is always external
+    GlobalValue::LinkageTypes linkage = F.getLinkage();
+    F.deleteBody();
+    LLVMContext &ctx = F.getContext();
+    IRBuilder<> b(BasicBlock::Create(ctx, "entry", &F));
+    Value *level = b.CreateCall(cpuLevel, {}, "cpu.level");
+    std::vector<Value *> args;
+    for (Argument &arg : F.args())
+        args.push_back(&arg);
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        BasicBlock *call = BasicBlock::Create(ctx, levels[i]->suffix, &F);
+        BasicBlock *next = BasicBlock::Create(ctx, "next", &F);
+        b.CreateCondBr(b.CreateICmpSGE(level, b.getInt32(levels[i]->level)), call, next);
+        emitTailCall(call, clones[i], args);
+        b.SetInsertPoint(next);
+    }
+    emitTailCall(b.GetInsertBlock(), fallback, args);
+    F.setLinkage(linkage);
+}
+
+void multiversionModule(Module &M)
+{
+    Triple triple(M.getTargetTriple());
+    if (!triple.isX86())
+    {
+        fprintf(stderr, "Multiversion: no versions for %s, skipped\n", triple.str().c_str());
+        return;
+    }
+    std::unique_ptr<TargetMachine> machine = createTargetMachine(triple.str(), CodeGenOpt::Default, TargetOptions());
+    if (!machine)
+        return;
+    // Levels the selected CPU has anyway are what the default version runs
+    std::vector<const Version *> levels;
+    for (const Version &version : versions)
+    {
+        if (!machine->getMCSubtargetInfo()->checkFeatures(version.features))
+            levels.push_back(&version);
+    }
+    if (levels.empty())
+    {
+        fprintf(stderr, "Multiversion: CPU %s already has every level, skipped\n", targetCPU.c_str());
+        return;
+    }
+
+    std::vector<Function *> functions;
+    for (Function &F : M)
+    {
+        if (wantsVersions(F))
+            functions.push_back(&F);
+    }
+    FunctionCallee cpuLevel =
+        M.getOrInsertFunction("ssc_cpu_level", FunctionType::get(Type::getInt32Ty(M.getContext()), false));
+    for (Function *F : functions)
+        addVersions(*F, levels, cpuLevel);
+    fprintf(stderr, "Multiversion: %zu functions in %zu versions each\n", functions.size(), levels.size() + 1);
+}
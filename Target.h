@@ -0,0 +1,39 @@
+#ifndef TARGET_H
+#define TARGET_H
+
+#include "common_includes.h"
+#include <llvm/Target/TargetMachine.h>
+
+// Target selection (--march, --mcpu, --target-features) and function
+// multiversioning (--multiversion).
+//
+// The module always gets a triple and data layout: the runtime's, the
+// host's with --no-link-runtime, or the one --march picks. --mcpu and
+// --target-features are written into every defined function as its
+// target-cpu and target-features, so the IR printed for llc carries them
+// as well; the features a runtime function was compiled with of its own
+// (the AVX2 kernels) are kept. --mcpu=native takes the CPU name and
+// features from the host. Every TargetMachine the compiler makes, for the
+// optimizer's cost model, -o and --emit-objects, is for the same choice.
+//
+// --multiversion keeps one binary fast across CPU generations. Every user
+// routine with a loop, and every ssc_array_ kernel of the runtime, is
+// cloned into NAME.default, NAME.sse4.2, NAME.avx2 and NAME.avx512, each
+// compiled (and vectorized) with that level's features, and NAME itself
+// becomes a dispatcher that asks ssc_cpu_level() and tail-calls the best
+// version the CPU runs. Levels the selected CPU already has get no clone.
+// Only x86 has versions; the dispatchers also work in the JIT.
+
+// Sets M's triple, data layout and the CPU and features of its functions;
+// false after reporting an error. Runs once the runtime is linked.
+bool applyTarget(Module &M);
+
+// A TargetMachine for triple and the selected CPU and features; null after
+// reporting an error. Safe to call from several threads after applyTarget.
+std::unique_ptr<TargetMachine> createTargetMachine(const std::string &triple, CodeGenOpt::Level level,
+                                                   const TargetOptions &options);
+
+// Adds the versions and dispatchers of --multiversion to M
+void multiversionModule(Module &M);
+
+#endif // TARGET_H
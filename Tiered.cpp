@@ -0,0 +1,121 @@
+#include "Tiered.h"
+#include "Jit.h"
+#include "Strings.h"
+
+TieredCompiler::TieredCompiler(std::vector<ASTNode *> &program)
+{
+    std::vector<ASTNode *> rest;
+    for (ASTNode *node : program)
+    {
+        if (dynamic_cast<ProcedureAST *>(node) || dynamic_cast<FuncAST *>(node))
+            routines.push_back(node);
+        else
+            rest.push_back(node);
+    }
+    program.swap(rest);
+}
+
+TieredCompiler::~TieredCompiler()
+{
+    for (ASTNode *node : routines)
+        delete node;
+}
+
+// Adds NAME.tier for F: void (Register *args, Register *result), which
+// loads each argument from its 8-byte register and stores the result
+static bool emitTierEntry(Function *F)
+{
+    Type *registerTy = Type::getInt64Ty(context);
+    Type *i32 = Type::getInt32Ty(context);
+    Type *resultTy = F->getReturnType();
+    if (isStringType(resultTy))
+        return false;
+    for (Argument &arg : F->args())
+        if (isStringType(arg.getType()))
+            return false;
+
+    FunctionType *entryTy = FunctionType::get(Type::getVoidTy(context),
+                                              {registerTy->getPointerTo(), registerTy->getPointerTo()}, false);
+    Function *entry = Function::Create(entryTy, Function::ExternalLinkage, F->getName() + ".tier", module);
+    IRBuilder<> b(BasicBlock::Create(context, "entry", entry));
+    Value *args = entry->getArg(0);
+    Value *result = entry->getArg(1);
+
+    std::vector<Value *> values;
+    for (Argument &arg : F->args())
+    {
+        Value *slot = b.CreateConstInBoundsGEP1_32(registerTy, args, arg.getArgNo());
+        Type *type = arg.getType();
+        // CHAR and BOOLEAN are held as INTEGERs
+        if (type->isIntegerTy(1) || type->isIntegerTy(8))
+        {
+            Value *value = b.CreateLoad(i32, b.CreateBitCast(slot, i32->getPointerTo()));
+            values.push_back(type->isIntegerTy(1) ? b.CreateICmpNE(value, b.getInt32(0)) : b.CreateTrunc(value, type));
+        }
+        else
+            values.push_back(b.CreateLoad(type, b.CreateBitCast(slot, type->getPointerTo())));
+    }
+    Value *value = b.CreateCall(F, values);
+
+    if (resultTy->isIntegerTy(1))
+        value = b.CreateZExt(value, i32);
+    else if (resultTy->isIntegerTy(8))
+        value = b.CreateSExt(value, i32);
+    if (!resultTy->isVoidTy())
+        b.CreateStore(value, b.CreateBitCast(result, value->getType()->getPointerTo()));
+    b.CreateRetVoid();
+    return true;
+}
+
+bool TieredCompiler::load()
+{
+    if (state != State::Pending)
+        return state == State::Loaded;
+    state = State::Failed;
+
+    // The routines were checked in a scope that has been left since
+    globalSymbolTable->enterScope();
+    bool ok = true;
+    for (ASTNode *node : routines)
+        ok = codegenStatement(node) && ok;
+    globalSymbolTable->exitScope();
+    if (!ok)
+    {
+        fprintf(stderr, "Tiered: code generation failed, staying in the interpreter\n");
+        return false;
+    }
+
+    size_t entries = 0;
+    for (ASTNode *node : routines)
+    {
+        auto *proc = dynamic_cast<ProcedureAST *>(node);
+        auto *func = dynamic_cast<FuncAST *>(node);
+        Function *F = module->getFunction(proc ? proc->Identifier->name : func->Identifier->name);
+        if (F && emitTierEntry(F))
+            entries++;
+    }
+    fprintf(stderr, "Tiered: %zu routines generated, %zu callable from the interpreter\n", routines.size(), entries);
+
+    if (!loadLazyJIT(*module))
+        return false;
+    state = State::Loaded;
+    return true;
+}
+
+NativeEntry TieredCompiler::compile(const BytecodeProgram &program, int32_t index)
+{
+    const BytecodeFunction &function = program.functions[index];
+    if (!load())
+        return nullptr;
+    // Only routines that got an entry have one to look up
+    if (!module->getFunction(function.name + ".tier"))
+    {
+        fprintf(stderr, "Tiered: %s has STRING parameters or result, staying in the interpreter\n",
+                function.name.c_str());
+        return nullptr;
+    }
+    void *address = lookupLazyJIT(function.name + ".tier");
+    if (address)
+        fprintf(stderr, "Tiered: %s runs as native code from now on\n", function.name.c_str());
+    return reinterpret_cast<NativeEntry>(address);
+}
@@ -0,0 +1,41 @@
+#ifndef TIERED_H
+#define TIERED_H
+
+#include "AST.h"
+#include "Interpreter.h"
+
+// Tiered execution (--tiered).
+//
+// The program starts in the bytecode interpreter straight after parsing, as
+// with --interp, but the PROCEDURE and FUNCTION ASTs are kept. When the
+// first routine gets hot they are all generated into the module with their
+// usual codegen() and handed to the lazy JIT, which compiles each one to
+// machine code on its first native call. A routine with numeric parameters
+// and result also gets NAME.tier, an entry that reads its arguments from
+// the interpreter's registers; from its next call on the interpreter calls
+// that instead of the bytecode. Routines with STRING parameters or result
+// stay in the interpreter, though native routines can still call them
+// natively.
+//
+// The module is not linked with the embedded runtime: native code calls the
+// ssc_runtime.c inside the compiler, the same one the interpreter uses, so
+// both tiers write to one output buffer and draw from one RAND sequence.
+
+class TieredCompiler : public NativeTier
+{
+public:
+    // Moves the PROCEDUREs and FUNCTIONs of program into the compiler
+    explicit TieredCompiler(std::vector<ASTNode *> &program);
+    ~TieredCompiler() override;
+
+    NativeEntry compile(const BytecodeProgram &program, int32_t index) override;
+
+private:
+    // Generates the routines and loads the module into the JIT, once
+    bool load();
+
+    std::vector<ASTNode *> routines;
+    enum class State { Pending, Loaded, Failed } state = State::Pending;
+};
+
+#endif // TIERED_H
@@ -3,8 +3,15 @@
     #include <stdlib.h>
     extern int yyparse();
     extern int yylex();
+    #include "MemReport.h"
+    // --mem-report charges the lexer's allocations apart from the parser's
+    static int countedLex() {
+        MemPhaseScope phase(MemPhase::Lex);
+        return yylex();
+    }
+    #define yylex countedLex
+    extern int runLexerBenchmark();
     extern int yylineno;  // Add this line to declare yylineno
-    extern FILE *yyin;
     #define YYDEBUG 1
 
     #ifdef DEBUGBISON
@@ -16,16 +23,31 @@
 
 %code requires {
     #include "AST.h"
+    #include "DebugInfo.h"
+    #include "Executable.h"
+    #include "Incremental.h"
+    #include "Interpreter.h"
+    #include "Jit.h"
+    #include "Target.h"
+    #include "Tiered.h"
+    #include "ParallelCodegen.h"
+    #include "LineProfile.h"
+    #include "Options.h"
+    #include "Optimizer.h"
+    #include "Passes.h"
+    #include "Profile.h"
+    #include "Runtime.h"
+    #include "SourceInput.h"
     #include <vector>
     class TypeAST;  // Forward declaration
 }
 
 %union 
 {
-    char *identifier;
+    TokenView identifier;
     int integer_literal;
     double real_literal;
-    char *string_literal;
+    TokenView string_literal;
     char char_literal;
     bool boolean_literal;
     char* date_literal;
@@ -52,7 +74,7 @@
 %token <date_literal> tok_Date_Literal
 
 %token tok_Declare
-%token tok_Array
+%token tok_Array tok_List
 %token tok_Of
 %token tok_Output tok_Input
 %token tok_If tok_Else tok_End_If
@@ -62,6 +84,8 @@
 %token tok_Procedure tok_End_Procedure
 %token tok_Function tok_End_Function tok_Returns tok_Return
 %token tok_Call
+%token tok_Import
+%token tok_Open_File tok_Read_File tok_Write_File tok_Close_File
 %token tok_Integer tok_Real tok_Boolean tok_Char tok_String tok_Date
 
 %token tok_Indent tok_Dedent tok_Newline
@@ -75,6 +99,7 @@
 %token tok_Or "OR"
 %token tok_Not "NOT"
 
+%left '&'
 %left '+' '-'
 %left '*' '/'
 %left tok_Or
@@ -88,50 +113,179 @@
 %type <integer_literal> opt_step integer_expr
 %type <ast_node> statement expression term
 %type <ast_node> if_stmt for_stmt while_stmt repeat_stmt output
-%type <ast_node> procedure_stmt function_stmt func_call_stmt return_stmt declaration
+%type <ast_node> procedure_stmt function_stmt func_call_stmt return_stmt declaration import_stmt file_stmt
 %type <comparison_ast> comparison
 %type <assignment_ast> assignment
 %type <array_assignment_ast> array_assignment
 %type <input_ast> input
 %type <type_node> type
-%type <stmt_list> statements statement_line argument_list
+%type <stmt_list> program statements statement_line argument_list array_bounds index_list
 %type <param_list> parameter_list
 %type <statement_block_ast> statement_block
 
-%start root
+%code {
+    // Signatures exported through --emit-interface
+    static std::vector<RoutineSignature> exports;
+    // Set by a statement a --module cannot hold; main fails before writing anything
+    static bool moduleError = false;
+
+    static void collectExport(ASTNode* node) {
+        if (auto *proc = dynamic_cast<ProcedureAST*>(node))
+            exports.push_back(proc->exportSignature());
+        else if (auto *func = dynamic_cast<FuncAST*>(node))
+            exports.push_back(func->exportSignature());
+        else if (compilerOptions.moduleMode && !dynamic_cast<ImportAST*>(node)) {
+            fprintf(stderr, "Semantic error: only PROCEDURE, FUNCTION and IMPORT are allowed at the top level of a module\n");
+            moduleError = true;
+        }
+    }
 
-%%
+    // Cache of --incremental, planned when the whole program is lowered
+    static IncrementalCache *cache = nullptr;
 
-root:
-    opt_newline statements opt_newline {
-        fprintf(stderr, "Processing %zu statements\n", $2->size());
+    // Generates one top-level statement and frees its AST
+    static void compileTopLevel(ASTNode* node) {
+        if (cache && cache->skipCodegen(node)) {
+            delete node;
+            return;
+        }
+        fprintf(stderr, "Codegen for node type: %s\n", typeid(*node).name());
+        codegenStatement(node);
+        delete node;
+    }
 
-        globalSymbolTable->enterScope();
+    // Bytecode of --interp, run instead of the module when set
+    static BytecodeProgram *bytecode = nullptr;
+    // Native code for its hot routines with --tiered
+    static TieredCompiler *tiering = nullptr;
+
+    // The last pass: generates IR for the statements and frees them
+    static bool lowerProgram(std::vector<ASTNode*>& program) {
+        recordASTMemory(program);
+        MemPhaseScope phase(MemPhase::Codegen);
+        if (compilerOptions.interp) {
+            bytecode = compileBytecode(program);
+            if (bytecode) {
+                if (compilerOptions.tiered)
+                    tiering = new TieredCompiler(program);
+                for (ASTNode* node : program)
+                    delete node;
+                program.clear();
+                return true;
+            }
+            fprintf(stderr, "--interp: running in the JIT instead\n");
+        }
 
-         for (ASTNode* node : *$2) {
-            fprintf(stderr, "sematic check for node type: %s\n", typeid(*node).name());
-            bool result = node->semanticCheck() ;
+        for (ASTNode* node : program)
+            collectExport(node);
+
+        if (!compilerOptions.stream) {
+            if (!compilerOptions.incrementalDir.empty()) {
+                cache = new IncrementalCache(compilerOptions.incrementalDir);
+                cache->plan(program);
+            }
+
+            // main is profiled as the routine made of the top-level statements
+            Fingerprint mainFp;
+            for (ASTNode* node : program)
+                if (!dynamic_cast<ProcedureAST*>(node) && !dynamic_cast<FuncAST*>(node))
+                    mainFp.addNode(node);
+            profileBeginFunction(mainFunction, mainFp);
+        }
 
+        for (ASTNode* node : program)
+            compileTopLevel(node);
+        program.clear();
+        return true;
+    }
+
+    // Front-end passes, run over the whole program or, with --stream, over each top-level line
+    static ASTPassManager& topLevelPasses() {
+        static ASTPassManager *passes = nullptr;
+        if (!passes) {
+            passes = new ASTPassManager();
+            passes->addPass(std::unique_ptr<ASTPass>(new SemaPass()));
+            passes->addPass(std::unique_ptr<ASTPass>(new ConstantFoldPass()));
+            passes->addPass(std::unique_ptr<ASTPass>(new LoopReportPass()));
+            passes->addPass(std::unique_ptr<ASTPass>(new CallbackPass("lower", lowerProgram)));
+        }
+        return *passes;
+    }
+
+    // Appends a parsed line to the program. With --stream the line is checked
+    // and generated right away instead, so the program list stays empty and
+    // no more than one top-level statement is held as an AST at a time.
+    static std::vector<ASTNode*>* addTopLevel(std::vector<ASTNode*>* program, std::vector<ASTNode*>* line) {
+        if (!line)
+            return program;
+        if (compilerOptions.stream) {
+            MemPhaseScope phase(MemPhase::Sema);
+            topLevelPasses().run(*line);
         }
+        else
+            program->insert(program->end(), line->begin(), line->end());
+        delete line;
+        return program;
+    }
+}
 
-        for (ASTNode* node : *$2) {
-            fprintf(stderr, "Codegen for node type: %s\n", typeid(*node).name());
-            Value* result = node->codegen();
+%start root
+// Statements record the line of their first token for --profile-lines
+%locations
 
-            delete node;
+%%
+
+root:
+    opt_newline { if (compilerOptions.stream) globalSymbolTable->enterScope(); } program opt_newline {
+        fprintf(stderr, "Processing %zu statements\n", $3->size());
+
+        if (!compilerOptions.stream) {
+            globalSymbolTable->enterScope();
+            MemPhaseScope phase(MemPhase::Sema);
+            topLevelPasses().run(*$3);
         }
 
         globalSymbolTable->exitScope();
-        delete $2;
+        delete $3;
 
         addReturnInstr();
         fprintf(stderr, "Added return instruction\n");
+        profileEndFunction(mainFunction);
+        finishDebugInfo();
+
+        if (cache) {
+            if (!cache->finish())
+                fprintf(stderr, "Incremental: cache update failed\n");
+            delete cache;
+            cache = nullptr;
+        }
+
+        if (compilerOptions.moduleMode) {
+            builder.ClearInsertionPoint();
+            mainFunction->eraseFromParent();
+            mainFunction = nullptr;
+        }
+        finishProfile(*module);
+        finishLineProfile(*module);
+        if (!compilerOptions.interfaceFile.empty() && !moduleError) {
+            if (ModuleInterface::write(compilerOptions.interfaceFile, exports))
+                fprintf(stderr, "Wrote interface %s (%zu routines)\n", compilerOptions.interfaceFile.c_str(), exports.size());
+        }
 
         fprintf(stderr, "Module verification passed\n");
         llvm::errs().flush();
     }
 ;
 
+program:
+    statement_line {
+        $$ = addTopLevel(new std::vector<ASTNode*>(), $1);
+    }
+    | program tok_Newline statement_line {
+        $$ = addTopLevel($1, $3);
+    }
+;
+
 statements:
     statement_line {
         fprintf(stderr, "DEBUG: Creating new statement_lines list\n");
@@ -152,7 +306,10 @@ statements:
 statement_line:
    statement {
         $$ = new std::vector<ASTNode*>();
-        if ($1) $$->push_back($1);
+        if ($1) {
+            $1->line = @1.first_line;
+            $$->push_back($1);
+        }
     }
 ;
 
@@ -177,6 +334,9 @@ statement:
     | function_stmt { fprintf(stderr, "DEBUG: Processing function statement\n"); $$ = $1; }
     | declaration { fprintf(stderr, "DEBUG: Processing declaration statement\n"); $$ = $1; }
     | return_stmt { fprintf(stderr, "DEBUG: Processing return statement\n"); $$=$1; }
+    | func_call_stmt { fprintf(stderr, "DEBUG: Processing call statement\n"); $$ = $1; }
+    | import_stmt { fprintf(stderr, "DEBUG: Processing import statement\n"); $$ = $1; }
+    | file_stmt { fprintf(stderr, "DEBUG: Processing file statement\n"); $$ = $1; }
 ;
 
 
@@ -192,40 +352,69 @@ type:
 declaration:
     tok_Declare tok_Identifier ':' type{
 
-        $$ = new DeclarationAST(new IdentifierAST(std::string($2)), $4);
-        free($2);
+        $$ = new DeclarationAST(new IdentifierAST($2.str()), $4);
     }
-    | tok_Declare tok_Identifier ':' tok_Array'[' tok_Integer_Literal ':' tok_Integer_Literal ']' tok_Of type {
-        $$ = new ArrayAST(new IdentifierAST(std::string($2)), $11,$6, $8);
-        free($2);
+    | tok_Declare tok_Identifier ':' tok_Array'[' array_bounds ']' tok_Of type {
+        $$ = new ArrayAST(new IdentifierAST($2.str()), $9, *$6);
+        delete $6;
     }
-    | tok_Declare tok_Identifier ':' tok_Array'[' ':' tok_Integer_Literal ']' tok_Of type {
-        $$ = new ArrayAST(new IdentifierAST(std::string($2)), $10,  0,$7);
-        free($2);
+    | tok_Declare tok_Identifier ':' tok_List tok_Of type {
+        $$ = new ListAST(new IdentifierAST($2.str()), $6);
     }
 ;
 
+/* first, last, first, last, ... of each dimension; a missing first index is 0 */
+array_bounds:
+      expression ':' expression {
+          $$ = new std::vector<ASTNode*>{$1, $3};
+      }
+    | ':' expression {
+          $$ = new std::vector<ASTNode*>{new IntegerLiteralAST(0), $2};
+      }
+    | array_bounds ',' expression ':' expression {
+          $$ = $1;
+          $$->push_back($3);
+          $$->push_back($5);
+      }
+    | array_bounds ',' ':' expression {
+          $$ = $1;
+          $$->push_back(new IntegerLiteralAST(0));
+          $$->push_back($4);
+      }
+;
+
+index_list:
+      expression {
+          $$ = new std::vector<ASTNode*>{$1};
+      }
+    | index_list ',' expression {
+          $$ = $1;
+          $$->push_back($3);
+      }
+;
+
 assignment:
     tok_Identifier '=' expression {
-        $$ = new AssignmentAST(new IdentifierAST(std::string($1)), $3); free($1);
+        $$ = new AssignmentAST(new IdentifierAST($1.str()), $3);
     }
 ;
 
 array_assignment:
-    tok_Identifier '[' expression ']' '=' expression {
-        $$ = new ArrayAssignmentAST(new IdentifierAST(std::string($1)), $6, $3); free($1);
+    tok_Identifier '[' index_list ']' '=' expression {
+        $$ = new ArrayAssignmentAST(new IdentifierAST($1.str()), $6, *$3);
+        delete $3;
     }
 ;
 
 term:
-      tok_Identifier { $$ = new IdentifierAST(std::string($1)); free($1); }
+      tok_Identifier { $$ = new IdentifierAST($1.str()); }
     | tok_Integer_Literal { $$ = new IntegerLiteralAST($1); }
     | tok_Real_Literal { $$ = new RealLiteralAST($1); }
-    | tok_String_Literal { $$ = new StringLiteralAST(std::string($1)); free($1); }
+    | tok_String_Literal { $$ = new StringLiteralAST($1.str()); }
     | tok_Bool_Literal { $$ = new BooleanLiteralAST($1); }
     | tok_Char_Literal { $$ = new CharLiteralAST($1); }
     | tok_Date_Literal { $$ = new DateLiteralAST(std::string($1)); free($1); }
-    | tok_Identifier '[' expression ']' { $$ = new ArrayAccessAST(new IdentifierAST(std::string($1)), $3); free($1);}
+    | tok_Identifier '[' index_list ']' { $$ = new ArrayAccessAST(new IdentifierAST($1.str()), *$3); delete $3; }
 ;
 
 
@@ -236,11 +425,17 @@ output:
         outputs.push_back($2);
         $$ = new OutputAST(outputs);
     }
+    | tok_Output expression ':' expression {
+        // Whole array with the separator written between its elements
+        auto outputAST = new OutputAST({});
+        outputAST->add($2, $4);
+        $$ = outputAST;
+    }
     | output ',' expression {
         // Add expression to existing OutputAST
         auto outputAST = dynamic_cast<OutputAST*>($1);
         if (outputAST) {
-            outputAST->expressions.push_back($3);
+            outputAST->add($3);
             $$ = outputAST;
         } else {
             // Should not happen, but safety fallback
@@ -249,39 +444,52 @@ output:
             $$ = new OutputAST(outputs);
         }
     }
+    | output ',' expression ':' expression {
+        auto outputAST = dynamic_cast<OutputAST*>($1);
+        if (outputAST) {
+            outputAST->add($3, $5);
+            $$ = outputAST;
+        } else {
+            // Should not happen, but safety fallback
+            outputAST = new OutputAST({});
+            outputAST->add($3, $5);
+            $$ = outputAST;
+        }
+    }
 ;
 
 input:
-    tok_Input tok_Identifier { $$ = new InputAST(new IdentifierAST($2)); }
-  | tok_Input tok_Identifier '[' expression ']' { $$ = new InputAST(new ArrayAccessAST(new IdentifierAST($2), $4)); }
+    tok_Input tok_Identifier { $$ = new InputAST(new IdentifierAST($2.str())); }
+  | tok_Input tok_Identifier '[' index_list ']' { $$ = new InputAST(new ArrayAccessAST(new IdentifierAST($2.str()), *$4)); delete $4; }
 ;
 
 
 
 expression:
       term
-    | expression tok_AddOne %prec UMINUS { $$ = new BinaryOpAST($1, nullptr, "++"); }
-    | expression tok_SubOne %prec UMINUS { $$ = new BinaryOpAST($1, nullptr, "--"); }
-    | expression '+' expression { $$ = new BinaryOpAST($1, $3, "+"); }
-    | expression '-' expression { $$ = new BinaryOpAST($1, $3, "-"); }
-    | expression '*' expression { $$ = new BinaryOpAST($1, $3, "*"); }
-    | expression '/' expression { $$ = new BinaryOpAST($1, $3, "/"); }
-    | '-' expression %prec UMINUS { $$ = new UnaryOpAST($2, "-"); }
+    | expression tok_AddOne %prec UMINUS { $$ = new BinaryOpAST($1, nullptr, BinaryOp::Increment); }
+    | expression tok_SubOne %prec UMINUS { $$ = new BinaryOpAST($1, nullptr, BinaryOp::Decrement); }
+    | expression '+' expression { $$ = new BinaryOpAST($1, $3, BinaryOp::Add); }
+    | expression '-' expression { $$ = new BinaryOpAST($1, $3, BinaryOp::Subtract); }
+    | expression '*' expression { $$ = new BinaryOpAST($1, $3, BinaryOp::Multiply); }
+    | expression '/' expression { $$ = new BinaryOpAST($1, $3, BinaryOp::Divide); }
+    | expression '&' expression { $$ = new BinaryOpAST($1, $3, BinaryOp::Concat); }
+    | '-' expression %prec UMINUS { $$ = new UnaryOpAST($2, UnaryOp::Negate); }
     | func_call_stmt { $$ = $1; }
 ;
 
 
 
 comparison:
-      expression '>' expression { $$ = new ComparisonAST( $1, $3, ">"); }
-    | expression '<' expression { $$ = new ComparisonAST( $1, $3,"<"); }
-    | expression tok_EQ expression { $$ = new ComparisonAST( $1, $3, "=="); }
-    | expression tok_LE expression { $$ = new ComparisonAST($1, $3,"<="); }
-    | expression tok_GE expression { $$ = new ComparisonAST($1, $3,">="); }
-    | expression tok_NEQ expression { $$ = new ComparisonAST( $1, $3,"!="); }
-    | comparison tok_And comparison { $$ = new LogicalOpAST($1, $3, "AND"); }
-    | comparison tok_Or comparison { $$ = new LogicalOpAST($1, $3, "OR"); }
-    |  tok_Not comparison { $$ = new LogicalOpAST(nullptr, $2, "NOT"); }
+      expression '>' expression { $$ = new ComparisonAST($1, $3, CompareOp::Greater); }
+    | expression '<' expression { $$ = new ComparisonAST($1, $3, CompareOp::Less); }
+    | expression tok_EQ expression { $$ = new ComparisonAST($1, $3, CompareOp::Equal); }
+    | expression tok_LE expression { $$ = new ComparisonAST($1, $3, CompareOp::LessEqual); }
+    | expression tok_GE expression { $$ = new ComparisonAST($1, $3, CompareOp::GreaterEqual); }
+    | expression tok_NEQ expression { $$ = new ComparisonAST($1, $3, CompareOp::NotEqual); }
+    | comparison tok_And comparison { $$ = new LogicalOpAST($1, $3, LogicalOp::And); }
+    | comparison tok_Or comparison { $$ = new LogicalOpAST($1, $3, LogicalOp::Or); }
+    |  tok_Not comparison { $$ = new LogicalOpAST(nullptr, $2, LogicalOp::Not); }
 ;
 
 statement_block: 
@@ -309,7 +517,7 @@ if_stmt:
 
 for_stmt:
     tok_For assignment tok_To expression opt_step statement_block tok_Next tok_Identifier {
-        if (strcmp($8, $2->identifier->name.c_str()) != 0) {
+        if (!$8.equals($2->identifier->name)) {
             yyerror("Loop variable mismatch");
             YYERROR;
         }
@@ -317,16 +525,15 @@ for_stmt:
         auto loopVar = $2->identifier;
         auto startLit = dynamic_cast<IntegerLiteralAST*>($2->expression);
         auto endLit = dynamic_cast<IntegerLiteralAST*>($4);
-        auto cond = new ComparisonAST(loopVar, $4,(startLit && endLit && startLit->value > endLit->value) ? ">=" : "<=");
+        auto cond = new ComparisonAST(loopVar, $4,(startLit && endLit && startLit->value > endLit->value) ? CompareOp::GreaterEqual : CompareOp::LessEqual);
 
         // Determine step size
         auto step = $5 ? new IntegerLiteralAST($5) : new IntegerLiteralAST(1);
 
-        auto binaryOp = new BinaryOpAST(loopVar, step, "+");
+        auto binaryOp = new BinaryOpAST(loopVar, step, BinaryOp::Add);
         auto incrementAssign = new AssignmentAST(loopVar, binaryOp);
 
         $$ = new ForAST($2, cond, incrementAssign, $6);
-        free($8);
     }
 ;
 
@@ -357,11 +564,11 @@ repeat_stmt:
 parameter_list:
        tok_Identifier ':' type {
           $$ = new std::vector<ParameterAST *>();
-          $$->push_back(new ParameterAST($3, std::string($1)));
+          $$->push_back(new ParameterAST($3, $1.str()));
       }
     | parameter_list ',' tok_Identifier ':' type {
           $$ = $1;
-          $$->push_back(new ParameterAST($5, std::string($3)));
+          $$->push_back(new ParameterAST($5, $3.str()));
       }
     | /* empty */ {
           $$ = new std::vector<ParameterAST *>();
@@ -370,16 +577,14 @@ parameter_list:
 
 procedure_stmt:
     tok_Procedure tok_Identifier '(' parameter_list ')' statement_block tok_End_Procedure {
-        $$ = new ProcedureAST(new IdentifierAST($2), *$4, $6);
-        free($2);
+        $$ = new ProcedureAST(new IdentifierAST($2.str()), *$4, $6);
     }
 ;
 
 function_stmt:
    tok_Function tok_Identifier '(' parameter_list ')' tok_Returns type statement_block tok_End_Function 
     { 
-        $$ = new FuncAST(new IdentifierAST($2), *$4, $8, $7);
-        free($2);
+        $$ = new FuncAST(new IdentifierAST($2.str()), *$4, $8, $7);
     }
 ;
 
@@ -402,35 +607,109 @@ argument_list:
       }
 ;
 
+import_stmt:
+    tok_Import tok_Identifier {
+        $$ = new ImportAST($2.str());
+    }
+;
+
+file_stmt:
+    tok_Open_File expression tok_For tok_Identifier {
+        FileMode mode;
+        if ($4.equals("READ"))
+            mode = FileMode::Read;
+        else if ($4.equals("WRITE"))
+            mode = FileMode::Write;
+        else if ($4.equals("APPEND"))
+            mode = FileMode::Append;
+        else {
+            yyerror("OPENFILE expects FOR READ, WRITE or APPEND");
+            YYERROR;
+        }
+        $$ = new FileAST(FileOp::Open, $2, nullptr, mode);
+    }
+    | tok_Read_File expression ',' tok_Identifier { $$ = new FileAST(FileOp::Read, $2, new IdentifierAST($4.str())); }
+    | tok_Read_File expression ',' tok_Identifier '[' index_list ']' {
+        $$ = new FileAST(FileOp::Read, $2, new ArrayAccessAST(new IdentifierAST($4.str()), *$6));
+        delete $6;
+    }
+    | tok_Write_File expression ',' expression { $$ = new FileAST(FileOp::Write, $2, $4); }
+    | tok_Close_File expression { $$ = new FileAST(FileOp::Close, $2); }
+;
+
 func_call_stmt:
     tok_Call tok_Identifier '(' argument_list ')' {
-        $$ = new FuncCallAST(std::string($2), *$4); 
+        $$ = new FuncCallAST($2.str(), *$4); 
+    }
+    | tok_Identifier '(' argument_list ')' {
+        // Built-ins and functions can be called without CALL, e.g. total = SUM(A)
+        $$ = new FuncCallAST($1.str(), *$3);
     }
 ;
 
 %%
 
 int main(int argc, char** argv) {
-    if (argc > 1) {
-    FILE *fp = fopen(argv[1], "r");
-    if (fp == NULL) {
-        fprintf(stderr, "Error opening file: %s\n", argv[1]);
+    if (!parseCommandLine(argc, argv))
         return EXIT_FAILURE;
-    }
-    yyin = fp;
-        fprintf(stderr, "Opened input file: %s\n", argv[1]);
-    } 
-    if (yyin == NULL) {
-        yyin = stdin;
+    if (compilerOptions.memReport)
+        enableMemReport(compilerOptions.memReportJSON);
+
+    if (!compilerOptions.profileUse.empty() && !loadProfiles(compilerOptions.profileUse))
+        return EXIT_FAILURE;
+
+    // The whole source is mapped (or read) once and scanned in place
+    if (!openSourceInput(compilerOptions.inputFile))
+        return EXIT_FAILURE;
+    if (compilerOptions.inputFile)
+        fprintf(stderr, "Opened input file: %s\n", compilerOptions.inputFile);
+    else
         fprintf(stderr, "Using stdin as input\n");
-    }
+
+    if (compilerOptions.lexBench)
+        return runLexerBenchmark();
 
     initLLVM();
+    initDebugInfo();
     fprintf(stderr, "LLVM initialized\n");
     
+    setMemPhase(MemPhase::Parse);
     int parserResult = yyparse();
     fprintf(stderr, "Parser result: %d\n", parserResult);
+    if (moduleError)
+        return EXIT_FAILURE;
+    if (compilerOptions.astStats)
+        printASTStats();
+    if (compilerOptions.timePasses)
+        topLevelPasses().printTimes();
+
+    if (bytecode) {
+        setMemPhase(MemPhase::Run);
+        if (compilerOptions.dumpBytecode)
+            dumpBytecode(*bytecode);
+        return runBytecode(*bytecode, tiering, compilerOptions.tierThreshold);
+    }
+
+    setMemPhase(MemPhase::Optimize);
+    // The runtime goes in before optimization so its I/O paths can inline into user code
+    if (compilerOptions.linkRuntime && !linkRuntime(*module))
+        return EXIT_FAILURE;
+    if (!applyTarget(*module))
+        return EXIT_FAILURE;
+    if (compilerOptions.multiversion)
+        multiversionModule(*module);
+    // The JIT optimizes each function when it is first called
+    if (compilerOptions.jit || compilerOptions.interp) {
+        setMemPhase(MemPhase::Run);
+        return runLazyJIT(*module);
+    }
+    optimizeModule(*module);
 
+    setMemPhase(MemPhase::Emit);
+    if (!compilerOptions.outputFile.empty())
+        return linkExecutable(*module, compilerOptions.outputFile) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (!compilerOptions.objectPrefix.empty())
+        return emitObjects(*module, compilerOptions.objectPrefix, compilerOptions.jobs) ? EXIT_SUCCESS : EXIT_FAILURE;
     printLLVMIR();
     fprintf(stderr, "LLVM IR printed\n");
     
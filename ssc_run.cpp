@@ -0,0 +1,550 @@
+// ssc-run: runs a compiled SSC program against a directory of test cases.
+//
+// Every NAME.in in the case directory is fed to the program on stdin and its
+// stdout is compared with NAME.out. Cases run in parallel, each in a child
+// with CPU, address space and output limits, and the results (status, CPU
+// time, peak RSS, first differing line) are written to stdout as JSON.
+//
+//   ssc-run [-j N] [--cpu=SECONDS] [--memory=MB] [--output=KB] [--wall=SECONDS] PROGRAM CASE_DIR
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct RunnerOptions
+{
+    const char *program = nullptr;
+    const char *caseDir = nullptr;
+    unsigned jobs = 0;            // 0: one per core
+    double cpuSeconds = 2.0;      // RLIMIT_CPU
+    size_t memoryMB = 512;        // RLIMIT_AS
+    size_t outputKB = 4096;       // stdout beyond this kills the case
+    double wallSeconds = 0;       // 0: three times the CPU limit
+};
+
+struct TestCase
+{
+    std::string name;
+    std::string inputPath;
+    std::string expectedPath;
+};
+
+enum class CaseStatus
+{
+    Pass,
+    Fail,
+    RuntimeError,
+    TimeLimit,
+    OutputLimit,
+    InternalError
+};
+
+struct CaseResult
+{
+    CaseStatus status = CaseStatus::InternalError;
+    int exitCode = 0;
+    int signal = 0;
+    double cpuMs = 0;
+    double wallMs = 0;
+    long maxRssKB = 0;
+    size_t outputBytes = 0;
+    // First line that differs from the expected output, 1-based; 0 when equal
+    size_t diffLine = 0;
+    std::string expectedLine;
+    std::string actualLine;
+    std::string error;
+};
+
+static const char *statusName(CaseStatus status)
+{
+    switch (status)
+    {
+    case CaseStatus::Pass:
+        return "pass";
+    case CaseStatus::Fail:
+        return "fail";
+    case CaseStatus::RuntimeError:
+        return "runtime_error";
+    case CaseStatus::TimeLimit:
+        return "time_limit";
+    case CaseStatus::OutputLimit:
+        return "output_limit";
+    case CaseStatus::InternalError:
+        return "internal_error";
+    }
+    return "internal_error";
+}
+
+// ─────────────────────────────────────────────
+// Case discovery and comparison
+
+static bool readFile(const std::string &path, std::string &contents)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    contents.clear();
+    char buffer[64 * 1024];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        contents.append(buffer, n);
+    close(fd);
+    return n == 0;
+}
+
+static bool endsWith(const std::string &s, const char *suffix)
+{
+    size_t len = strlen(suffix);
+    return s.size() >= len && s.compare(s.size() - len, len, suffix) == 0;
+}
+
+// Every NAME.in that has a NAME.out next to it, sorted by name
+static bool findCases(const char *dir, std::vector<TestCase> &cases)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        fprintf(stderr, "ssc-run: cannot open case directory %s: %s\n", dir, strerror(errno));
+        return false;
+    }
+    while (struct dirent *entry = readdir(d))
+    {
+        std::string file = entry->d_name;
+        if (!endsWith(file, ".in"))
+            continue;
+        TestCase testCase;
+        testCase.name = file.substr(0, file.size() - 3);
+        testCase.inputPath = std::string(dir) + "/" + file;
+        testCase.expectedPath = std::string(dir) + "/" + testCase.name + ".out";
+        if (access(testCase.expectedPath.c_str(), R_OK) != 0)
+        {
+            fprintf(stderr, "ssc-run: skipping %s, no %s.out\n", file.c_str(), testCase.name.c_str());
+            continue;
+        }
+        cases.push_back(testCase);
+    }
+    closedir(d);
+    std::sort(cases.begin(), cases.end(), [](const TestCase &a, const TestCase &b)
+              { return a.name < b.name; });
+    return true;
+}
+
+// Splits into lines without trailing whitespace and drops trailing empty lines,
+// so a missing final newline or trailing spaces do not fail a case
+static std::vector<std::string> normalizedLines(const std::string &text)
+{
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos)
+            end = text.size();
+        size_t last = end;
+        while (last > start && isspace((unsigned char)text[last - 1]))
+            last--;
+        lines.push_back(text.substr(start, last - start));
+        start = end + 1;
+    }
+    while (!lines.empty() && lines.back().empty())
+        lines.pop_back();
+    return lines;
+}
+
+static void compareOutput(const std::string &expected, const std::string &actual, CaseResult &result)
+{
+    std::vector<std::string> want = normalizedLines(expected);
+    std::vector<std::string> got = normalizedLines(actual);
+    size_t lines = std::max(want.size(), got.size());
+    for (size_t i = 0; i < lines; i++)
+    {
+        const std::string *w = i < want.size() ? &want[i] : nullptr;
+        const std::string *g = i < got.size() ? &got[i] : nullptr;
+        if (w && g && *w == *g)
+            continue;
+        result.status = CaseStatus::Fail;
+        result.diffLine = i + 1;
+        result.expectedLine = w ? *w : "<end of output>";
+        result.actualLine = g ? *g : "<end of output>";
+        return;
+    }
+    result.status = CaseStatus::Pass;
+}
+
+// ─────────────────────────────────────────────
+// Running one case
+
+static double toMs(const struct timeval &tv)
+{
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// Runs in the child between fork and exec: only async-signal-safe calls
+static void execCase(const RunnerOptions &options, int inputFd, int outputFd, int nullFd)
+{
+    if (dup2(inputFd, STDIN_FILENO) < 0 || dup2(outputFd, STDOUT_FILENO) < 0 || dup2(nullFd, STDERR_FILENO) < 0)
+        _exit(127);
+
+    struct rlimit limit;
+    rlim_t cpu = (rlim_t)(options.cpuSeconds + 0.999);
+    limit.rlim_cur = cpu;
+    limit.rlim_max = cpu + 1; // SIGXCPU at the soft limit, SIGKILL a second later
+    setrlimit(RLIMIT_CPU, &limit);
+    limit.rlim_cur = limit.rlim_max = (rlim_t)options.memoryMB * 1024 * 1024;
+    setrlimit(RLIMIT_AS, &limit);
+    limit.rlim_cur = limit.rlim_max = (rlim_t)options.outputKB * 1024;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    limit.rlim_cur = limit.rlim_max = 0;
+    setrlimit(RLIMIT_CORE, &limit);
+
+    char *const argv[] = {const_cast<char *>(options.program), nullptr};
+    execv(options.program, argv);
+    _exit(127);
+}
+
+static void runCase(const RunnerOptions &options, const TestCase &testCase, CaseResult &result)
+{
+    std::string expected;
+    if (!readFile(testCase.expectedPath, expected))
+    {
+        result.error = "cannot read " + testCase.expectedPath;
+        return;
+    }
+    int inputFd = open(testCase.inputPath.c_str(), O_RDONLY | O_CLOEXEC);
+    int nullFd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    int pipeFds[2];
+    if (inputFd < 0 || nullFd < 0 || pipe2(pipeFds, O_CLOEXEC) != 0)
+    {
+        result.error = std::string("cannot set up case: ") + strerror(errno);
+        if (inputFd >= 0)
+            close(inputFd);
+        if (nullFd >= 0)
+            close(nullFd);
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0)
+        execCase(options, inputFd, pipeFds[1], nullFd);
+    close(inputFd);
+    close(nullFd);
+    close(pipeFds[1]);
+    if (pid < 0)
+    {
+        result.error = std::string("fork failed: ") + strerror(errno);
+        close(pipeFds[0]);
+        return;
+    }
+
+    // Collect stdout until EOF, the output limit or the wall-clock deadline
+    double wallSeconds = options.wallSeconds > 0 ? options.wallSeconds : options.cpuSeconds * 3;
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>(wallSeconds));
+    size_t outputLimit = options.outputKB * 1024;
+    std::string output;
+    bool killedForOutput = false;
+    bool killedForTime = false;
+    char buffer[64 * 1024];
+    for (;;)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0)
+        {
+            killedForTime = true;
+            break;
+        }
+        struct pollfd pfd = {pipeFds[0], POLLIN, 0};
+        int ready = poll(&pfd, 1, (int)remaining.count());
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            continue;
+        ssize_t n = read(pipeFds[0], buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        if (output.size() + n > outputLimit)
+        {
+            killedForOutput = true;
+            break;
+        }
+        output.append(buffer, n);
+    }
+    if (killedForTime || killedForOutput)
+        kill(pid, SIGKILL);
+    close(pipeFds[0]);
+
+    // The program may still be running after closing stdout
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    for (;;)
+    {
+        pid_t done = wait4(pid, &status, killedForTime || killedForOutput ? 0 : WNOHANG, &usage);
+        if (done == pid)
+            break;
+        if (done < 0 && errno != EINTR)
+        {
+            result.error = std::string("wait4 failed: ") + strerror(errno);
+            return;
+        }
+        if (done == 0)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                killedForTime = true;
+                kill(pid, SIGKILL);
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    result.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.cpuMs = toMs(usage.ru_utime) + toMs(usage.ru_stime);
+    result.maxRssKB = usage.ru_maxrss;
+    result.outputBytes = output.size();
+
+    if (WIFSIGNALED(status))
+        result.signal = WTERMSIG(status);
+    else if (WIFEXITED(status))
+        result.exitCode = WEXITSTATUS(status);
+
+    if (killedForOutput || result.signal == SIGXFSZ)
+        result.status = CaseStatus::OutputLimit;
+    else if (killedForTime || result.signal == SIGXCPU || (result.signal == SIGKILL && result.cpuMs >= options.cpuSeconds * 1000))
+        result.status = CaseStatus::TimeLimit;
+    else if (result.exitCode == 127 && output.empty())
+        result.error = std::string("cannot execute ") + options.program;
+    else if (result.signal != 0 || result.exitCode != 0)
+        // Running out of address space shows up here too, usually as SIGSEGV or SIGABRT
+        result.status = CaseStatus::RuntimeError;
+    else
+        compareOutput(expected, output, result);
+}
+
+// ─────────────────────────────────────────────
+// JSON report
+
+static void writeJsonString(FILE *out, const std::string &s)
+{
+    fputc('"', out);
+    for (unsigned char c : s)
+    {
+        switch (c)
+        {
+        case '"':
+            fputs("\\\"", out);
+            break;
+        case '\\':
+            fputs("\\\\", out);
+            break;
+        case '\n':
+            fputs("\\n", out);
+            break;
+        case '\t':
+            fputs("\\t", out);
+            break;
+        case '\r':
+            fputs("\\r", out);
+            break;
+        default:
+            if (c < 0x20)
+                fprintf(out, "\\u%04x", c);
+            else
+                fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void writeReport(FILE *out, const RunnerOptions &options, const std::vector<TestCase> &cases,
+                        const std::vector<CaseResult> &results, double wallMs)
+{
+    size_t passed = 0;
+    for (const CaseResult &result : results)
+        passed += result.status == CaseStatus::Pass;
+
+    fprintf(out, "{\n  \"program\": ");
+    writeJsonString(out, options.program);
+    fprintf(out, ",\n  \"total\": %zu,\n  \"passed\": %zu,\n  \"failed\": %zu,\n  \"wall_ms\": %.1f,\n  \"cases\": [",
+            cases.size(), passed, cases.size() - passed, wallMs);
+    for (size_t i = 0; i < cases.size(); i++)
+    {
+        const CaseResult &result = results[i];
+        fprintf(out, "%s\n    {\"name\": ", i ? "," : "");
+        writeJsonString(out, cases[i].name);
+        fprintf(out, ", \"status\": \"%s\", \"exit_code\": %d, \"signal\": %d, \"cpu_ms\": %.2f, \"wall_ms\": %.2f, \"max_rss_kb\": %ld, \"output_bytes\": %zu",
+                statusName(result.status), result.exitCode, result.signal, result.cpuMs, result.wallMs, result.maxRssKB, result.outputBytes);
+        if (result.diffLine)
+        {
+            fprintf(out, ", \"diff\": {\"line\": %zu, \"expected\": ", result.diffLine);
+            writeJsonString(out, result.expectedLine);
+            fprintf(out, ", \"actual\": ");
+            writeJsonString(out, result.actualLine);
+            fprintf(out, "}");
+        }
+        if (!result.error.empty())
+        {
+            fprintf(out, ", \"error\": ");
+            writeJsonString(out, result.error);
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+// ─────────────────────────────────────────────
+// Command line
+
+static void printUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [options] PROGRAM CASE_DIR\n", program);
+    fprintf(stderr, "Runs PROGRAM on every CASE_DIR/NAME.in and compares its stdout with NAME.out.\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -j N                Run N cases at a time (default: number of cores)\n");
+    fprintf(stderr, "  --cpu=SECONDS       CPU time limit per case (default 2)\n");
+    fprintf(stderr, "  --memory=MB         Address space limit per case (default 512)\n");
+    fprintf(stderr, "  --output=KB         Output size limit per case (default 4096)\n");
+    fprintf(stderr, "  --wall=SECONDS      Wall-clock limit per case (default 3x the CPU limit)\n");
+    fprintf(stderr, "  --help              Display this help message\n");
+}
+
+// Matches "--name=value" and returns the value part
+static const char *optionValue(const char *arg, const char *name)
+{
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) == 0 && arg[len] == '=')
+        return arg + len + 1;
+    return nullptr;
+}
+
+static bool parsePositive(const char *text, double &value)
+{
+    char *end;
+    value = strtod(text, &end);
+    return end != text && *end == '\0' && value > 0;
+}
+
+static bool parseCommandLine(int argc, char **argv, RunnerOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = nullptr;
+        double number = 0;
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            printUsage(argv[0]);
+            return false;
+        }
+        else if (strncmp(arg, "-j", 2) == 0)
+        {
+            const char *count = arg[2] ? arg + 2 : (i + 1 < argc ? argv[++i] : "");
+            if (!parsePositive(count, number))
+            {
+                fprintf(stderr, "Bad job count: %s\n", count);
+                return false;
+            }
+            options.jobs = (unsigned)number;
+        }
+        else if ((value = optionValue(arg, "--cpu")) || (value = optionValue(arg, "--memory")) ||
+                 (value = optionValue(arg, "--output")) || (value = optionValue(arg, "--wall")))
+        {
+            if (!parsePositive(value, number))
+            {
+                fprintf(stderr, "Bad value in %s\n", arg);
+                return false;
+            }
+            if (strncmp(arg, "--cpu", 5) == 0)
+                options.cpuSeconds = number;
+            else if (strncmp(arg, "--memory", 8) == 0)
+                options.memoryMB = (size_t)number;
+            else if (strncmp(arg, "--output", 8) == 0)
+                options.outputKB = (size_t)number;
+            else
+                options.wallSeconds = number;
+        }
+        else if (arg[0] == '-' && arg[1] != '\0')
+        {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            printUsage(argv[0]);
+            return false;
+        }
+        else if (!options.program)
+            options.program = arg;
+        else if (!options.caseDir)
+            options.caseDir = arg;
+        else
+        {
+            fprintf(stderr, "Unexpected argument: %s\n", arg);
+            return false;
+        }
+    }
+    if (!options.program || !options.caseDir)
+    {
+        printUsage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    RunnerOptions options;
+    if (!parseCommandLine(argc, argv, options))
+        return 2;
+    if (access(options.program, X_OK) != 0)
+    {
+        fprintf(stderr, "ssc-run: %s is not executable\n", options.program);
+        return 2;
+    }
+
+    std::vector<TestCase> cases;
+    if (!findCases(options.caseDir, cases))
+        return 2;
+
+    // A worker per core; each pulls the next case until none are left
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min<unsigned>(jobs, std::max<size_t>(cases.size(), 1));
+    std::vector<CaseResult> results(cases.size());
+    std::atomic<size_t> next(0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (unsigned j = 0; j < jobs; j++)
+        workers.emplace_back([&]()
+                             {
+                                 for (size_t i; (i = next.fetch_add(1)) < cases.size();)
+                                     runCase(options, cases[i], results[i]); });
+    for (std::thread &worker : workers)
+        worker.join();
+
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    writeReport(stdout, options, cases, results, wallMs);
+
+    for (const CaseResult &result : results)
+        if (result.status != CaseStatus::Pass)
+            return 1;
+    return 0;
+}
@@ -0,0 +1,1887 @@
+/*
+ * SSC runtime library.
+ *
+ * Compiled to LLVM bitcode, embedded in ssc_compiler and linked into every
+ * program before optimization (see Runtime.cpp), so these routines can be
+ * inlined into user code and unused ones are stripped. Everything the
+ * generated code calls is prefixed ssc_.
+ *
+ * Shared state is weak so that a program and the modules it imports, each
+ * carrying an internalized copy of the runtime, still use one stdout
+ * buffer and one stdin buffer.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+
+#define SSC_WEAK __attribute__((weak))
+#define SSC_IO_BUFFER_SIZE (64 * 1024)
+
+struct ssc_io
+{
+    char out[SSC_IO_BUFFER_SIZE];
+    size_t outLen;
+    char in[SSC_IO_BUFFER_SIZE];
+    size_t inPos;
+    size_t inLen;
+    int inEof;
+    uint64_t randState;
+};
+
+SSC_WEAK struct ssc_io ssc_io_state;
+
+/* ─────────────────────────────────────────── */
+/* Output: everything goes through one buffer and leaves in large write()s */
+
+void ssc_flush(void)
+{
+    struct ssc_io *io = &ssc_io_state;
+    size_t done = 0;
+    while (done < io->outLen)
+    {
+        ssize_t n = write(1, io->out + done, io->outLen - done);
+        if (n <= 0)
+            break;
+        done += (size_t)n;
+    }
+    io->outLen = 0;
+}
+
+static void ssc_flush_at_exit(void) __attribute__((destructor));
+static void ssc_flush_at_exit(void)
+{
+    ssc_flush();
+}
+
+static inline char *ssc_out_reserve(size_t n)
+{
+    struct ssc_io *io = &ssc_io_state;
+    if (io->outLen + n > SSC_IO_BUFFER_SIZE)
+        ssc_flush();
+    return io->out + io->outLen;
+}
+
+void ssc_output_bytes(const char *s, size_t n)
+{
+    struct ssc_io *io = &ssc_io_state;
+    if (n > SSC_IO_BUFFER_SIZE / 2)
+    {
+        ssc_flush();
+        ssize_t w;
+        while (n > 0 && (w = write(1, s, n)) > 0)
+        {
+            s += w;
+            n -= (size_t)w;
+        }
+        return;
+    }
+    memcpy(ssc_out_reserve(n), s, n);
+    io->outLen += n;
+}
+
+/* Writes value in decimal to dst, which has room for 11 bytes; returns the length */
+static inline size_t ssc_format_int(char *dst, int32_t value)
+{
+    char digits[12];
+    int pos = sizeof(digits);
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    do
+    {
+        digits[--pos] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0)
+        digits[--pos] = '-';
+    memcpy(dst, digits + pos, sizeof(digits) - pos);
+    return sizeof(digits) - pos;
+}
+
+void ssc_output_int(int32_t value)
+{
+    char *dst = ssc_out_reserve(11);
+    ssc_io_state.outLen += ssc_format_int(dst, value);
+}
+
+void ssc_output_real(double value)
+{
+    /* Same text as printf("%f") */
+    char *dst = ssc_out_reserve(64);
+    int n = snprintf(dst, 64, "%f", value);
+    if (n >= 64)
+    {
+        char big[400];
+        n = snprintf(big, sizeof(big), "%f", value);
+        ssc_output_bytes(big, (size_t)n);
+        return;
+    }
+    ssc_io_state.outLen += (size_t)n;
+}
+
+/* CHAR and BOOLEAN arrive widened to int so no extension attributes are needed */
+void ssc_output_char(int32_t c)
+{
+    *ssc_out_reserve(1) = (char)c;
+    ssc_io_state.outLen++;
+}
+
+void ssc_output_bool(int32_t value)
+{
+    if (value)
+        ssc_output_bytes("TRUE", 4);
+    else
+        ssc_output_bytes("FALSE", 5);
+}
+
+/* ─────────────────────────────────────────── */
+/* Input: one read() per 64KB; like scanf, a failed read leaves the target unchanged */
+
+static int ssc_in_fill(void)
+{
+    struct ssc_io *io = &ssc_io_state;
+    if (io->inEof)
+        return 0;
+    /* Prompts written so far must be visible before we block */
+    ssc_flush();
+    ssize_t n = read(0, io->in, SSC_IO_BUFFER_SIZE);
+    if (n <= 0)
+    {
+        io->inEof = 1;
+        return 0;
+    }
+    io->inPos = 0;
+    io->inLen = (size_t)n;
+    return 1;
+}
+
+static inline int ssc_in_peek(void)
+{
+    struct ssc_io *io = &ssc_io_state;
+    if (io->inPos == io->inLen && !ssc_in_fill())
+        return -1;
+    return (unsigned char)io->in[io->inPos];
+}
+
+/* Whitespace scanning kernel, with the string routines below */
+static size_t ssc_scan_space(const char *p, size_t n, int space);
+
+static inline void ssc_in_skip_space(void)
+{
+    struct ssc_io *io = &ssc_io_state;
+    while (io->inPos < io->inLen || ssc_in_fill())
+    {
+        io->inPos += ssc_scan_space(io->in + io->inPos, io->inLen - io->inPos, 0);
+        if (io->inPos < io->inLen)
+            return;
+    }
+}
+
+/* Copies the next whitespace-delimited word into buf, returns its length */
+static size_t ssc_in_word(char *buf, size_t cap)
+{
+    struct ssc_io *io = &ssc_io_state;
+    size_t n = 0;
+    ssc_in_skip_space();
+    while (io->inPos < io->inLen || ssc_in_fill())
+    {
+        const char *start = io->in + io->inPos;
+        size_t len = ssc_scan_space(start, io->inLen - io->inPos, 1);
+        size_t copy = len < cap - 1 - n ? len : cap - 1 - n;
+        memcpy(buf + n, start, copy);
+        n += copy;
+        io->inPos += len;
+        if (io->inPos < io->inLen)
+            break;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+void ssc_input_int(int32_t *target)
+{
+    ssc_in_skip_space();
+    int c = ssc_in_peek();
+    int negative = 0;
+    if (c == '-' || c == '+')
+    {
+        negative = c == '-';
+        ssc_io_state.inPos++;
+        c = ssc_in_peek();
+    }
+    if (c < '0' || c > '9')
+        return;
+    uint32_t value = 0;
+    while ((c = ssc_in_peek()) >= '0' && c <= '9')
+    {
+        value = value * 10 + (uint32_t)(c - '0');
+        ssc_io_state.inPos++;
+    }
+    *target = negative ? (int32_t)(0u - value) : (int32_t)value;
+}
+
+void ssc_input_real(double *target)
+{
+    char word[128];
+    if (ssc_in_word(word, sizeof(word)) == 0)
+        return;
+    char *end;
+    double value = strtod(word, &end);
+    if (end != word)
+        *target = value;
+}
+
+void ssc_input_char(char *target)
+{
+    ssc_in_skip_space();
+    int c = ssc_in_peek();
+    if (c == -1)
+        return;
+    ssc_io_state.inPos++;
+    *target = (char)c;
+}
+
+/* ─────────────────────────────────────────── */
+/* Built-in functions (INT, MOD, DIV, RAND, SQRT) */
+
+int32_t ssc_int(double x)
+{
+    /* Integer part, truncating towards zero */
+    return (int32_t)x;
+}
+
+/* Like the interpreter, MOD and DIV by zero stop the program */
+static void ssc_division_by_zero(const char *op)
+{
+    ssc_flush();
+    fprintf(stderr, "Runtime error: %s by zero\n", op);
+    exit(1);
+}
+
+int32_t ssc_mod(int32_t a, int32_t b)
+{
+    if (b == 0)
+        ssc_division_by_zero("MOD");
+    return a % b;
+}
+
+int32_t ssc_div(int32_t a, int32_t b)
+{
+    if (b == 0)
+        ssc_division_by_zero("DIV");
+    return a / b;
+}
+
+double ssc_rand(int32_t limit)
+{
+    struct ssc_io *io = &ssc_io_state;
+    if (io->randState == 0)
+        io->randState = 0x9E3779B97F4A7C15ull ^ (uint64_t)getpid();
+    /* xorshift64* */
+    uint64_t x = io->randState;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    io->randState = x;
+    double unit = (double)((x * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+    return unit * limit;
+}
+
+double ssc_sqrt(double x)
+{
+    return sqrt(x);
+}
+
+/* ─────────────────────────────────────────── */
+/* Array built-ins (SUM, MINIMUM, MAXIMUM, FILL, SORT, LINEARSEARCH, BINARYSEARCH)
+ *
+ * The compiler passes a pointer to the first element and the exact length
+ * from the array's declared bounds. Searches return a 0-based position or
+ * -1; the compiler shifts it into the array's index range. On x86 the hot
+ * loops have AVX2 versions chosen at run time; the portable loops are what
+ * other CPUs run, and the compiler vectorizes them for the SSE2 baseline. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SSC_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#define SSC_AVX2 __attribute__((target("avx2")))
+#endif
+
+/* The x86 level of the CPU: 0 for the SSE2 baseline, 1 with SSE4.2, 2 with
+ * AVX2 and 3 with AVX-512 F, BW and VL; 0 on other CPUs. The dispatchers
+ * of --multiversion call it on every call, so it is worked out once. */
+int32_t ssc_cpu_level(void)
+{
+    static int32_t cached = -1;
+    if (cached >= 0)
+        return cached;
+    cached = 0;
+#ifdef SSC_X86
+    unsigned a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSE4_2))
+        return cached;
+    cached = 1;
+    /* The OS must also save the YMM registers (XCR0 bits 1 and 2) */
+    if (!(c & bit_OSXSAVE) || !(c & bit_AVX))
+        return cached;
+    unsigned lo, hi;
+    __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    if ((lo & 6) != 6 || !__get_cpuid_count(7, 0, &a, &b, &c, &d) || !(b & bit_AVX2))
+        return cached;
+    cached = 2;
+    /* and, for AVX-512, the opmask and ZMM registers (bits 5 to 7) */
+    if ((lo & 0xe0) == 0xe0 && (b & bit_AVX512F) && (b & bit_AVX512BW) && (b & bit_AVX512VL))
+        cached = 3;
+#endif
+    return cached;
+}
+
+#ifdef SSC_X86
+static int ssc_has_avx2(void)
+{
+    return ssc_cpu_level() >= 2;
+}
+
+SSC_AVX2 static int32_t ssc_sum_int_avx2(const int32_t *a, int32_t n)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_add_epi32(acc, _mm256_loadu_si256((const __m256i *)(a + i)));
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    uint32_t sum = (uint32_t)_mm_cvtsi128_si32(half);
+    for (; i < n; i++)
+        sum += (uint32_t)a[i];
+    return (int32_t)sum;
+}
+
+SSC_AVX2 static double ssc_sum_real_avx2(const double *a, int32_t n)
+{
+    __m256d acc = _mm256_setzero_pd();
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm256_add_pd(acc, _mm256_loadu_pd(a + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++)
+        sum += a[i];
+    return sum;
+}
+
+/* Both require n >= 1 */
+SSC_AVX2 static int32_t ssc_minmax_int_avx2(const int32_t *a, int32_t n, int wantMax)
+{
+    int32_t result = a[0];
+    int32_t i = 0;
+    if (n >= 8)
+    {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)a);
+        for (i = 8; i + 8 <= n; i += 8)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+            acc = wantMax ? _mm256_max_epi32(acc, v) : _mm256_min_epi32(acc, v);
+        }
+        int32_t lanes[8];
+        _mm256_storeu_si256((__m256i *)lanes, acc);
+        for (int l = 0; l < 8; l++)
+            result = wantMax ? (lanes[l] > result ? lanes[l] : result) : (lanes[l] < result ? lanes[l] : result);
+    }
+    for (; i < n; i++)
+        result = wantMax ? (a[i] > result ? a[i] : result) : (a[i] < result ? a[i] : result);
+    return result;
+}
+
+SSC_AVX2 static double ssc_minmax_real_avx2(const double *a, int32_t n, int wantMax)
+{
+    double result = a[0];
+    int32_t i = 0;
+    if (n >= 4)
+    {
+        __m256d acc = _mm256_loadu_pd(a);
+        for (i = 4; i + 4 <= n; i += 4)
+        {
+            __m256d v = _mm256_loadu_pd(a + i);
+            acc = wantMax ? _mm256_max_pd(acc, v) : _mm256_min_pd(acc, v);
+        }
+        double lanes[4];
+        _mm256_storeu_pd(lanes, acc);
+        for (int l = 0; l < 4; l++)
+            result = wantMax ? (lanes[l] > result ? lanes[l] : result) : (lanes[l] < result ? lanes[l] : result);
+    }
+    for (; i < n; i++)
+        result = wantMax ? (a[i] > result ? a[i] : result) : (a[i] < result ? a[i] : result);
+    return result;
+}
+
+SSC_AVX2 static int32_t ssc_find_int_avx2(const int32_t *a, int32_t n, int32_t value)
+{
+    __m256i key = _mm256_set1_epi32(value);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(a + i)), key);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (mask)
+            return i + __builtin_ctz((unsigned)mask);
+    }
+    for (; i < n; i++)
+        if (a[i] == value)
+            return i;
+    return -1;
+}
+
+SSC_AVX2 static int32_t ssc_find_real_avx2(const double *a, int32_t n, double value)
+{
+    __m256d key = _mm256_set1_pd(value);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(a + i), key, _CMP_EQ_OQ));
+        if (mask)
+            return i + __builtin_ctz((unsigned)mask);
+    }
+    for (; i < n; i++)
+        if (a[i] == value)
+            return i;
+    return -1;
+}
+#endif
+
+int32_t ssc_array_sum_int(const int32_t *a, int32_t n)
+{
+#ifdef SSC_X86
+    if (ssc_has_avx2())
+        return ssc_sum_int_avx2(a, n);
+#endif
+    /* Wraps like INTEGER addition in generated code */
+    uint32_t sum = 0;
+    for (int32_t i = 0; i < n; i++)
+        sum += (uint32_t)a[i];
+    return (int32_t)sum;
+}
+
+/* Lanes are added separately, so the last bits can differ from a left-to-right loop */
+double ssc_array_sum_real(const double *a, int32_t n)
+{
+#ifdef SSC_X86
+    if (ssc_has_avx2())
+        return ssc_sum_real_avx2(a, n);
+#endif
+    double sum = 0.0;
+    for (int32_t i = 0; i < n; i++)
+        sum += a[i];
+    return sum;
+}
+
+int32_t ssc_array_min_int(const int32_t *a, int32_t n)
+{
+    if (n <= 0)
+        return 0;
+#ifdef SSC_X86
+    if (ssc_has_avx2())
+        return ssc_minmax_int_avx2(a, n, 0);
+#endif
+    int32_t m = a[0];
+    for (int32_t i = 1; i < n; i++)
+        m = a[i] < m ? a[i] : m;
+    return m;
+}
+
+int32_t ssc_array_max_int(const int32_t *a, int32_t n)
+{
+    if (n <= 0)
+        return 0;
+#ifdef SSC_X86
+    if (ssc_has_avx2())
+        return ssc_minmax_int_avx2(a, n, 1);
+#endif
+    int32_t m = a[0];
+    for (int32_t i = 1; i < n; i++)
+        m = a[i] > m ? a[i] : m;
+    return m;
+}
+
+double ssc_array_min_real(const double *a, int32_t n)
+{
+    if (n <= 0)
+        return 0.0;
+#ifdef SSC_X86
+    if (ssc_has_avx2())
+        return ssc_minmax_real_avx2(a, n, 0);
+#endif
+    double m = a[0];
+    for (int32_t i = 1; i < n; i++)
+        m = a[i] < m ? a[i] : m;
+    return m;
+}
+
+double ssc_array_max_real(const double *a, int32_t n)
+{
+    if (n <= 0)
+        return 0.0;
+#ifdef SSC_X86
+    if (ssc_has_avx2())
+        return ssc_minmax_real_avx2(a, n, 1);
+#endif
+    double m = a[0];
+    for (int32_t i = 1; i < n; i++)
+        m = a[i] > m ? a[i] : m;
+    return m;
+}
+
+/* A plain loop of stores: compilers turn it into wide stores on every target */
+void ssc_array_fill_int(int32_t *a, int32_t n, int32_t value)
+{
+    for (int32_t i = 0; i < n; i++)
+        a[i] = value;
+}
+
+void ssc_array_fill_real(double *a, int32_t n, double value)
+{
+    for (int32_t i = 0; i < n; i++)
+        a[i] = value;
+}
+
+int32_t ssc_array_find_int(const int32_t *a, int32_t n, int32_t value)
+{
+#ifdef SSC_X86
+    if (ssc_has_avx2())
+        return ssc_find_int_avx2(a, n, value);
+#endif
+    for (int32_t i = 0; i < n; i++)
+        if (a[i] == value)
+            return i;
+    return -1;
+}
+
+int32_t ssc_array_find_real(const double *a, int32_t n, double value)
+{
+#ifdef SSC_X86
+    if (ssc_has_avx2())
+        return ssc_find_real_avx2(a, n, value);
+#endif
+    for (int32_t i = 0; i < n; i++)
+        if (a[i] == value)
+            return i;
+    return -1;
+}
+
+/* First position of value in an ascending array, or -1 */
+#define SSC_DEFINE_BSEARCH(name, T)                      \
+    int32_t name(const T *a, int32_t n, T value)         \
+    {                                                    \
+        int32_t lo = 0, len = n;                         \
+        while (len > 0)                                  \
+        {                                                \
+            int32_t half = len / 2;                      \
+            if (a[lo + half] < value)                    \
+            {                                            \
+                lo += half + 1;                          \
+                len -= half + 1;                         \
+            }                                            \
+            else                                         \
+                len = half;                              \
+        }                                                \
+        return lo < n && a[lo] == value ? lo : -1;       \
+    }
+
+SSC_DEFINE_BSEARCH(ssc_array_bsearch_int, int32_t)
+SSC_DEFINE_BSEARCH(ssc_array_bsearch_real, double)
+
+/* Ascending quicksort: median of three, three-way partition (so runs of
+   equal keys and NaNs cannot make it quadratic or run off the ends),
+   recursion on the smaller side and insertion sort for short ranges */
+#define SSC_DEFINE_SORT(name, T)                                             \
+    void name(T *a, int32_t n)                                               \
+    {                                                                        \
+        while (n > 16)                                                       \
+        {                                                                    \
+            T x = a[0], y = a[n / 2], z = a[n - 1];                          \
+            T pivot = x < y ? (y < z ? y : (x < z ? z : x))                  \
+                            : (x < z ? x : (y < z ? z : y));                 \
+            int32_t lt = 0, i = 0, gt = n;                                   \
+            while (i < gt)                                                   \
+            {                                                                \
+                T v = a[i];                                                  \
+                if (v < pivot)                                               \
+                {                                                            \
+                    a[i++] = a[lt];                                          \
+                    a[lt++] = v;                                             \
+                }                                                            \
+                else if (pivot < v)                                          \
+                {                                                            \
+                    a[i] = a[--gt];                                          \
+                    a[gt] = v;                                               \
+                }                                                            \
+                else                                                         \
+                    i++;                                                     \
+            }                                                                \
+            if (lt < n - gt)                                                 \
+            {                                                                \
+                name(a, lt);                                                 \
+                a += gt;                                                     \
+                n -= gt;                                                     \
+            }                                                                \
+            else                                                             \
+            {                                                                \
+                name(a + gt, n - gt);                                        \
+                n = lt;                                                      \
+            }                                                                \
+        }                                                                    \
+        for (int32_t i = 1; i < n; i++)                                      \
+        {                                                                    \
+            T v = a[i];                                                      \
+            int32_t j = i;                                                   \
+            for (; j > 0 && v < a[j - 1]; j--)                               \
+                a[j] = a[j - 1];                                             \
+            a[j] = v;                                                        \
+        }                                                                    \
+    }
+
+SSC_DEFINE_SORT(ssc_array_sort_int, int32_t)
+SSC_DEFINE_SORT(ssc_array_sort_real, double)
+
+/* ─────────────────────────────────────────── */
+/* Dynamic arrays and lists
+ *
+ * ARRAY[a:b] (or ARRAY[a:b, c:d, ...]) with bounds computed at run time and
+ * LIST OF are a descriptor in the variable's slot over one contiguous heap
+ * block, so element access is a load of data and first followed by
+ * indexing and the whole-array built-ins above take data and len
+ * unchanged. APPEND grows the block geometrically, so n appends cost O(n)
+ * copying in total. */
+
+struct ssc_vec
+{
+    void *data;
+    int32_t len; /* elements in use */
+    int32_t cap; /* elements that fit in data */
+    int32_t first; /* index of data[0] */
+};
+
+static void ssc_vec_bad_bounds(int32_t first, int32_t last)
+{
+    ssc_flush();
+    fprintf(stderr, "Array bounds %d:%d are not valid\n", first, last);
+    exit(1);
+}
+
+static void ssc_vec_alloc(struct ssc_vec *v, int32_t elemSize, int32_t len, int32_t first)
+{
+    v->data = len ? calloc((size_t)len, (size_t)elemSize) : NULL;
+    if (len && !v->data)
+        abort();
+    v->len = len;
+    v->cap = len;
+    v->first = first;
+}
+
+/* An array of last - first + 1 zeroed elements */
+void ssc_vec_init(struct ssc_vec *v, int32_t elemSize, int32_t first, int32_t last)
+{
+    int64_t len = (int64_t)last - first + 1;
+    if (len < 0 || len > INT32_MAX)
+        ssc_vec_bad_bounds(first, last);
+    ssc_vec_alloc(v, elemSize, (int32_t)len, first);
+}
+
+/* An array of rank dimensions, stored row-major. bounds holds the first and
+ * last index of each; dims receives the first index and extent of each
+ * dimension after the first, which element access reads. */
+void ssc_vec_init_dims(struct ssc_vec *v, int32_t elemSize, int32_t rank, const int32_t *bounds, int32_t *dims)
+{
+    int64_t len = 1;
+    for (int32_t d = 0; d < rank; d++)
+    {
+        int32_t first = bounds[2 * d];
+        int32_t last = bounds[2 * d + 1];
+        int64_t extent = (int64_t)last - first + 1;
+        if (extent < 0)
+            ssc_vec_bad_bounds(first, last);
+        len *= extent;
+        if (len > INT32_MAX)
+            ssc_vec_bad_bounds(first, last);
+        if (d > 0)
+        {
+            dims[2 * (d - 1)] = first;
+            dims[2 * (d - 1) + 1] = (int32_t)extent;
+        }
+    }
+    ssc_vec_alloc(v, elemSize, (int32_t)len, bounds[0]);
+}
+
+/* Makes room for at least need elements: doubles the capacity, starting at 8 */
+static __attribute__((noinline)) void ssc_vec_grow(struct ssc_vec *v, int32_t elemSize, int64_t need)
+{
+    int64_t cap = v->cap < 8 ? 8 : (int64_t)v->cap * 2;
+    while (cap < need)
+        cap *= 2;
+    if (cap > INT32_MAX)
+        cap = INT32_MAX;
+    if (need > cap)
+        abort();
+    void *data = realloc(v->data, (size_t)cap * (size_t)elemSize);
+    if (!data)
+        abort();
+    v->data = data;
+    v->cap = (int32_t)cap;
+}
+
+/* Adds a zeroed element at the end and returns its address */
+void *ssc_vec_push(struct ssc_vec *v, int32_t elemSize)
+{
+    if (v->len == v->cap)
+        ssc_vec_grow(v, elemSize, (int64_t)v->len + 1);
+    char *slot = (char *)v->data + (size_t)v->len * (size_t)elemSize;
+    memset(slot, 0, (size_t)elemSize);
+    v->len++;
+    return slot;
+}
+
+/* dst = src: dst takes src's elements and length and keeps its own first index */
+void ssc_vec_assign(struct ssc_vec *dst, const struct ssc_vec *src, int32_t elemSize)
+{
+    if (dst == src)
+        return;
+    if (src->len > dst->cap)
+        ssc_vec_grow(dst, elemSize, src->len);
+    if (src->len)
+        memcpy(dst->data, src->data, (size_t)src->len * (size_t)elemSize);
+    dst->len = src->len;
+}
+
+/* ─────────────────────────────────────────── */
+/* Strings (STRING values, &, LENGTH, MID, LEFT, RIGHT, UCASE, LCASE)
+ *
+ * A STRING is a char * to NUL-terminated text that is preceded by a header
+ * holding its length, capacity and reference count; the compiler emits
+ * literals with the same layout. Text of up to a few KB lives inline in
+ * size-classed blocks carved from 64KB chunks and recycled through free
+ * lists, longer text gets a malloc block of its own.
+ *
+ * Only slots (variables, parameters and array elements) are counted, and
+ * only through ssc_str_store. A string with no references is a temporary
+ * just made by an operator or built-in: the routines below release the
+ * temporaries they are given, or reuse them for their result. A slot that
+ * holds the only reference may grow its text in place (s = s & x). Slots
+ * of a routine that has returned are never released, which only ever
+ * overstates a count. */
+
+struct ssc_str_header
+{
+    uint32_t len;
+    uint32_t cap;  /* text bytes that fit before the NUL */
+    uint32_t refs; /* slots holding the string */
+    uint32_t reserved;
+};
+
+/* refs of literals, which are never written or freed */
+#define SSC_STR_LITERAL UINT32_MAX
+#define SSC_STR_CLASSES 8 /* blocks of 32, 64, ... 4096 bytes */
+#define SSC_STR_LARGEST (32u << (SSC_STR_CLASSES - 1))
+#define SSC_STR_CHUNK (64 * 1024)
+
+struct ssc_strings
+{
+    char *next; /* unused part of the current chunk */
+    char *end;
+    struct ssc_str_header *free[SSC_STR_CLASSES];
+};
+
+SSC_WEAK struct ssc_strings ssc_strings_state;
+
+/* Uninitialized STRING array elements are NULL and read as "" */
+static const struct
+{
+    struct ssc_str_header header;
+    char text[8];
+} ssc_str_empty = {{0, 0, SSC_STR_LITERAL, 0}, ""};
+
+static inline struct ssc_str_header *ssc_str_hdr(const char *s)
+{
+    return s ? (struct ssc_str_header *)s - 1 : (struct ssc_str_header *)&ssc_str_empty.header;
+}
+
+static inline char *ssc_str_text(struct ssc_str_header *h)
+{
+    return (char *)(h + 1);
+}
+
+static inline int ssc_str_class(size_t size)
+{
+    int k = 0;
+    while ((32u << k) < size)
+        k++;
+    return k;
+}
+
+/* A temporary of length len with room for at least cap bytes of text */
+static char *ssc_str_alloc(size_t len, size_t cap)
+{
+    struct ssc_strings *st = &ssc_strings_state;
+    size_t size = sizeof(struct ssc_str_header) + cap + 1;
+    struct ssc_str_header *h;
+    if (size <= SSC_STR_LARGEST)
+    {
+        int k = ssc_str_class(size);
+        size = 32u << k;
+        h = st->free[k];
+        if (h)
+            st->free[k] = *(struct ssc_str_header **)ssc_str_text(h);
+        else
+        {
+            if ((size_t)(st->end - st->next) < size)
+            {
+                st->next = (char *)malloc(SSC_STR_CHUNK);
+                if (!st->next)
+                    abort();
+                st->end = st->next + SSC_STR_CHUNK;
+            }
+            h = (struct ssc_str_header *)st->next;
+            st->next += size;
+        }
+    }
+    else
+    {
+        h = (struct ssc_str_header *)malloc(size);
+        if (!h)
+            abort();
+    }
+    h->cap = (uint32_t)(size - sizeof(struct ssc_str_header) - 1);
+    h->len = (uint32_t)len;
+    h->refs = 0;
+    ssc_str_text(h)[len] = '\0';
+    return ssc_str_text(h);
+}
+
+static void ssc_str_free(struct ssc_str_header *h)
+{
+    size_t size = sizeof(struct ssc_str_header) + h->cap + 1;
+    if (size > SSC_STR_LARGEST)
+    {
+        free(h);
+        return;
+    }
+    struct ssc_strings *st = &ssc_strings_state;
+    int k = ssc_str_class(size);
+    *(struct ssc_str_header **)ssc_str_text(h) = st->free[k];
+    st->free[k] = h;
+}
+
+/* Releases s if it is a temporary; called once a routine is done with an argument */
+static inline void ssc_str_drop(const char *s)
+{
+    struct ssc_str_header *h = ssc_str_hdr(s);
+    if (h->refs == 0)
+        ssc_str_free(h);
+}
+
+static inline void ssc_str_retain(struct ssc_str_header *h)
+{
+    if (h->refs < SSC_STR_LITERAL - 1)
+        h->refs++;
+}
+
+/* A count that saturated stays there, like a literal's */
+static inline void ssc_str_release(struct ssc_str_header *h)
+{
+    if (h->refs < SSC_STR_LITERAL - 1 && --h->refs == 0)
+        ssc_str_free(h);
+}
+
+/* ASCII case mapping and whitespace scanning, 16 or 32 bytes at a time.
+   A byte is one of the 26 letters from..from+25 when v + (128 - from) is
+   below -128 + 26 as a signed byte, and whitespace (' ' or '\t'..'\r')
+   likewise. */
+#ifdef SSC_X86
+SSC_AVX2 static size_t ssc_str_case_avx2(char *dst, const char *src, size_t n, char from)
+{
+    const __m256i bias = _mm256_set1_epi8((char)(128 - from));
+    const __m256i limit = _mm256_set1_epi8((char)(-128 + 26));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, bias));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(v, _mm256_and_si256(letter, flip)));
+    }
+    return i;
+}
+
+/* Stops at the first 32-byte block with a match, or returns n rounded down to 32 */
+SSC_AVX2 static size_t ssc_scan_space_avx2(const char *p, size_t n, int space)
+{
+    const __m256i bias = _mm256_set1_epi8((char)(128 - '\t'));
+    const __m256i limit = _mm256_set1_epi8((char)(-128 + 5));
+    const __m256i blank = _mm256_set1_epi8(' ');
+    uint32_t invert = space ? 0 : 0xFFFFFFFFu;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, blank), _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, bias)));
+        uint32_t hits = (uint32_t)_mm256_movemask_epi8(ws) ^ invert;
+        if (hits)
+            return i + (size_t)__builtin_ctz(hits);
+    }
+    return i;
+}
+#endif
+
+/* Copies n bytes of src to dst, flipping the case of the letters from..from+25 */
+static void ssc_str_case(char *dst, const char *src, size_t n, char from)
+{
+    size_t i = 0;
+#ifdef SSC_X86
+    if (n >= 32 && ssc_has_avx2())
+        i = ssc_str_case_avx2(dst, src, n, from);
+#endif
+#if defined(SSC_X86) && defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi8((char)(128 - from));
+    const __m128i limit = _mm_set1_epi8((char)(-128 + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i letter = _mm_cmplt_epi8(_mm_add_epi8(v, bias), limit);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(v, _mm_and_si128(letter, flip)));
+    }
+#endif
+    for (; i < n; i++)
+        dst[i] = (char)((unsigned char)(src[i] - from) < 26 ? src[i] ^ 0x20 : src[i]);
+}
+
+static inline int ssc_is_space(int c)
+{
+    return c == ' ' || (unsigned)(c - '\t') < 5;
+}
+
+/* Index of the first byte of p[0..n) that is whitespace (space = 1) or is not (space = 0), or n */
+static size_t ssc_scan_space(const char *p, size_t n, int space)
+{
+    size_t i = 0;
+#ifdef SSC_X86
+    if (n >= 32 && ssc_has_avx2())
+    {
+        i = ssc_scan_space_avx2(p, n, space);
+        if (i < (n & ~(size_t)31))
+            return i;
+    }
+#endif
+#if defined(SSC_X86) && defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi8((char)(128 - '\t'));
+    const __m128i limit = _mm_set1_epi8((char)(-128 + 5));
+    const __m128i blank = _mm_set1_epi8(' ');
+    unsigned invert = space ? 0 : 0xFFFFu;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, blank), _mm_cmplt_epi8(_mm_add_epi8(v, bias), limit));
+        unsigned hits = ((unsigned)_mm_movemask_epi8(ws) ^ invert) & 0xFFFFu;
+        if (hits)
+            return i + (size_t)__builtin_ctz(hits);
+    }
+#endif
+    for (; i < n; i++)
+        if (ssc_is_space((unsigned char)p[i]) == space)
+            return i;
+    return n;
+}
+
+int32_t ssc_str_length(const char *s)
+{
+    int32_t n = (int32_t)ssc_str_hdr(s)->len;
+    ssc_str_drop(s);
+    return n;
+}
+
+/* Stores value into a slot that already holds a STRING */
+void ssc_str_store(char **slot, char *value)
+{
+    char *old = *slot;
+    if (value == old)
+        return;
+    ssc_str_retain(ssc_str_hdr(value));
+    *slot = value;
+    ssc_str_release(ssc_str_hdr(old));
+}
+
+/* Stores value into a fresh slot, such as a parameter, whose old contents are undefined */
+void ssc_str_init(char **slot, char *value)
+{
+    *slot = NULL;
+    ssc_str_store(slot, value);
+}
+
+/* After a whole-array copy the n strings are held by one more slot each */
+void ssc_str_share(char **a, int32_t n)
+{
+    for (int32_t i = 0; i < n; i++)
+        ssc_str_retain(ssc_str_hdr(a[i]));
+}
+
+/* a & b & ... in one allocation */
+char *ssc_str_concat(char *const *parts, int32_t n)
+{
+    size_t total = 0;
+    for (int32_t i = 0; i < n; i++)
+        total += ssc_str_hdr(parts[i])->len;
+    char *text = ssc_str_alloc(total, total);
+    size_t pos = 0;
+    for (int32_t i = 0; i < n; i++)
+    {
+        size_t len = ssc_str_hdr(parts[i])->len;
+        memcpy(text + pos, ssc_str_text(ssc_str_hdr(parts[i])), len);
+        pos += len;
+        ssc_str_drop(parts[i]);
+    }
+    return text;
+}
+
+/* s = s & a & ...: extends the slot's own text in place while it fits, and
+   otherwise moves it to a block twice the new length, so a loop of appends
+   costs linear time */
+void ssc_str_append(char **slot, char *const *parts, int32_t n)
+{
+    char *old = *slot;
+    struct ssc_str_header *h = ssc_str_hdr(old);
+    size_t len = h->len;
+    size_t total = len;
+    for (int32_t i = 0; i < n; i++)
+        total += ssc_str_hdr(parts[i])->len;
+
+    char *text = old;
+    if (h->refs != 1 || total > h->cap)
+    {
+        text = ssc_str_alloc(total, total * 2);
+        memcpy(text, ssc_str_text(h), len);
+    }
+    /* A part may be the old text itself; its bytes before len are not written */
+    size_t pos = len;
+    for (int32_t i = 0; i < n; i++)
+    {
+        size_t partLen = ssc_str_hdr(parts[i])->len;
+        memcpy(text + pos, ssc_str_text(ssc_str_hdr(parts[i])), partLen);
+        pos += partLen;
+        ssc_str_drop(parts[i]);
+    }
+    text[total] = '\0';
+    ssc_str_hdr(text)->len = (uint32_t)total;
+    if (text != old)
+    {
+        ssc_str_hdr(text)->refs = 1;
+        *slot = text;
+        ssc_str_release(h);
+    }
+}
+
+int32_t ssc_str_compare(const char *a, const char *b)
+{
+    struct ssc_str_header *ha = ssc_str_hdr(a), *hb = ssc_str_hdr(b);
+    size_t n = ha->len < hb->len ? ha->len : hb->len;
+    int c = memcmp(ssc_str_text(ha), ssc_str_text(hb), n);
+    int32_t result = c ? (c < 0 ? -1 : 1) : (ha->len > hb->len) - (ha->len < hb->len);
+    ssc_str_drop(a);
+    ssc_str_drop(b);
+    return result;
+}
+
+int32_t ssc_str_equal(const char *a, const char *b)
+{
+    struct ssc_str_header *ha = ssc_str_hdr(a), *hb = ssc_str_hdr(b);
+    int32_t result = ha->len == hb->len && memcmp(ssc_str_text(ha), ssc_str_text(hb), ha->len) == 0;
+    ssc_str_drop(a);
+    ssc_str_drop(b);
+    return result;
+}
+
+/* count bytes of s from the 0-based from, both already within bounds; a
+   temporary is cut down in place instead of being copied */
+static char *ssc_str_slice(char *s, size_t from, size_t count)
+{
+    struct ssc_str_header *h = ssc_str_hdr(s);
+    if (h->refs == 0)
+    {
+        memmove(s, s + from, count);
+        s[count] = '\0';
+        h->len = (uint32_t)count;
+        return s;
+    }
+    char *text = ssc_str_alloc(count, count);
+    memcpy(text, ssc_str_text(h) + from, count);
+    return text;
+}
+
+/* MID(s, start, count) with a 1-based start; the range is clipped to the string */
+char *ssc_str_mid(char *s, int32_t start, int32_t count)
+{
+    int64_t len = ssc_str_hdr(s)->len;
+    int64_t from = (int64_t)start - 1, to = from + count;
+    if (from < 0)
+        from = 0;
+    if (to > len)
+        to = len;
+    if (from > to)
+        from = to = 0;
+    return ssc_str_slice(s, (size_t)from, (size_t)(to - from));
+}
+
+char *ssc_str_left(char *s, int32_t count)
+{
+    int64_t len = ssc_str_hdr(s)->len;
+    return ssc_str_slice(s, 0, (size_t)(count < 0 ? 0 : count > len ? len : count));
+}
+
+char *ssc_str_right(char *s, int32_t count)
+{
+    int64_t len = ssc_str_hdr(s)->len;
+    int64_t n = count < 0 ? 0 : count > len ? len : count;
+    return ssc_str_slice(s, (size_t)(len - n), (size_t)n);
+}
+
+static char *ssc_str_convert_case(char *s, char from)
+{
+    struct ssc_str_header *h = ssc_str_hdr(s);
+    char *text = h->refs == 0 ? s : ssc_str_alloc(h->len, h->len);
+    ssc_str_case(text, ssc_str_text(h), h->len, from);
+    return text;
+}
+
+char *ssc_str_upper(char *s)
+{
+    return ssc_str_convert_case(s, 'a');
+}
+
+char *ssc_str_lower(char *s)
+{
+    return ssc_str_convert_case(s, 'A');
+}
+
+/* OUTPUT of a STRING (or DATE) */
+void ssc_output_str(const char *s)
+{
+    struct ssc_str_header *h = ssc_str_hdr(s);
+    ssc_output_bytes(ssc_str_text(h), h->len);
+    ssc_str_drop(s);
+}
+
+/* INPUT of a STRING reads one whitespace-delimited word of any length */
+void ssc_input_str(char **target)
+{
+    struct ssc_io *io = &ssc_io_state;
+    ssc_in_skip_space();
+    char *text = NULL;
+    size_t len = 0;
+    while (io->inPos < io->inLen || ssc_in_fill())
+    {
+        const char *start = io->in + io->inPos;
+        size_t n = ssc_scan_space(start, io->inLen - io->inPos, 1);
+        struct ssc_str_header *h = ssc_str_hdr(text);
+        if (!text || len + n > h->cap)
+        {
+            char *grown = ssc_str_alloc(len, (len + n) * 2);
+            memcpy(grown, ssc_str_text(h), len);
+            if (text)
+                ssc_str_free(h);
+            text = grown;
+        }
+        memcpy(text + len, start, n);
+        len += n;
+        io->inPos += n;
+        if (io->inPos < io->inLen)
+            break;
+    }
+    if (len == 0)
+    {
+        if (text)
+            ssc_str_free(ssc_str_hdr(text));
+        return;
+    }
+    text[len] = '\0';
+    ssc_str_hdr(text)->len = (uint32_t)len;
+    ssc_str_store(target, text);
+}
+
+/* ─────────────────────────────────────────── */
+/* Whole arrays (OUTPUT A, OUTPUT A : sep, INPUT A)
+ *
+ * One call covers every element in row-major order, with the pointer and
+ * length the array built-ins get. Output is formatted straight into the
+ * output buffer, which leaves in one write() per 64KB; the separator goes
+ * between elements, not after the last. */
+
+#define SSC_OUTPUT_ARRAY(suffix, type, output)                                   \
+    void ssc_output_array_##suffix(const type *a, int32_t n, const char *sep)   \
+    {                                                                            \
+        struct ssc_str_header *h = ssc_str_hdr(sep);                             \
+        for (int32_t i = 0; i < n; i++)                                          \
+        {                                                                        \
+            if (i)                                                               \
+                ssc_output_bytes(ssc_str_text(h), h->len);                       \
+            output(a[i]);                                                        \
+        }                                                                        \
+        ssc_str_drop(sep);                                                       \
+    }
+
+SSC_OUTPUT_ARRAY(int, int32_t, ssc_output_int)
+SSC_OUTPUT_ARRAY(real, double, ssc_output_real)
+SSC_OUTPUT_ARRAY(char, char, ssc_output_char)
+SSC_OUTPUT_ARRAY(bool, uint8_t, ssc_output_bool)
+SSC_OUTPUT_ARRAY(str, char *, ssc_output_str)
+#undef SSC_OUTPUT_ARRAY
+
+/* Digits are parsed in place in the input buffer; only a number that the
+   next read() may continue goes through ssc_input_int. As with a loop of
+   INPUT statements, an element whose read fails keeps its value. */
+void ssc_input_array_int(int32_t *a, int32_t n)
+{
+    struct ssc_io *io = &ssc_io_state;
+    for (int32_t i = 0; i < n; i++)
+    {
+        ssc_in_skip_space();
+        const char *p = io->in + io->inPos;
+        const char *end = io->in + io->inLen;
+        const char *q = p;
+        if (q < end && (*q == '-' || *q == '+'))
+            q++;
+        const char *digits = q;
+        uint32_t value = 0;
+        while (q < end && (unsigned)(*q - '0') < 10)
+            value = value * 10 + (uint32_t)(*q++ - '0');
+        if (q == end)
+        {
+            ssc_input_int(a + i);
+            continue;
+        }
+        io->inPos = (size_t)(q - io->in);
+        if (q != digits)
+            a[i] = *p == '-' ? (int32_t)(0u - value) : (int32_t)value;
+    }
+}
+
+void ssc_input_array_real(double *a, int32_t n)
+{
+    for (int32_t i = 0; i < n; i++)
+        ssc_input_real(a + i);
+}
+
+void ssc_input_array_char(char *a, int32_t n)
+{
+    for (int32_t i = 0; i < n; i++)
+        ssc_input_char(a + i);
+}
+
+void ssc_input_array_str(char **a, int32_t n)
+{
+    for (int32_t i = 0; i < n; i++)
+        ssc_input_str(a + i);
+}
+
+/* ─────────────────────────────────────────── */
+/* Text files (OPENFILE, READFILE, WRITEFILE, CLOSEFILE, EOF)
+ *
+ * Files are named by their path, as in the pseudocode. A file opened FOR
+ * READ is mapped into memory whole, and READFILE copies the next line out
+ * of the mapping after finding its newline 16 or 32 bytes at a time; pipes
+ * and other files that cannot be mapped are read through a buffer that
+ * grows to hold the longest line. Files opened FOR WRITE or APPEND collect
+ * their lines in a 1MB buffer, written out when full, at CLOSEFILE and at
+ * exit. */
+
+#define SSC_MAX_FILES 16
+#define SSC_FILE_BUFFER_SIZE (1024 * 1024)
+
+/* Same values as FileMode in AST.h */
+enum
+{
+    SSC_FILE_READ,
+    SSC_FILE_WRITE,
+    SSC_FILE_APPEND
+};
+
+struct ssc_file
+{
+    char *name; /* NULL while the slot is free */
+    int fd;
+    int mode;
+    int mapped; /* data maps the whole file */
+    int eof;    /* nothing more to read() into data */
+    char *data; /* the mapping, or the read or write buffer */
+    size_t pos; /* next byte to read */
+    size_t len; /* bytes in data */
+    size_t cap; /* size of the buffer */
+};
+
+SSC_WEAK struct ssc_file ssc_files_state[SSC_MAX_FILES];
+
+static void ssc_file_fail(const char *path, const char *message)
+{
+    ssc_flush();
+    fprintf(stderr, "File %s: %s\n", path, message);
+    exit(1);
+}
+
+static struct ssc_file *ssc_file_find(const char *path)
+{
+    for (int i = 0; i < SSC_MAX_FILES; i++)
+        if (ssc_files_state[i].name && strcmp(ssc_files_state[i].name, path) == 0)
+            return &ssc_files_state[i];
+    return NULL;
+}
+
+/* The open file called name, which must be open for reading or not, as asked */
+static struct ssc_file *ssc_file_get(const char *name, int reading)
+{
+    const char *path = ssc_str_text(ssc_str_hdr(name));
+    struct ssc_file *f = ssc_file_find(path);
+    if (!f)
+        ssc_file_fail(path, "not open");
+    if ((f->mode == SSC_FILE_READ) != reading)
+        ssc_file_fail(path, reading ? "not open FOR READ" : "open FOR READ");
+    return f;
+}
+
+#ifdef SSC_X86
+/* Stops at the first 32-byte block with a newline, or returns n rounded down to 32 */
+SSC_AVX2 static size_t ssc_scan_newline_avx2(const char *p, size_t n)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        uint32_t hits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)), newline));
+        if (hits)
+            return i + (size_t)__builtin_ctz(hits);
+    }
+    return i;
+}
+#endif
+
+/* Position of the first '\n' in p[0..n), or n */
+static size_t ssc_scan_newline(const char *p, size_t n)
+{
+    size_t i = 0;
+#ifdef SSC_X86
+    if (n >= 32 && ssc_has_avx2())
+    {
+        i = ssc_scan_newline_avx2(p, n);
+        if (i < (n & ~(size_t)31))
+            return i;
+    }
+#endif
+#if defined(SSC_X86) && defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= n; i += 16)
+    {
+        unsigned hits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), newline));
+        if (hits)
+            return i + (size_t)__builtin_ctz(hits);
+    }
+#endif
+    for (; i < n; i++)
+        if (p[i] == '\n')
+            return i;
+    return n;
+}
+
+/* Moves the unread bytes to the front of the buffer and reads more after
+   them, doubling the buffer when they fill it; 0 at the end of the file */
+static int ssc_file_fill(struct ssc_file *f)
+{
+    if (f->eof)
+        return 0;
+    memmove(f->data, f->data + f->pos, f->len - f->pos);
+    f->len -= f->pos;
+    f->pos = 0;
+    if (f->len == f->cap)
+    {
+        f->cap *= 2;
+        f->data = (char *)realloc(f->data, f->cap);
+        if (!f->data)
+            abort();
+    }
+    ssize_t n = read(f->fd, f->data + f->len, f->cap - f->len);
+    if (n <= 0)
+    {
+        f->eof = 1;
+        return 0;
+    }
+    f->len += (size_t)n;
+    return 1;
+}
+
+/* The next line without its line break, or 0 when the file is exhausted */
+static int ssc_file_line(struct ssc_file *f, const char **line, size_t *len)
+{
+    size_t scanned = 0;
+    for (;;)
+    {
+        size_t avail = f->len - f->pos;
+        size_t n = scanned + ssc_scan_newline(f->data + f->pos + scanned, avail - scanned);
+        if (n < avail)
+        {
+            *line = f->data + f->pos;
+            *len = n;
+            f->pos += n + 1;
+            break;
+        }
+        scanned = avail;
+        if (!ssc_file_fill(f))
+        {
+            /* A last line without a line break */
+            if (avail == 0)
+                return 0;
+            *line = f->data + f->pos;
+            *len = avail;
+            f->pos = f->len;
+            break;
+        }
+    }
+    if (*len && (*line)[*len - 1] == '\r')
+        (*len)--;
+    return 1;
+}
+
+static void ssc_file_flush(struct ssc_file *f)
+{
+    size_t done = 0;
+    while (done < f->len)
+    {
+        ssize_t n = write(f->fd, f->data + done, f->len - done);
+        if (n <= 0)
+            break;
+        done += (size_t)n;
+    }
+    f->len = 0;
+}
+
+static void ssc_file_put(struct ssc_file *f, const char *s, size_t n)
+{
+    if (f->len + n > f->cap)
+        ssc_file_flush(f);
+    if (n > f->cap)
+    {
+        ssize_t w;
+        while (n > 0 && (w = write(f->fd, s, n)) > 0)
+        {
+            s += w;
+            n -= (size_t)w;
+        }
+        return;
+    }
+    memcpy(f->data + f->len, s, n);
+    f->len += n;
+}
+
+static void ssc_files_at_exit(void) __attribute__((destructor));
+static void ssc_files_at_exit(void)
+{
+    for (int i = 0; i < SSC_MAX_FILES; i++)
+        if (ssc_files_state[i].name && ssc_files_state[i].mode != SSC_FILE_READ)
+            ssc_file_flush(&ssc_files_state[i]);
+}
+
+void ssc_file_open(const char *name, int32_t mode)
+{
+    const char *path = ssc_str_text(ssc_str_hdr(name));
+    if (ssc_file_find(path))
+        ssc_file_fail(path, "already open");
+    struct ssc_file *f = NULL;
+    for (int i = 0; i < SSC_MAX_FILES && !f; i++)
+        if (!ssc_files_state[i].name)
+            f = &ssc_files_state[i];
+    if (!f)
+        ssc_file_fail(path, "too many files open");
+
+    int flags = mode == SSC_FILE_READ ? O_RDONLY : O_WRONLY | O_CREAT | (mode == SSC_FILE_APPEND ? O_APPEND : O_TRUNC);
+    int fd = open(path, flags, 0666);
+    if (fd < 0)
+        ssc_file_fail(path, strerror(errno));
+    memset(f, 0, sizeof(*f));
+    f->fd = fd;
+    f->mode = mode;
+    if (mode == SSC_FILE_READ)
+    {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+                f->data = (char *)map;
+                f->len = (size_t)st.st_size;
+                f->mapped = 1;
+                f->eof = 1;
+            }
+        }
+    }
+    if (!f->mapped)
+    {
+        f->cap = SSC_FILE_BUFFER_SIZE;
+        f->data = (char *)malloc(f->cap);
+        if (!f->data)
+            abort();
+    }
+    f->name = strdup(path);
+    ssc_str_drop(name);
+}
+
+/* Like INPUT, a read at the end of the file leaves the target unchanged */
+void ssc_file_read(const char *name, char **target)
+{
+    struct ssc_file *f = ssc_file_get(name, 1);
+    const char *line;
+    size_t len;
+    if (ssc_file_line(f, &line, &len))
+    {
+        char *text = ssc_str_alloc(len, len);
+        memcpy(text, line, len);
+        ssc_str_store(target, text);
+    }
+    ssc_str_drop(name);
+}
+
+int32_t ssc_file_eof(const char *name)
+{
+    struct ssc_file *f = ssc_file_get(name, 1);
+    int32_t eof = f->pos == f->len && !ssc_file_fill(f);
+    ssc_str_drop(name);
+    return eof;
+}
+
+/* WRITEFILE writes its value and a line break */
+void ssc_file_write_str(const char *name, const char *s)
+{
+    struct ssc_file *f = ssc_file_get(name, 0);
+    struct ssc_str_header *h = ssc_str_hdr(s);
+    ssc_file_put(f, ssc_str_text(h), h->len);
+    ssc_file_put(f, "\n", 1);
+    ssc_str_drop(s);
+    ssc_str_drop(name);
+}
+
+void ssc_file_write_int(const char *name, int32_t value)
+{
+    struct ssc_file *f = ssc_file_get(name, 0);
+    char digits[12];
+    size_t len = ssc_format_int(digits, value);
+    digits[len] = '\n';
+    ssc_file_put(f, digits, len + 1);
+    ssc_str_drop(name);
+}
+
+void ssc_file_write_real(const char *name, double value)
+{
+    struct ssc_file *f = ssc_file_get(name, 0);
+    char text[400];
+    int n = snprintf(text, sizeof(text), "%f\n", value);
+    ssc_file_put(f, text, (size_t)n);
+    ssc_str_drop(name);
+}
+
+void ssc_file_close(const char *name)
+{
+    const char *path = ssc_str_text(ssc_str_hdr(name));
+    struct ssc_file *f = ssc_file_find(path);
+    if (!f)
+        ssc_file_fail(path, "not open");
+    if (f->mode != SSC_FILE_READ)
+        ssc_file_flush(f);
+    if (f->mapped)
+        munmap(f->data, f->len);
+    else
+        free(f->data);
+    close(f->fd);
+    free(f->name);
+    f->name = NULL;
+    ssc_str_drop(name);
+}
+
+/* ─────────────────────────────────────────── */
+/* Profiling (--profile-generate)
+ *
+ * Each instrumented module registers a table of counter arrays from a global
+ * constructor. At exit the counts are added to the records already in the
+ * profile file, under an exclusive lock so parallel runs can share one file.
+ * The file has one line per routine: NAME CHECKSUM COUNT C0 C1 ... */
+
+struct ssc_profile_function
+{
+    const char *name;
+    uint64_t checksum;
+    uint64_t *counters;
+    uint32_t count;
+};
+
+#define SSC_PROFILE_MAX_TABLES 64
+
+struct ssc_profile
+{
+    const struct ssc_profile_function *tables[SSC_PROFILE_MAX_TABLES];
+    int32_t tableSizes[SSC_PROFILE_MAX_TABLES];
+    int tableCount;
+    const char *path;
+    int atexitInstalled;
+};
+
+SSC_WEAK struct ssc_profile ssc_profile_state;
+
+static const struct ssc_profile_function *ssc_profile_find(const char *name, size_t nameLen)
+{
+    struct ssc_profile *p = &ssc_profile_state;
+    for (int t = 0; t < p->tableCount; t++)
+        for (int32_t i = 0; i < p->tableSizes[t]; i++)
+        {
+            const struct ssc_profile_function *f = &p->tables[t][i];
+            if (strlen(f->name) == nameLen && memcmp(f->name, name, nameLen) == 0)
+                return f;
+        }
+    return NULL;
+}
+
+static char *ssc_profile_read(int fd)
+{
+    size_t cap = 4096, len = 0;
+    char *text = (char *)malloc(cap);
+    ssize_t n;
+    while (text && (n = read(fd, text + len, cap - len - 1)) > 0)
+    {
+        len += (size_t)n;
+        if (cap - len < 2)
+        {
+            cap *= 2;
+            char *grown = (char *)realloc(text, cap);
+            if (!grown)
+                free(text);
+            text = grown;
+        }
+    }
+    if (text)
+        text[len] = '\0';
+    return text;
+}
+
+static void ssc_profile_write(void)
+{
+    struct ssc_profile *p = &ssc_profile_state;
+    const char *path = getenv("SSC_PROFILE_FILE");
+    if (!path || !*path)
+        path = p->path;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || flock(fd, LOCK_EX) != 0)
+    {
+        fprintf(stderr, "ssc: cannot write profile %s\n", path);
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    char *old = ssc_profile_read(fd);
+    FILE *out = fdopen(fd, "w");
+    if (!old || !out || ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0)
+    {
+        fprintf(stderr, "ssc: cannot update profile %s\n", path);
+        free(old);
+        if (out)
+            fclose(out);
+        else
+            close(fd);
+        return;
+    }
+
+    /* Fold matching records into our counters; keep every other line as it was */
+    fputs("# ssc profile v1\n", out);
+    for (char *line = old, *next; line && *line; line = next)
+    {
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        if (*line == '#' || *line == '\0')
+            continue;
+        char *end = strchr(line, ' ');
+        const struct ssc_profile_function *f = end ? ssc_profile_find(line, (size_t)(end - line)) : NULL;
+        if (f)
+        {
+            char *cursor = end;
+            uint64_t checksum = strtoull(cursor, &cursor, 16);
+            unsigned long count = strtoul(cursor, &cursor, 10);
+            /* A record of an older version of the routine is dropped */
+            if (checksum == f->checksum && count == f->count)
+                for (uint32_t i = 0; i < f->count; i++)
+                    f->counters[i] += strtoull(cursor, &cursor, 10);
+            continue;
+        }
+        fprintf(out, "%s\n", line);
+    }
+    free(old);
+
+    for (int t = 0; t < p->tableCount; t++)
+        for (int32_t i = 0; i < p->tableSizes[t]; i++)
+        {
+            const struct ssc_profile_function *f = &p->tables[t][i];
+            fprintf(out, "%s %016llx %u", f->name, (unsigned long long)f->checksum, f->count);
+            for (uint32_t c = 0; c < f->count; c++)
+                fprintf(out, " %llu", (unsigned long long)f->counters[c]);
+            fputc('\n', out);
+        }
+    fclose(out); /* also releases the lock */
+}
+
+void ssc_profile_register(const void *functions, int32_t count, const char *path)
+{
+    struct ssc_profile *p = &ssc_profile_state;
+    if (p->tableCount < SSC_PROFILE_MAX_TABLES)
+    {
+        p->tables[p->tableCount] = (const struct ssc_profile_function *)functions;
+        p->tableSizes[p->tableCount] = count;
+        p->tableCount++;
+    }
+    if (!p->path)
+        p->path = path;
+    /* Every module carries its own copy of this function; write the file once */
+    if (!p->atexitInstalled)
+    {
+        p->atexitInstalled = 1;
+        atexit(ssc_profile_write);
+    }
+}
+
+/* ─────────────────────────────────────────── */
+/* Line profile (--profile-lines)
+ *
+ * counts[line] and cycles[line] are filled in by the instrumented program.
+ * The report goes to stderr (or $SSC_LINE_PROFILE) at exit, and also when
+ * the program is stopped by a CPU time limit or an interrupt, since that is
+ * when it is most wanted. It is formatted with snprintf and write(2) so the
+ * signal handler can produce it too. */
+
+struct ssc_line_table
+{
+    const uint64_t *counts;
+    const uint64_t *cycles;
+    int32_t lines;
+    const char *file;
+    const char *source;
+};
+
+#define SSC_LINES_MAX_TABLES 64
+
+struct ssc_lines
+{
+    struct ssc_line_table tables[SSC_LINES_MAX_TABLES];
+    int tableCount;
+    volatile sig_atomic_t reported;
+};
+
+SSC_WEAK struct ssc_lines ssc_lines_state;
+
+static void ssc_lines_put(int fd, const char *text, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, text, len);
+        if (n <= 0)
+            return;
+        text += n;
+        len -= (size_t)n;
+    }
+}
+
+static void ssc_lines_report_table(int fd, const struct ssc_line_table *t)
+{
+    char buf[256];
+    /* Cycles are inclusive (a loop line covers its body), so they are shown
+       relative to the most expensive line rather than summed */
+    uint64_t maxCycles = 0;
+    if (t->cycles)
+        for (int32_t i = 0; i < t->lines; i++)
+            maxCycles = t->cycles[i] > maxCycles ? t->cycles[i] : maxCycles;
+
+    int n = snprintf(buf, sizeof buf, "\n-- line profile: %s --\n%6s %14s", t->file, "line", "count");
+    if (t->cycles)
+        n += snprintf(buf + n, sizeof buf - n, " %16s %6s", "cycles", "%max");
+    n += snprintf(buf + n, sizeof buf - n, "  source\n");
+    ssc_lines_put(fd, buf, (size_t)n);
+
+    const char *text = t->source;
+    for (int32_t line = 1; line < t->lines && *text; line++)
+    {
+        const char *end = strchr(text, '\n');
+        size_t len = end ? (size_t)(end - text) : strlen(text);
+        uint64_t cycles = t->cycles ? t->cycles[line] : 0;
+        if (t->counts[line] || cycles)
+        {
+            n = snprintf(buf, sizeof buf, "%6d %14llu", (int)line, (unsigned long long)t->counts[line]);
+            if (t->cycles)
+                n += snprintf(buf + n, sizeof buf - n, " %16llu %5.1f%%", (unsigned long long)cycles,
+                              maxCycles ? 100.0 * (double)cycles / (double)maxCycles : 0.0);
+            n += snprintf(buf + n, sizeof buf - n, "  ");
+            ssc_lines_put(fd, buf, (size_t)n);
+            ssc_lines_put(fd, text, len > 100 ? 100 : len);
+            ssc_lines_put(fd, "\n", 1);
+        }
+        text += len + (end != NULL);
+    }
+}
+
+static void ssc_lines_report(void)
+{
+    struct ssc_lines *l = &ssc_lines_state;
+    if (l->reported)
+        return;
+    l->reported = 1;
+
+    int fd = STDERR_FILENO;
+    const char *path = getenv("SSC_LINE_PROFILE");
+    if (path && *path)
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return;
+    for (int i = 0; i < l->tableCount; i++)
+        ssc_lines_report_table(fd, &l->tables[i]);
+    if (fd != STDERR_FILENO)
+        close(fd);
+}
+
+static void ssc_lines_signal(int sig)
+{
+    ssc_lines_report();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+void ssc_lines_register(const uint64_t *counts, const uint64_t *cycles, int32_t lines, const char *file,
+                        const char *source)
+{
+    struct ssc_lines *l = &ssc_lines_state;
+    if (l->tableCount == SSC_LINES_MAX_TABLES)
+        return;
+    struct ssc_line_table *t = &l->tables[l->tableCount++];
+    t->counts = counts;
+    t->cycles = cycles;
+    t->lines = lines;
+    t->file = file;
+    t->source = source;
+
+    /* Shared by every module's copy of the runtime: install once */
+    if (l->tableCount == 1)
+    {
+        atexit(ssc_lines_report);
+        signal(SIGXCPU, ssc_lines_signal);
+        signal(SIGINT, ssc_lines_signal);
+        signal(SIGTERM, ssc_lines_signal);
+    }
+}